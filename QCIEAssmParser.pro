@@ -15,17 +15,24 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(core/core.pri)
+
 SOURCES += \
     main.cpp \
-    core/CIEAssemRunner.cpp \
+    ui/CodeEditor.cpp \
     ui/MainWindow.cpp \
+    ui/ParseCache.cpp \
+    ui/ProfileModel.cpp \
+    ui/TraceModel.cpp \
     core/Highlighter.cpp
 
 HEADERS += \
-    core/Common.hpp \
-    core/CIEAssemRunner.hpp \
     core/Highlighter.hpp \
-    ui/MainWindow.hpp
+    ui/CodeEditor.hpp \
+    ui/MainWindow.hpp \
+    ui/ParseCache.hpp \
+    ui/ProfileModel.hpp \
+    ui/TraceModel.hpp
 
 FORMS += \
     ui/MainWindow.ui
@@ -0,0 +1,60 @@
+#include "AllocationCounter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+
+namespace
+{
+    std::atomic<qint64> allocationCount{ 0 };
+    std::atomic<qint64> allocatedBytes{ 0 };
+
+    inline void Count(size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(qint64(size), std::memory_order_relaxed);
+    }
+} // namespace
+
+#ifdef __GLIBC__
+// The executable comes first in the symbol lookup order, so these replace malloc for Qt and the C++ runtime as well,
+// which keeps QString and QVector allocations in the count. glibc exports the real implementations under other names.
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *pointer, size_t size);
+
+    void *malloc(size_t size)
+    {
+        Count(size);
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        Count(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *pointer, size_t size)
+    {
+        Count(size);
+        return __libc_realloc(pointer, size);
+    }
+}
+
+bool AllocationCountingSupported()
+{
+    return true;
+}
+#else
+bool AllocationCountingSupported()
+{
+    return false;
+}
+#endif
+
+AllocationCount CurrentAllocationCount()
+{
+    return { allocationCount.load(std::memory_order_relaxed), allocatedBytes.load(std::memory_order_relaxed) };
+}
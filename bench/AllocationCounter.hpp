@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QtGlobal>
+
+/// Heap allocations made by the whole process since it started, Qt included.
+struct AllocationCount
+{
+    qint64 allocations = 0;
+    qint64 bytes = 0;
+};
+
+/// False when the C library of this platform cannot be hooked, the counts then stay at zero.
+bool AllocationCountingSupported();
+AllocationCount CurrentAllocationCount();
@@ -0,0 +1,71 @@
+#include "Benchmark.hpp"
+
+#include "AllocationCounter.hpp"
+
+#include <QElapsedTimer>
+#include <limits>
+
+QJsonObject BenchmarkResult::ToJson() const
+{
+    QJsonObject object;
+    object["benchmark"] = benchmark;
+    object["program"] = program;
+    object["unit"] = unit;
+    object["units_per_iteration"] = unitsPerIteration;
+    object["iterations"] = iterations;
+    object["min_ns"] = minimumNs;
+    object["mean_ns"] = meanNs;
+    object["ns_per_unit"] = NsPerUnit();
+    object["units_per_second"] = UnitsPerSecond();
+    object["allocations"] = allocations;
+    object["bytes_allocated"] = bytesAllocated;
+    return object;
+}
+
+BenchmarkResult BenchmarkResult::FromJson(const QJsonObject &object)
+{
+    BenchmarkResult result;
+    result.benchmark = object["benchmark"].toString();
+    result.program = object["program"].toString();
+    result.unit = object["unit"].toString();
+    result.unitsPerIteration = qint64(object["units_per_iteration"].toDouble());
+    result.iterations = qint64(object["iterations"].toDouble());
+    result.minimumNs = object["min_ns"].toDouble();
+    result.meanNs = object["mean_ns"].toDouble();
+    result.allocations = qint64(object["allocations"].toDouble(-1));
+    result.bytesAllocated = qint64(object["bytes_allocated"].toDouble(-1));
+    return result;
+}
+
+BenchmarkResult Measure(const QString &benchmark, const QString &program, const QString &unit, qint64 unitsPerIteration,
+                        const std::function<void()> &setup, const std::function<void()> &iteration, qint64 minimumMs, int minimumIterations)
+{
+    BenchmarkResult result{ benchmark, program, unit, unitsPerIteration };
+    setup();
+    iteration();
+    //
+    const auto countAllocations = AllocationCountingSupported();
+    auto minimumNs = std::numeric_limits<qint64>::max();
+    qint64 totalNs = 0;
+    QElapsedTimer timer;
+    while (result.iterations < minimumIterations || totalNs < minimumMs * 1000000)
+    {
+        setup();
+        const auto before = CurrentAllocationCount();
+        timer.start();
+        iteration();
+        const auto ns = timer.nsecsElapsed();
+        if (result.iterations == 0 && countAllocations)
+        {
+            const auto after = CurrentAllocationCount();
+            result.allocations = after.allocations - before.allocations;
+            result.bytesAllocated = after.bytes - before.bytes;
+        }
+        minimumNs = qMin(minimumNs, ns);
+        totalNs += ns;
+        result.iterations++;
+    }
+    result.minimumNs = minimumNs;
+    result.meanNs = double(totalNs) / result.iterations;
+    return result;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+#include <functional>
+
+/// One benchmark measured over one program of the corpus.
+struct BenchmarkResult
+{
+    QString benchmark;
+    QString program;
+    /// What an iteration processes: lines, instructions or cells.
+    QString unit;
+    qint64 unitsPerIteration = 0;
+    qint64 iterations = 0;
+    /// The fastest iteration is the least disturbed by the rest of the system, it is the one compared between commits.
+    double minimumNs = 0;
+    double meanNs = 0;
+    /// Heap usage of one iteration, -1 when allocations cannot be counted on this platform.
+    qint64 allocations = -1;
+    qint64 bytesAllocated = -1;
+    //
+    QString Name() const
+    {
+        return benchmark + "/" + program;
+    }
+    double NsPerUnit() const
+    {
+        return unitsPerIteration > 0 ? minimumNs / unitsPerIteration : 0;
+    }
+    double UnitsPerSecond() const
+    {
+        return minimumNs > 0 ? unitsPerIteration * 1e9 / minimumNs : 0;
+    }
+    QJsonObject ToJson() const;
+    static BenchmarkResult FromJson(const QJsonObject &object);
+};
+
+/// Times iteration until it has run for minimumMs and at least minimumIterations times.
+///
+/// setup runs before every iteration and is not timed. A first iteration warms up caches and lazily built code, the allocations
+/// of the second one are counted.
+BenchmarkResult Measure(const QString &benchmark, const QString &program, const QString &unit, qint64 unitsPerIteration,
+                        const std::function<void()> &setup, const std::function<void()> &iteration, qint64 minimumMs,
+                        int minimumIterations = 3);
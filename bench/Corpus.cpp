@@ -0,0 +1,56 @@
+#include "Corpus.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+namespace
+{
+    QByteArray ReadResource(const QString &path)
+    {
+        QFile file(path);
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    }
+} // namespace
+
+QVector<CorpusProgram> LoadCorpus(const QVector<int> &syntheticSizes)
+{
+    QVector<CorpusProgram> corpus;
+    const QDir directory(":/corpus");
+    for (const auto &fileName : directory.entryList({ "*.asm" }, QDir::Files, QDir::Name))
+    {
+        const auto baseName = QFileInfo(fileName).completeBaseName();
+        // Programs using IN come with a <name>.in file.
+        corpus << CorpusProgram{ baseName, QString::fromUtf8(ReadResource(directory.filePath(fileName))),
+                                 ReadResource(directory.filePath(baseName + ".in")) };
+    }
+    for (const auto size : syntheticSizes)
+    {
+        corpus << CorpusProgram{ QString("synthetic-%1").arg(size), GenerateSyntheticProgram(size), {} };
+    }
+    return corpus;
+}
+
+QString GenerateSyntheticProgram(int lineCount)
+{
+    QString source;
+    auto line = 0;
+    for (auto block = 0; line < lineCount - 1; block++)
+    {
+        // Each block counts down from 8, so the program runs about 6 instructions per line.
+        const auto id = QString::number(block);
+        const auto slot = QString::number(block % 16);
+        const QString lines[] = { "; block " + id,  "LDM #8",       "STO counter", "loop" + id + ":", "LDD total" + slot, "ADD counter",
+                                  "STO total" + slot, "LDX table ; indexed", "AND #&7F", "LSL #1", "STX table+" + slot, "INC IX",
+                                  "LDD counter",      "DEC ACC",      "STO counter", "CMP #0",          "JPN loop" + id };
+        for (const auto &text : lines)
+        {
+            if (line++ == lineCount - 1)
+            {
+                break;
+            }
+            source += text + "\n";
+        }
+    }
+    return source + "END\n";
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/// A program the benchmarks run over.
+struct CorpusProgram
+{
+    QString name;
+    QString source;
+    /// Characters consumed by IN, the program is stopped when they run out.
+    QByteArray input;
+    //
+    int LineCount() const
+    {
+        return source.count('\n') + (source.endsWith('\n') ? 0 : 1);
+    }
+};
+
+/// The realistic programs bundled in corpus.qrc, in name order, then synthetic programs of the given numbers of lines.
+QVector<CorpusProgram> LoadCorpus(const QVector<int> &syntheticSizes);
+/// A program of the given number of lines, made of counted loops that use every kind of token. It always terminates.
+QString GenerateSyntheticProgram(int lineCount);
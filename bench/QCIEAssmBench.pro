@@ -0,0 +1,26 @@
+QT = core gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../core/core.pri)
+
+SOURCES += \
+    AllocationCounter.cpp \
+    Benchmark.cpp \
+    Corpus.cpp \
+    main.cpp \
+    ../core/Highlighter.cpp \
+    ../ui/TraceModel.cpp
+
+HEADERS += \
+    AllocationCounter.hpp \
+    Benchmark.hpp \
+    Corpus.hpp \
+    ../core/Highlighter.hpp \
+    ../ui/TraceModel.hpp
+
+RESOURCES += \
+    corpus.qrc
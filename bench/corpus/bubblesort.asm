@@ -0,0 +1,55 @@
+; Sorts a table of 16 numbers in ascending order with a bubble sort, rounds times.
+; There is no signed comparison, so the sign bit of the difference decides the swaps.
+LDM #20
+STO rounds
+round:
+; table = 100, 94, 88, ... in descending order
+LDM #100
+STO value
+LDR #0
+fill:
+LDD value
+STX table
+ADD #-6
+STO value
+INC IX
+LDD IX
+CMP #16
+JPN fill
+LDM #15
+STO passes
+pass:
+LDR #0
+compare:
+LDX table+1
+STO b
+LDX table
+STO a
+; difference = b - a
+LDD a
+XOR #&FF
+INC ACC
+ADD b
+AND #&80
+CMP #0
+JPE ordered
+LDD a
+STX table+1
+LDD b
+STX table
+ordered:
+INC IX
+LDD IX
+CMP #15
+JPN compare
+LDD passes
+DEC ACC
+STO passes
+CMP #0
+JPN pass
+LDD rounds
+DEC ACC
+STO rounds
+CMP #0
+JPN round
+END
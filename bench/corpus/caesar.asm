@@ -0,0 +1,28 @@
+; Shifts the upper case letters of the input by three places, until the input runs out.
+loop:
+IN
+STO character
+; Letters are between 65 and 90, so character - 65 must be positive and character - 91 negative
+ADD #-65
+AND #&80
+CMP #0
+JPN copy
+LDD character
+ADD #-91
+AND #&80
+CMP #0
+JPE copy
+LDD character
+ADD #3
+STO character
+ADD #-91
+AND #&80
+CMP #0
+JPN copy
+LDD character
+ADD #-26
+STO character
+copy:
+LDD character
+OUT
+JMP loop
@@ -0,0 +1,26 @@
+; Fills a table with the first 100 Fibonacci numbers modulo 256, rounds times.
+LDM #50
+STO rounds
+round:
+LDM #0
+STO fib
+LDM #1
+STO fib+1
+LDR #2
+next:
+; fib[IX] = fib[IX - 2] + fib[IX - 1], the index wraps within the block of fib
+LDX fib+255
+STO previous
+LDX fib+254
+ADD previous
+STX fib
+INC IX
+LDD IX
+CMP #100
+JPN next
+LDD rounds
+DEC ACC
+STO rounds
+CMP #0
+JPN round
+END
@@ -0,0 +1,38 @@
+; Greatest common divisor of a and b by repeated subtractions, rounds times.
+LDM #100
+STO rounds
+round:
+LDM #120
+STO a
+LDM #84
+STO b
+loop:
+LDD a
+CMP b
+JPE done
+; difference = a - b
+LDD b
+XOR #&FF
+INC ACC
+ADD a
+STO difference
+AND #&80
+CMP #0
+JPN negative
+LDD difference
+STO a
+JMP loop
+negative:
+; b = b - a
+LDD difference
+XOR #&FF
+INC ACC
+STO b
+JMP loop
+done:
+LDD rounds
+DEC ACC
+STO rounds
+CMP #0
+JPN round
+END
@@ -0,0 +1,37 @@
+; Prints a greeting, rounds times.
+LDM #100
+STO rounds
+round:
+LDM #72
+OUT
+LDM #69
+OUT
+LDM #76
+OUT
+OUT
+LDM #79
+OUT
+LDM #44
+OUT
+LDM #32
+OUT
+LDM #87
+OUT
+LDM #79
+OUT
+LDM #82
+OUT
+LDM #76
+OUT
+LDM #68
+OUT
+LDM #33
+OUT
+LDM #10
+OUT
+LDD rounds
+DEC ACC
+STO rounds
+CMP #0
+JPN round
+END
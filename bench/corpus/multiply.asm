@@ -0,0 +1,27 @@
+; Multiplies a by b with repeated additions, rounds times.
+LDM #13
+STO a
+LDM #11
+STO b
+LDM #100
+STO rounds
+round:
+LDM #0
+STO product
+LDD b
+STO counter
+add:
+LDD product
+ADD a
+STO product
+LDD counter
+DEC ACC
+STO counter
+CMP #0
+JPN add
+LDD rounds
+DEC ACC
+STO rounds
+CMP #0
+JPN round
+END
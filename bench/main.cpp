@@ -0,0 +1,497 @@
+#include "AllocationCounter.hpp"
+#include "Benchmark.hpp"
+#include "Corpus.hpp"
+#include "core/CIEAssemCompiled.hpp"
+#include "core/CIEAssemLanes.hpp"
+#include "core/CIEAssemLoader.hpp"
+#include "core/Highlighter.hpp"
+#include "ui/TraceModel.hpp"
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QGuiApplication>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+#include <cstdio>
+
+namespace
+{
+    /// Runs are cut off after this many cycles, no program of the corpus runs that long.
+    constexpr qint64 MAX_CYCLES = 100000000;
+    /// The trace benchmark records the first cycles only, a long trace is never formatted at once as the table shows the rows in view.
+    constexpr qint64 TRACE_CYCLES = 100000;
+    /// Inputs run by the lane benchmarks, as many test vectors as a submission is usually graded against.
+    constexpr int LANE_INPUTS = 32;
+
+    /// The highlighter before it used CIEAssemblyLexer, one unanchored regular expression pass per rule. Kept as the baseline of
+    /// highlight.
+    class RegexHighlighter : public QSyntaxHighlighter
+    {
+      public:
+        explicit RegexHighlighter(QTextDocument *parent) : QSyntaxHighlighter(parent)
+        {
+            const char *patterns[] = { R"(LD[MDIXR]|ST[OXI])", R"((IN|OUT))", R"((ADD|INC|DEC))", R"((CMP|JMP|JPE|JPN))", R"((AND|XOR|OR|LSL|LSR))",
+                                       R"(\b(IX|ACC)\b)",      R"(\bEND\b)", R"(\#(\d+|[Bb][0|1]{8}|\&[\dA-Fa-f]+))", R"(\w+:)", R"(\;.*$)" };
+            for (const auto pattern : patterns)
+            {
+                rules.append(QRegularExpression(pattern, QRegularExpression::ExtendedPatternSyntaxOption | QRegularExpression::CaseInsensitiveOption));
+            }
+            format.setForeground(QColor(Qt::red));
+        }
+
+      protected:
+        void highlightBlock(const QString &text) override
+        {
+            for (const auto &rule : qAsConst(rules))
+            {
+                auto matchIterator = rule.globalMatch(text);
+                while (matchIterator.hasNext())
+                {
+                    const auto match = matchIterator.next();
+                    setFormat(match.capturedStart(), match.capturedLength(), format);
+                }
+            }
+            setCurrentBlockState(0);
+        }
+
+      private:
+        QVector<QRegularExpression> rules;
+        QTextCharFormat format;
+    };
+
+    struct Options
+    {
+        QRegularExpression filter;
+        qint64 minimumMs = 200;
+    };
+
+    /// Measures every benchmark matching the filter over one program of the corpus.
+    void RunBenchmarks(const CorpusProgram &corpusProgram, const Options &options, const std::function<void(const BenchmarkResult &)> &report)
+    {
+        const auto &name = corpusProgram.name;
+        const auto &source = corpusProgram.source;
+        const auto &input = corpusProgram.input;
+        const auto lines = corpusProgram.LineCount();
+        const auto selected = [&](const QString &benchmark) { return options.filter.match(benchmark + "/" + name).hasMatch(); };
+        const auto measure = [&](const QString &benchmark, const QString &unit, qint64 units, const std::function<void()> &setup,
+                                 const std::function<void()> &iteration) {
+            if (selected(benchmark))
+            {
+                report(Measure(benchmark, name, unit, units, setup, iteration, options.minimumMs));
+            }
+        };
+        const auto noSetup = [] {};
+        //
+        CIEAssemblyProgram program;
+        QString errorMessage;
+        ParseAssemblyCode(source, &program, &errorMessage);
+        if (!errorMessage.isEmpty())
+        {
+            fprintf(stderr, "%s: Invalid CIE Assembly Code: %s\n", qPrintable(name), qPrintable(errorMessage));
+            return;
+        }
+        measure("parse", "line", lines, noSetup, [&] {
+            CIEAssemblyProgram parsed;
+            QString error;
+            ParseAssemblyCode(source, &parsed, &error);
+        });
+        measure("labels", "line", lines, noSetup, [&] { GetLabels(source); });
+        if (selected("load-compiled"))
+        {
+            // Compared to parse, in lines of the source the program was compiled from.
+            QTemporaryDir directory;
+            const auto fileName = directory.filePath(name + ".asmc");
+            if (!WriteCompiledProgram(fileName, program, { QString(), HashSource(source) }, &errorMessage))
+            {
+                fprintf(stderr, "%s: %s\n", qPrintable(name), qPrintable(errorMessage));
+                return;
+            }
+            measure("load-compiled", "line", lines, noSetup, [&] {
+                CIEAssemblyProgram loaded;
+                QString error;
+                ReadCompiledProgram(fileName, &loaded, nullptr, &error);
+            });
+        }
+        if (selected("load-file"))
+        {
+            // Compared to parse, which starts from the source already in memory.
+            QTemporaryDir directory;
+            QFile file(directory.filePath(name + ".asm"));
+            if (!file.open(QIODevice::WriteOnly) || file.write(source.toUtf8()) < 0)
+            {
+                fprintf(stderr, "%s: %s\n", qPrintable(name), qPrintable(file.errorString()));
+                return;
+            }
+            file.close();
+            measure("load-file", "line", lines, noSetup, [&] {
+                CIEAssemblyProgram loaded;
+                QString error;
+                LoadAssemblyFile(file.fileName(), &loaded, &error);
+            });
+        }
+        //
+        if (selected("highlight"))
+        {
+            // The highlighter schedules a rehighlight on construction, it never happens as there is no event loop.
+            QTextDocument document;
+            document.setPlainText(source);
+            CIEAsmHighlighter highlighter(&document);
+            measure("highlight", "line", lines, noSetup, [&] { highlighter.rehighlight(); });
+        }
+        if (selected("highlight-regex"))
+        {
+            // The same document through the regular expressions the lexer replaced.
+            QTextDocument document;
+            document.setPlainText(source);
+            RegexHighlighter highlighter(&document);
+            measure("highlight-regex", "line", lines, noSetup, [&] { highlighter.rehighlight(); });
+        }
+        //
+        CIEAssemblyMachine machine(program);
+        auto inputPosition = 0;
+        machine.SetInputHandler([&]() -> int { return inputPosition < input.size() ? quint8(input.at(inputPosition++)) : -1; });
+        machine.SetOutputHandler([](char) {});
+        const auto reset = [&] {
+            machine.Reset();
+            inputPosition = 0;
+        };
+        // Every engine executes the same instructions.
+        machine.Run(MAX_CYCLES);
+        const auto cycles = machine.Cycles();
+        //
+        measure("step", "instruction", cycles, reset, [&] {
+            while (machine.Cycles() < MAX_CYCLES && machine.Step())
+                ;
+        });
+        machine.SetEngine(ENGINE_THREADED);
+        measure("run-threaded", "instruction", cycles, reset, [&] { machine.Run(MAX_CYCLES); });
+        machine.SetOptimized(true);
+        measure("run-optimized", "instruction", cycles, reset, [&] { machine.Run(MAX_CYCLES); });
+        machine.SetOptimized(false);
+        if (CIEAssemblyJit::IsSupported())
+        {
+            machine.SetEngine(ENGINE_JIT);
+            measure("run-jit", "instruction", cycles, reset, [&] { machine.Run(MAX_CYCLES); });
+        }
+        {
+            CIEAssemblyProfile profile;
+            machine.SetProfile(&profile);
+            measure("run-profiled", "instruction", cycles, reset, [&] { machine.Run(MAX_CYCLES); });
+            machine.SetProfile(nullptr);
+        }
+        if (selected("run-lanes") || selected("run-batch"))
+        {
+            // The same input in every lane, so they all stay in lockstep. run-batch runs them one by one on a single thread.
+            const QVector<QByteArray> inputs(LANE_INPUTS, input);
+            CIEAssemblyLimits limits;
+            limits.maxCycles = MAX_CYCLES;
+            CIEAssemblyLanes lanes(program);
+            lanes.SetLimits(limits);
+            measure("run-lanes", "instruction", cycles * LANE_INPUTS, noSetup, [&] { lanes.Run(inputs); });
+            measure("run-batch", "instruction", cycles * LANE_INPUTS, noSetup, [&] {
+                for (const auto &laneInput : inputs)
+                {
+                    CIEAssemblyBatchRunner::RunJob({ program, laneInput, MAX_CYCLES, ENGINE_THREADED, false, CIEAssemblyLimits() });
+                }
+            });
+        }
+        //
+        if (selected("trace"))
+        {
+            CIEAssemblyTrace trace;
+            reset();
+            machine.SetTrace(&trace);
+            machine.Run(TRACE_CYCLES);
+            machine.SetTrace(nullptr);
+            TraceModel model(&machine, &trace);
+            model.Sync();
+            const auto rows = model.rowCount();
+            const auto columns = model.columnCount();
+            measure("trace", "cell", qint64(rows) * columns, noSetup, [&] {
+                for (auto column = 0; column < columns; column++)
+                {
+                    model.headerData(column, Qt::Horizontal);
+                }
+                for (auto row = 0; row < rows; row++)
+                {
+                    model.headerData(row, Qt::Vertical);
+                    for (auto column = 0; column < columns; column++)
+                    {
+                        model.data(model.index(row, column));
+                    }
+                }
+            });
+        }
+    }
+
+    /// A program of the given number of blocks, which all declare and use the same labels and operands.
+    QString RepeatedProgram(int blocks)
+    {
+        QString source;
+        for (auto i = 0; i < blocks; i++)
+        {
+            source += "loop:\n"
+                      "    LDD count\n"
+                      "    INC ACC\n"
+                      "    STO count ; next\n"
+                      "    CMP #&1F\n"
+                      "    JPN loop+1\n"
+                      "    ADD #b101\n"
+                      "    STO total+1\n";
+        }
+        return source + "END\n";
+    }
+
+    /// Parses programs of increasing lengths with the same labels and operands. Besides the arrays of the program, allocated
+    /// once, the allocations must not depend on the number of lines: returns false if they do.
+    bool CheckParseAllocations(FILE *file)
+    {
+        QVector<qint64> allocations;
+        for (const auto blocks : { 100, 10000 })
+        {
+            const auto source = RepeatedProgram(blocks);
+            CIEAssemblyProgram program;
+            QString errorMessage;
+            const auto before = CurrentAllocationCount();
+            ParseAssemblyCode(source, &program, &errorMessage);
+            const auto after = CurrentAllocationCount();
+            if (!errorMessage.isEmpty())
+            {
+                fprintf(file, "Invalid CIE Assembly Code: %s\n", qPrintable(errorMessage));
+                return false;
+            }
+            allocations << after.allocations - before.allocations;
+            fprintf(file, "parse %8d lines %10lld allocs %12lld B\n", source.count('\n'), after.allocations - before.allocations,
+                    after.bytes - before.bytes);
+        }
+        if (allocations.last() != allocations.first())
+        {
+            fprintf(file, "Parsing allocates per line.\n");
+            return false;
+        }
+        return true;
+    }
+
+    /// Describes the first difference between two programs, or returns an empty string when they are the same.
+    QString ProgramDifference(const CIEAssemblyProgram &a, const CIEAssemblyProgram &b)
+    {
+        if (a.labelNames != b.labelNames)
+        {
+            return "labels differ";
+        }
+        if (a.code.count() != b.code.count())
+        {
+            return QString("%1 and %2 instructions").arg(a.code.count()).arg(b.code.count());
+        }
+        for (auto i = 0; i < a.code.count(); i++)
+        {
+            const auto &x = a.code.at(i);
+            const auto &y = b.code.at(i);
+            const auto &dx = a.decoded.at(i);
+            const auto &dy = b.decoded.at(i);
+            if (x.labelId != y.labelId || x.labelOffset != y.labelOffset || x.opcode != y.opcode || x.operand != y.operand ||
+                dx.opcode != dy.opcode || dx.operandType != dy.operandType || dx.immediate != dy.immediate || dx.address != dy.address ||
+                dx.target != dy.target)
+            {
+                return QString("instruction %1 differs: %2 and %3").arg(i).arg(x.toString(a.labelNames), y.toString(b.labelNames));
+            }
+        }
+        if (a.memory.BlockNames() != b.memory.BlockNames() || a.memory.Symbols() != b.memory.Symbols())
+        {
+            return "memory differs";
+        }
+        return {};
+    }
+
+    /// Checks that LoadAssemblyFile assembles every program of the corpus as ParseAssemblyCode does, on one thread and on all.
+    bool CheckLoader(FILE *file, const QVector<CorpusProgram> &corpus)
+    {
+        auto same = true;
+        QTemporaryDir directory;
+        for (const auto &corpusProgram : corpus)
+        {
+            CIEAssemblyProgram parsed;
+            QString parseError;
+            ParseAssemblyCode(corpusProgram.source, &parsed, &parseError);
+            QFile sourceFile(directory.filePath(corpusProgram.name + ".asm"));
+            if (!sourceFile.open(QIODevice::WriteOnly) || sourceFile.write(corpusProgram.source.toUtf8()) < 0)
+            {
+                fprintf(file, "%s: %s\n", qPrintable(corpusProgram.name), qPrintable(sourceFile.errorString()));
+                return false;
+            }
+            sourceFile.close();
+            for (const auto threadCount : { 1, QThread::idealThreadCount() })
+            {
+                CIEAssemblyProgram loaded;
+                QString loadError;
+                LoadAssemblyFile(sourceFile.fileName(), &loaded, &loadError, nullptr, threadCount);
+                const auto difference = loadError != parseError ? QString("errors differ: \"%1\" and \"%2\"").arg(parseError, loadError)
+                                        : parseError.isEmpty() ? ProgramDifference(parsed, loaded)
+                                                               : QString();
+                fprintf(file, "load %-24s %2d threads %s\n", qPrintable(corpusProgram.name), threadCount,
+                        difference.isEmpty() ? "same as parse" : qPrintable(difference));
+                same = same && difference.isEmpty();
+            }
+        }
+        return same;
+    }
+
+    QString FormatCount(qint64 count)
+    {
+        return count < 0 ? QString("-") : QString::number(count);
+    }
+
+    void PrintResult(FILE *file, const BenchmarkResult &result)
+    {
+        fprintf(file, "%-28s %10.2f ns/%-12s %10.3f M%s/s %12s B %10s allocs\n", qPrintable(result.Name()), result.NsPerUnit(),
+                qPrintable(result.unit), result.UnitsPerSecond() / 1e6, qPrintable(result.unit), qPrintable(FormatCount(result.bytesAllocated)),
+                qPrintable(FormatCount(result.allocations)));
+    }
+
+    /// Prints the change of every result that is also in the baseline, a positive change is a slowdown.
+    void PrintComparison(FILE *file, const QVector<BenchmarkResult> &baseline, const QVector<BenchmarkResult> &results)
+    {
+        QHash<QString, BenchmarkResult> baselineResults;
+        for (const auto &result : baseline)
+        {
+            baselineResults.insert(result.Name(), result);
+        }
+        fprintf(file, "\n%-28s %14s %14s %9s %14s\n", "Compared to baseline", "baseline ns", "current ns", "change", "bytes change");
+        for (const auto &result : results)
+        {
+            if (!baselineResults.contains(result.Name()))
+            {
+                continue;
+            }
+            const auto &old = baselineResults[result.Name()];
+            const auto change = old.NsPerUnit() > 0 ? (result.NsPerUnit() / old.NsPerUnit() - 1) * 100 : 0;
+            const auto bytesChange = old.bytesAllocated < 0 || result.bytesAllocated < 0 ? QString("-")
+                                                                                         : QString::number(result.bytesAllocated - old.bytesAllocated);
+            fprintf(file, "%-28s %14.2f %14.2f %+8.1f%% %14s\n", qPrintable(result.Name()), old.NsPerUnit(), result.NsPerUnit(), change,
+                    qPrintable(bytesChange));
+        }
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // QTextDocument needs a GUI application, run with QT_QPA_PLATFORM=offscreen on machines without a display.
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("QCIEAssmBench");
+    //
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures parsing, highlighting, execution and trace rendering over a corpus of CIE assembly programs.");
+    parser.addHelpOption();
+    QCommandLineOption formatOption({ "f", "format" }, "Output format: text or json.", "format", "text");
+    QCommandLineOption outputOption({ "o", "output" }, "Also write the results as JSON to <file>.", "file");
+    QCommandLineOption filterOption("filter", "Only run the benchmarks whose <benchmark>/<program> name matches <regexp>.", "regexp", ".");
+    QCommandLineOption minimumTimeOption("min-time", "Repeat every benchmark for at least <ms> milliseconds.", "ms", "200");
+    QCommandLineOption sizesOption("sizes", "Comma-separated line counts of the synthetic programs.", "sizes", "1000,10000,100000");
+    QCommandLineOption compareOption("compare", "Compare the results with a JSON file written by an earlier run.", "file");
+    QCommandLineOption checkAllocationsOption("check-allocations",
+                                              "Only check that parsing a long program allocates as much as parsing a short one, exit with 1 if not.");
+    QCommandLineOption checkLoaderOption("check-loader",
+                                         "Only check that loading every program of the corpus from a file gives the same program as parsing it, "
+                                         "exit with 1 if not.");
+    parser.addOptions(
+        { formatOption, outputOption, filterOption, minimumTimeOption, sizesOption, compareOption, checkAllocationsOption, checkLoaderOption });
+    parser.process(app);
+    if (parser.isSet(checkAllocationsOption))
+    {
+        if (!AllocationCountingSupported())
+        {
+            printf("Allocations cannot be counted on this platform.\n");
+            return 0;
+        }
+        return CheckParseAllocations(stdout) ? 0 : 1;
+    }
+    //
+    const auto format = parser.value(formatOption);
+    if (format != "text" && format != "json")
+    {
+        fprintf(stderr, "Unknown format: %s\n", qPrintable(format));
+        return 1;
+    }
+    Options options;
+    options.filter.setPattern(parser.value(filterOption));
+    if (!options.filter.isValid())
+    {
+        fprintf(stderr, "Invalid filter: %s\n", qPrintable(options.filter.errorString()));
+        return 1;
+    }
+    options.minimumMs = parser.value(minimumTimeOption).toLongLong();
+    QVector<int> sizes;
+    for (const auto &size : parser.value(sizesOption).split(',', Qt::SkipEmptyParts))
+    {
+        sizes << size.toInt();
+    }
+    if (parser.isSet(checkLoaderOption))
+    {
+        return CheckLoader(stdout, LoadCorpus(sizes)) ? 0 : 1;
+    }
+    QVector<BenchmarkResult> baseline;
+    if (parser.isSet(compareOption))
+    {
+        QFile baselineFile(parser.value(compareOption));
+        if (!baselineFile.open(QIODevice::ReadOnly))
+        {
+            fprintf(stderr, "Cannot open %s: %s\n", qPrintable(baselineFile.fileName()), qPrintable(baselineFile.errorString()));
+            return 1;
+        }
+        for (const auto &value : QJsonDocument::fromJson(baselineFile.readAll()).object()["results"].toArray())
+        {
+            baseline << BenchmarkResult::FromJson(value.toObject());
+        }
+    }
+    //
+    // JSON goes to stdout alone, so it can be redirected to a file.
+    const auto json = format == "json";
+    const auto log = json ? stderr : stdout;
+    if (!AllocationCountingSupported())
+    {
+        fprintf(log, "Allocations cannot be counted on this platform.\n");
+    }
+    QVector<BenchmarkResult> results;
+    for (const auto &program : LoadCorpus(sizes))
+    {
+        RunBenchmarks(program, options, [&](const BenchmarkResult &result) {
+            PrintResult(log, result);
+            fflush(log);
+            results << result;
+        });
+    }
+    if (!baseline.isEmpty())
+    {
+        PrintComparison(log, baseline, results);
+    }
+    //
+    QJsonArray resultArray;
+    for (const auto &result : results)
+    {
+        resultArray << result.ToJson();
+    }
+    QJsonObject report;
+    report["version"] = 1;
+    report["qt"] = qVersion();
+    report["jit"] = CIEAssemblyJit::IsSupported();
+    report["min_time_ms"] = options.minimumMs;
+    report["results"] = resultArray;
+    const auto reportData = QJsonDocument(report).toJson();
+    if (json)
+    {
+        fwrite(reportData.constData(), 1, reportData.size(), stdout);
+    }
+    if (parser.isSet(outputOption))
+    {
+        QFile outputFile(parser.value(outputOption));
+        if (!outputFile.open(QIODevice::WriteOnly) || outputFile.write(reportData) != reportData.size())
+        {
+            fprintf(stderr, "Cannot write %s: %s\n", qPrintable(outputFile.fileName()), qPrintable(outputFile.errorString()));
+            return 1;
+        }
+    }
+    return 0;
+}
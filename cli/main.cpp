@@ -0,0 +1,645 @@
+#include "core/CIEAssemBatch.hpp"
+#include "core/CIEAssemCompiled.hpp"
+#include "core/CIEAssemExplore.hpp"
+#include "core/CIEAssemLanes.hpp"
+#include "core/CIEAssemLoader.hpp"
+#include "core/CIEAssemOptimizer.hpp"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <cstdio>
+
+// Exit codes of the runner.
+enum ExitCode
+{
+    EXIT_OK = 0,
+    EXIT_USAGE = 1,
+    EXIT_ASSEMBLE_ERROR = 2,
+    EXIT_RUNTIME_ERROR = 3,
+    EXIT_BREAK = 4,
+    EXIT_LIMIT = 5,
+    EXIT_DIVERGENCE = 6
+};
+
+namespace
+{
+    /// The 0-based source line of every instruction, as given by LoadAssemblyFile.
+    QVector<int> InstructionLines(const QString &code)
+    {
+        const auto lines = code.split('\n');
+        QVector<int> instructionLines;
+        for (auto i = 0; i < lines.count(); i++)
+        {
+            if (ParseAssemblyLine(lines.at(i)).type == LINE_INSTRUCTION)
+            {
+                instructionLines << i;
+            }
+        }
+        return instructionLines;
+    }
+
+    /// Index of the instruction on a 1-based source line, or of the first instruction after it, -1 if there is none.
+    int InstructionAtLine(const QVector<int> &instructionLines, int line)
+    {
+        const auto instruction = std::lower_bound(instructionLines.begin(), instructionLines.end(), line - 1);
+        return instruction == instructionLines.end() ? -1 : int(instruction - instructionLines.begin());
+    }
+
+    /// Adds the breakpoints and watchpoints given as "<location> [if <condition>]" on the command line.
+    bool ParseBreakpoints(const QStringList &breaks, const QStringList &watches, const QVector<int> &instructionLines,
+                          const CIEAssemblyProgram &program, CIEAssemblyBreakpoints *breakpoints, QString *errorMessage)
+    {
+        const auto parse = [&](const QString &spec, QString *location, CIEAssemblyCondition *condition) {
+            const auto ifIndex = spec.indexOf(" if ");
+            *location = (ifIndex < 0 ? spec : spec.left(ifIndex)).trimmed();
+            return ParseCondition(ifIndex < 0 ? QString() : spec.mid(ifIndex + 4), program.memory, condition, errorMessage);
+        };
+        QString location;
+        CIEAssemblyCondition condition;
+        for (const auto &spec : breaks)
+        {
+            if (!parse(spec, &location, &condition))
+            {
+                return false;
+            }
+            auto isLine = false;
+            const auto line = location.toInt(&isLine);
+            const auto instruction = isLine ? InstructionAtLine(instructionLines, line) : FindInstruction(program, location);
+            if (instruction < 0)
+            {
+                *errorMessage = "No instruction at \"" + location + "\".";
+                return false;
+            }
+            breakpoints->SetBreakpoint(instruction, condition);
+        }
+        for (const auto &spec : watches)
+        {
+            if (!parse(spec, &location, &condition))
+            {
+                return false;
+            }
+            const auto address = program.memory.Find(location);
+            if (address < 0)
+            {
+                *errorMessage = "\"" + location + "\" is not used by the program.";
+                return false;
+            }
+            breakpoints->SetWatchpoint(address, condition);
+        }
+        return true;
+    }
+    /// Tells why the machine stopped early, if it did.
+    void PrintBreak(const CIEAssemblyBreak &lastBreak, const CIEAssemblyProgram &program, const CIEAssemblyMemory &memory,
+                    const CIEAssemblyLimits &limits)
+    {
+        if (lastBreak.kind == CIEAssemblyBreak::BREAK_NONE)
+        {
+            return;
+        }
+        const auto instruction = program.code.at(lastBreak.instruction).toString(program.labelNames);
+        switch (lastBreak.kind)
+        {
+            case CIEAssemblyBreak::BREAK_BREAKPOINT: fprintf(stderr, "Breakpoint before %s\n", qPrintable(instruction)); break;
+            case CIEAssemblyBreak::BREAK_WATCHPOINT:
+                fprintf(stderr, "Watchpoint on %s, written by %s\n", qPrintable(memory.NameOf(lastBreak.address)), qPrintable(instruction));
+                break;
+            case CIEAssemblyBreak::BREAK_CYCLE_LIMIT:
+                fprintf(stderr, "Stopped before %s: the cycle limit of %lld was reached.\n", qPrintable(instruction), limits.maxCycles);
+                break;
+            case CIEAssemblyBreak::BREAK_TIME_LIMIT:
+                fprintf(stderr, "Stopped before %s: the time limit of %lld ms was reached.\n", qPrintable(instruction), limits.timeoutMs);
+                break;
+            case CIEAssemblyBreak::BREAK_LOOP:
+                fprintf(stderr, "Infinite loop: after the jump %s, the machine is in the same state as %lld cycles before.\n", qPrintable(instruction),
+                        lastBreak.period);
+                break;
+            case CIEAssemblyBreak::BREAK_NONE: break;
+        }
+    }
+
+    /// Input or output characters in double quotes, with the unprintable ones escaped.
+    QString Quoted(const QByteArray &bytes)
+    {
+        QString quoted = "\"";
+        for (const auto c : bytes)
+        {
+            const auto byte = quint8(c);
+            if (byte >= 0x20 && byte < 0x7F && c != '"' && c != '\\')
+            {
+                quoted += QChar(byte);
+            }
+            else
+            {
+                quoted += QString("\\x%1").arg(int(byte), 2, 16, QChar('0'));
+            }
+        }
+        return quoted + "\"";
+    }
+
+    /// How a run of --explore ended.
+    QString Ending(const CIEAssemblyBatchResult &result)
+    {
+        if (result.cir < 0)
+        {
+            return "ran out of input";
+        }
+        switch (result.lastBreak.kind)
+        {
+            case CIEAssemblyBreak::BREAK_CYCLE_LIMIT: return "reached the cycle limit";
+            case CIEAssemblyBreak::BREAK_TIME_LIMIT: return "reached the time limit";
+            case CIEAssemblyBreak::BREAK_LOOP: return "looped forever";
+            default: return "finished";
+        }
+    }
+
+    /// Prints what --explore found, returns the exit code.
+    int PrintExploreReport(const CIEAssemblyExploreReport &report, const QStringList &sources, int depth)
+    {
+        printf("Explored %lld input sequences of at most %d characters in %lld runs between IN, %lld cycles.\n", report.sequences, depth,
+               report.segments, report.executedCycles);
+        for (auto i = 0; i < sources.count(); i++)
+        {
+            const auto &program = report.programs.at(i);
+            printf("==> %s <==\n", qPrintable(sources.at(i)));
+            printf("Finished: %lld, ran out of input: %lld, stopped by a limit: %lld\n", program.finished, program.outOfInput, program.crashed);
+            if (program.cycles.isEmpty())
+            {
+                continue;
+            }
+            // The median and the mean are weighted by the number of sequences.
+            qint64 median = -1;
+            qint64 seen = 0;
+            double total = 0;
+            for (auto it = program.cycles.constBegin(); it != program.cycles.constEnd(); ++it)
+            {
+                seen += it.value();
+                total += double(it.key()) * it.value();
+                if (median < 0 && seen * 2 >= report.sequences)
+                {
+                    median = it.key();
+                }
+            }
+            printf("Cycles: min %lld, median %lld, mean %.1f, max %lld\n", program.cycles.firstKey(), median, total / report.sequences,
+                   program.cycles.lastKey());
+            // Sequences by cycles, in ranges from a power of two to the next one, 0 on its own.
+            QMap<qint64, qint64> ranges;
+            for (auto it = program.cycles.constBegin(); it != program.cycles.constEnd(); ++it)
+            {
+                qint64 low = it.key() > 0 ? 1 : 0;
+                while (low > 0 && low * 2 <= it.key())
+                {
+                    low *= 2;
+                }
+                ranges[low] += it.value();
+            }
+            for (auto it = ranges.constBegin(); it != ranges.constEnd(); ++it)
+            {
+                printf("  %10lld - %-10lld %14lld  %5.1f%%\n", it.key(), qMax<qint64>(0, it.key() * 2 - 1), it.value(),
+                       100.0 * it.value() / report.sequences);
+            }
+        }
+        const auto printExamples = [&](const char *title, qint64 count, const QVector<CIEAssemblyExploreCase> &examples) {
+            printf("%s: %lld sequences\n", title, count);
+            for (const auto &example : examples)
+            {
+                printf("  input %s%s\n", qPrintable(Quoted(example.input)),
+                       example.sequences > 1 ? qPrintable(QString(" and %1 longer inputs starting with it").arg(example.sequences - 1)) : "");
+                for (auto i = 0; i < sources.count(); i++)
+                {
+                    const auto &result = example.results.at(i);
+                    printf("    %s: wrote %s and %s after %lld cycles\n", qPrintable(sources.at(i)), qPrintable(Quoted(result.output)),
+                           qPrintable(Ending(result)), result.cycles);
+                }
+            }
+        };
+        if (sources.count() > 1)
+        {
+            printExamples("Divergences", report.divergences, report.divergenceExamples);
+        }
+        printExamples("Crashes", report.crashes, report.crashExamples);
+        if (report.divergences > 0)
+        {
+            return EXIT_DIVERGENCE;
+        }
+        return report.crashes > 0 ? EXIT_LIMIT : EXIT_OK;
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("QCIEAssmRunner");
+    //
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs a CIE assembly program without the GUI.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("sources", "The .asm files, or files compiled with --compile, to run. Several files are run concurrently.",
+                                 "<source> [sources...]");
+    QCommandLineOption inputOption({ "i", "input" }, "Read IN from <file> instead of stdin.", "file");
+    QCommandLineOption baseOption({ "b", "base" }, "Number format of the memory dump: dec, hex, bin or ascii.", "base", "dec");
+    QCommandLineOption quietOption({ "q", "quiet" }, "Do not print the memory dump and the cycle count.");
+    QCommandLineOption jobsOption({ "j", "jobs" }, "Run at most <n> programs at the same time.", "n", QString::number(QThread::idealThreadCount()));
+    QCommandLineOption statsOption("stats", "Print the number of executed instructions and the throughput.");
+    QCommandLineOption engineOption("engine", "Execution engine: threaded, jit or step, step only runs a single program.", "engine", "threaded");
+    QCommandLineOption optimizeOption("optimize", "Run common instruction sequences as superinstructions in the threaded engine. "
+                                                  "With --stats, print how many dispatches they saved.");
+    QCommandLineOption profileOption("profile", "Write execution counts as JSON to <file>, only for a single program.", "file");
+    QCommandLineOption breakOption("break",
+                                   "Stop before the instruction at <location>, a line number, a label or label+N, only for a single program. "
+                                   "Append \" if <condition>\", such as \"loop if ACC == #10\", to stop only when the condition holds.",
+                                   "location");
+    QCommandLineOption watchOption("watch", "Stop after an instruction writes <address>, with an optional \" if <condition>\" like --break.",
+                                   "address");
+    QCommandLineOption maxCyclesOption("max-cycles", "Stop a program after <n> instructions.", "n");
+    QCommandLineOption timeoutOption("timeout", "Stop a program after running for <ms> milliseconds.", "ms");
+    QCommandLineOption detectLoopsOption("detect-loops", "Stop a program as soon as it comes back to an earlier state, so it would never end.");
+    QCommandLineOption compileOption("compile", "Write the assembled program to <file> instead of running it, only for a single program. "
+                                                "The compiled file runs without parsing the source again.",
+                                     "file");
+    QCommandLineOption tapeOption("tape",
+                                  "Run a single program once per <file>, which gives the input of that run, instead of reading IN from stdin. "
+                                  "The runs execute together in lockstep. With --stats, print how many left the lockstep.",
+                                  "file");
+    QCommandLineOption exploreOption("explore",
+                                     "Run the program over every input of at most <depth> characters, each one of the 256 bytes, and report how "
+                                     "it ends and the cycles it takes. With several programs, compare their outputs and report the inputs on "
+                                     "which they differ. A prefix of the inputs is run once for all the inputs starting with it. Without "
+                                     "--max-cycles, every run stops after 1000000 cycles.",
+                                     "depth");
+    parser.addOptions({ inputOption, baseOption, quietOption, jobsOption, statsOption, engineOption, optimizeOption, profileOption, breakOption,
+                        watchOption, maxCyclesOption, timeoutOption, detectLoopsOption, compileOption, tapeOption, exploreOption });
+    parser.process(app);
+    //
+    if (parser.positionalArguments().isEmpty())
+    {
+        parser.showHelp(EXIT_USAGE);
+    }
+    //
+    NumberBase base;
+    const auto baseName = parser.value(baseOption);
+    if (baseName == "dec")
+        base = BASE10;
+    else if (baseName == "hex")
+        base = BASE16;
+    else if (baseName == "bin")
+        base = BASE2;
+    else if (baseName == "ascii")
+        base = ASCII;
+    else
+    {
+        fprintf(stderr, "Unknown number base: %s\n", qPrintable(baseName));
+        return EXIT_USAGE;
+    }
+    const auto quiet = parser.isSet(quietOption);
+    const auto stats = parser.isSet(statsOption);
+    const auto optimize = parser.isSet(optimizeOption);
+    const auto engine = parser.value(engineOption);
+    if (engine != "threaded" && engine != "jit" && engine != "step")
+    {
+        fprintf(stderr, "Unknown engine: %s\n", qPrintable(engine));
+        return EXIT_USAGE;
+    }
+    CIEAssemblyLimits limits;
+    limits.detectLoops = parser.isSet(detectLoopsOption);
+    const auto parseLimit = [&](const QCommandLineOption &option, const char *name, qint64 *limit) {
+        auto ok = true;
+        if (parser.isSet(option) && ((*limit = parser.value(option).toLongLong(&ok)) < 0 || !ok))
+        {
+            fprintf(stderr, "Invalid %s: %s\n", name, qPrintable(parser.value(option)));
+            return false;
+        }
+        return true;
+    };
+    if (!parseLimit(maxCyclesOption, "cycle limit", &limits.maxCycles) || !parseLimit(timeoutOption, "timeout", &limits.timeoutMs))
+    {
+        return EXIT_USAGE;
+    }
+    //
+    FILE *input = stdin;
+    if (parser.isSet(inputOption))
+    {
+        input = fopen(qPrintable(parser.value(inputOption)), "rb");
+        if (!input)
+        {
+            fprintf(stderr, "Cannot open %s\n", qPrintable(parser.value(inputOption)));
+            return EXIT_USAGE;
+        }
+    }
+    //
+    const auto sources = parser.positionalArguments();
+    const auto breaks = parser.values(breakOption);
+    const auto watches = parser.values(watchOption);
+    if ((!breaks.isEmpty() || !watches.isEmpty()) && sources.count() > 1)
+    {
+        fprintf(stderr, "Breakpoints and watchpoints need a single program.\n");
+        return EXIT_USAGE;
+    }
+    if (parser.isSet(compileOption) && sources.count() > 1)
+    {
+        fprintf(stderr, "--compile needs a single program.\n");
+        return EXIT_USAGE;
+    }
+    const auto tapes = parser.values(tapeOption);
+    if (!tapes.isEmpty() && (sources.count() > 1 || parser.isSet(inputOption)))
+    {
+        fprintf(stderr, "--tape needs a single program, and replaces --input.\n");
+        return EXIT_USAGE;
+    }
+    if (!tapes.isEmpty() && (!breaks.isEmpty() || !watches.isEmpty() || parser.isSet(profileOption) || engine == "step"))
+    {
+        fprintf(stderr, "--tape cannot be used with breakpoints, watchpoints, --profile or the step engine.\n");
+        return EXIT_USAGE;
+    }
+    const auto explore = parser.isSet(exploreOption);
+    auto exploreDepth = 0;
+    if (explore)
+    {
+        auto ok = true;
+        exploreDepth = parser.value(exploreOption).toInt(&ok);
+        if (!ok || exploreDepth < 0 || exploreDepth > CIEAssemblyExploreOptions::MAX_DEPTH)
+        {
+            fprintf(stderr, "Invalid depth: %s, it must be between 0 and %d.\n", qPrintable(parser.value(exploreOption)),
+                    CIEAssemblyExploreOptions::MAX_DEPTH);
+            return EXIT_USAGE;
+        }
+        if (!tapes.isEmpty() || !breaks.isEmpty() || !watches.isEmpty() || parser.isSet(profileOption) || parser.isSet(compileOption) ||
+            parser.isSet(timeoutOption) || engine == "step")
+        {
+            fprintf(stderr, "--explore cannot be used with --tape, breakpoints, watchpoints, --profile, --compile, --timeout or the step "
+                            "engine.\n");
+            return EXIT_USAGE;
+        }
+    }
+    QVector<CIEAssemblyProgram> programs;
+    CIEAssemblyBreakpoints breakpoints;
+    CIEAssemblySourceInfo sourceInfo;
+    for (const auto &source : sources)
+    {
+        QString errorMessage;
+        CIEAssemblyProgram program;
+        // Line breakpoints need the lines of the instructions, without the source a compiled file only has labels.
+        QVector<int> instructionLines;
+        if (IsCompiledProgram(source))
+        {
+            if (!ReadCompiledProgram(source, &program, &sourceInfo, &errorMessage))
+            {
+                fprintf(stderr, "%s\n", qPrintable(errorMessage));
+                return EXIT_ASSEMBLE_ERROR;
+            }
+            // The source is not needed, but if it is still there it must be the one the file was compiled from.
+            QFile originalFile(sourceInfo.fileName);
+            if (!sourceInfo.fileName.isEmpty() && originalFile.open(QIODevice::ReadOnly))
+            {
+                const auto code = QString::fromUtf8(originalFile.readAll());
+                if (HashSource(code) != sourceInfo.hash)
+                {
+                    fprintf(stderr, "%s: %s has changed since it was compiled, compile it again.\n", qPrintable(source),
+                            qPrintable(sourceInfo.fileName));
+                    return EXIT_ASSEMBLE_ERROR;
+                }
+                instructionLines = InstructionLines(code);
+            }
+        }
+        else
+        {
+            QFile sourceFile(source);
+            if (!sourceFile.open(QIODevice::ReadOnly))
+            {
+                fprintf(stderr, "Cannot open %s: %s\n", qPrintable(source), qPrintable(sourceFile.errorString()));
+                return EXIT_USAGE;
+            }
+            // Huge generated sources are never read into a single string, only the compiled format needs the hash of the text.
+            if (!LoadAssemblyFile(source, &program, &errorMessage, &instructionLines))
+            {
+                fprintf(stderr, "%s: Invalid CIE Assembly Code: %s\n", qPrintable(source), qPrintable(errorMessage));
+                return EXIT_ASSEMBLE_ERROR;
+            }
+            if (parser.isSet(compileOption))
+            {
+                sourceInfo = { QFileInfo(source).absoluteFilePath(), HashSource(QString::fromUtf8(sourceFile.readAll())) };
+            }
+        }
+        if (!ParseBreakpoints(breaks, watches, instructionLines, program, &breakpoints, &errorMessage))
+        {
+            fprintf(stderr, "%s: %s\n", qPrintable(source), qPrintable(errorMessage));
+            return EXIT_USAGE;
+        }
+        programs << program;
+    }
+    if (parser.isSet(compileOption))
+    {
+        QString errorMessage;
+        if (!WriteCompiledProgram(parser.value(compileOption), programs.first(), sourceInfo, &errorMessage))
+        {
+            fprintf(stderr, "%s\n", qPrintable(errorMessage));
+            return EXIT_USAGE;
+        }
+        return EXIT_OK;
+    }
+    //
+    const auto printStats = [&](qint64 cycles, qint64 nsecs, qint64 savedDispatches) {
+        const auto seconds = nsecs / 1e9;
+        fprintf(stderr, "Executed %lld instructions in %.3f ms, %.1f M instructions/s\n", cycles, nsecs / 1e6,
+                seconds > 0 ? cycles / seconds / 1e6 : 0.0);
+        if (optimize)
+        {
+            fprintf(stderr, "Superinstructions and folded jumps saved %lld dispatches, %.1f%% of the instructions\n", savedDispatches,
+                    cycles > 0 ? 100.0 * savedDispatches / cycles : 0.0);
+        }
+    };
+    const auto printOptimization = [&](const CIEAssemblyProgram &program) {
+        if (optimize && stats)
+        {
+            const auto optimization = OptimizeProgram(program.decoded, {});
+            fprintf(stderr, "Optimized: %d superinstructions, %d folded jumps, %d unreachable instructions\n", optimization.superinstructions,
+                    optimization.foldedJumps, optimization.unreachable);
+        }
+    };
+    const auto printSummary = [&](const CIEAssemblyMemory &memory, qint64 cycles, int cir) {
+        if (!quiet)
+        {
+            for (const auto address : memory.Symbols())
+            {
+                fprintf(stderr, "%s = %s\n", qPrintable(memory.NameOf(address)), qPrintable(NumberToString(memory[address], base)));
+            }
+            fprintf(stderr, "Cycles: %lld\n", cycles);
+        }
+        if (cir < 0)
+        {
+            fprintf(stderr, "Stopped executing: no input left for IN.\n");
+        }
+    };
+    //
+    if (explore)
+    {
+        // The runs stop in front of every IN, so they always use the threaded code.
+        CIEAssemblyExploreOptions options;
+        options.depth = exploreDepth;
+        if (limits.maxCycles >= 0)
+        {
+            options.maxCycles = limits.maxCycles;
+        }
+        options.detectLoops = limits.detectLoops;
+        options.optimized = optimize;
+        options.threadCount = parser.value(jobsOption).toInt();
+        QElapsedTimer timer;
+        timer.start();
+        const auto report = ExplorePrograms(programs, options);
+        const auto nsecs = timer.nsecsElapsed();
+        const auto exitCode = PrintExploreReport(report, sources, exploreDepth);
+        if (stats)
+        {
+            printStats(report.executedCycles, nsecs, 0);
+        }
+        return exitCode;
+    }
+    if (programs.count() == 1 && tapes.isEmpty())
+    {
+        // A single program streams its input and output.
+        CIEAssemblyMachine machine(programs.first());
+        machine.SetEngine(engine == "jit" ? ENGINE_JIT : ENGINE_THREADED);
+        machine.SetOptimized(optimize);
+        machine.SetBreakpoints(breakpoints);
+        machine.SetLimits(limits);
+        machine.SetInputHandler([input]() -> int { return fgetc(input); });
+        machine.SetOutputHandler([](char c) { fputc(c, stdout); });
+        CIEAssemblyProfile profile;
+        if (parser.isSet(profileOption))
+        {
+            machine.SetProfile(&profile);
+        }
+        QElapsedTimer timer;
+        timer.start();
+        if (engine == "step")
+        {
+            // Step ignores breakpoints and limits, Run checks them.
+            const auto step = [&] {
+                return breakpoints.IsEmpty() && limits.IsEmpty() ? machine.Step()
+                                                                  : machine.Run(1) == 1 && machine.LastBreak().kind == CIEAssemblyBreak::BREAK_NONE;
+            };
+            while (step())
+                ;
+        }
+        else
+        {
+            machine.Run();
+        }
+        const auto nsecs = timer.nsecsElapsed();
+        fflush(stdout);
+        const auto &lastBreak = machine.LastBreak();
+        PrintBreak(lastBreak, machine.Program(), machine.Memory(), limits);
+        printSummary(machine.Memory(), machine.Cycles(), machine.CIR());
+        if (stats)
+        {
+            printOptimization(machine.Program());
+            printStats(machine.Cycles(), nsecs, machine.SavedDispatches());
+        }
+        if (parser.isSet(profileOption))
+        {
+            QFile profileFile(parser.value(profileOption));
+            const auto json = profile.ToJson(machine.Program(), machine.Memory());
+            if (!profileFile.open(QIODevice::WriteOnly) || profileFile.write(json) != json.size())
+            {
+                fprintf(stderr, "Cannot write %s: %s\n", qPrintable(profileFile.fileName()), qPrintable(profileFile.errorString()));
+                return EXIT_USAGE;
+            }
+        }
+        if (lastBreak.kind != CIEAssemblyBreak::BREAK_NONE)
+        {
+            return lastBreak.IsLimit() ? EXIT_LIMIT : EXIT_BREAK;
+        }
+        return machine.IsStopped() ? EXIT_RUNTIME_ERROR : EXIT_OK;
+    }
+    //
+    QVector<CIEAssemblyBatchResult> results;
+    QElapsedTimer timer;
+    qint64 nsecs = 0;
+    auto splitLanes = 0;
+    if (!tapes.isEmpty())
+    {
+        // One program gets the input of every tape, the runs execute in lockstep.
+        QVector<QByteArray> inputs;
+        for (const auto &tape : tapes)
+        {
+            QFile tapeFile(tape);
+            if (!tapeFile.open(QIODevice::ReadOnly))
+            {
+                fprintf(stderr, "Cannot open %s: %s\n", qPrintable(tape), qPrintable(tapeFile.errorString()));
+                return EXIT_USAGE;
+            }
+            inputs << tapeFile.readAll();
+        }
+        CIEAssemblyLanes lanes(programs.first());
+        lanes.SetEngine(engine == "jit" ? ENGINE_JIT : ENGINE_THREADED);
+        lanes.SetOptimized(optimize);
+        lanes.SetLimits(limits);
+        timer.start();
+        results = lanes.Run(inputs);
+        nsecs = timer.nsecsElapsed();
+        splitLanes = lanes.SplitLanes();
+    }
+    else
+    {
+        // Several programs get the same input, and run concurrently.
+        QByteArray inputData;
+        char buffer[4096];
+        for (size_t n; (n = fread(buffer, 1, sizeof(buffer), input)) > 0;)
+        {
+            inputData.append(buffer, int(n));
+        }
+        QVector<CIEAssemblyBatchJob> jobs;
+        for (const auto &program : programs)
+        {
+            jobs << CIEAssemblyBatchJob{ program, inputData, -1, engine == "jit" ? ENGINE_JIT : ENGINE_THREADED, optimize, limits };
+        }
+        CIEAssemblyBatchRunner runner(parser.value(jobsOption).toInt());
+        timer.start();
+        results = runner.Run(jobs);
+        nsecs = timer.nsecsElapsed();
+    }
+    //
+    auto exitCode = EXIT_OK;
+    for (auto i = 0; i < results.count(); i++)
+    {
+        const auto &result = results.at(i);
+        const auto &program = tapes.isEmpty() ? programs.at(i) : programs.first();
+        fprintf(stderr, "==> %s <==\n", qPrintable(tapes.isEmpty() ? sources.at(i) : tapes.at(i)));
+        fwrite(result.output.constData(), 1, result.output.size(), stdout);
+        fflush(stdout);
+        PrintBreak(result.lastBreak, program, result.memory, limits);
+        printSummary(result.memory, result.cycles, result.cir);
+        if (stats && tapes.isEmpty())
+        {
+            printOptimization(program);
+        }
+        if (result.lastBreak.IsLimit())
+        {
+            exitCode = EXIT_LIMIT;
+        }
+        else if (result.cir < 0)
+        {
+            exitCode = EXIT_RUNTIME_ERROR;
+        }
+    }
+    if (stats)
+    {
+        qint64 totalCycles = 0;
+        qint64 totalSavedDispatches = 0;
+        for (const auto &result : results)
+        {
+            totalCycles += result.cycles;
+            totalSavedDispatches += result.savedDispatches;
+        }
+        if (!tapes.isEmpty())
+        {
+            printOptimization(programs.first());
+            fprintf(stderr, "Lockstep: %d of %d runs split off to run on their own\n", splitLanes, int(results.count()));
+        }
+        printStats(totalCycles, nsecs, totalSavedDispatches);
+    }
+    return exitCode;
+}
@@ -0,0 +1,60 @@
+#include "CIEAssemBatch.hpp"
+
+#include <QRunnable>
+
+namespace CIEAssembly
+{
+    namespace
+    {
+        class BatchTask : public QRunnable
+        {
+          public:
+            BatchTask(const CIEAssemblyBatchJob &job, CIEAssemblyBatchResult *result) : job(job), result(result){};
+            void run() override
+            {
+                *result = CIEAssemblyBatchRunner::RunJob(job);
+            }
+
+          private:
+            const CIEAssemblyBatchJob &job;
+            CIEAssemblyBatchResult *result;
+        };
+    } // namespace
+
+    CIEAssemblyBatchRunner::CIEAssemblyBatchRunner(int threadCount)
+    {
+        pool.setMaxThreadCount(qMax(1, threadCount));
+    }
+
+    QVector<CIEAssemblyBatchResult> CIEAssemblyBatchRunner::Run(const QVector<CIEAssemblyBatchJob> &jobs)
+    {
+        QVector<CIEAssemblyBatchResult> results(jobs.count());
+        for (auto i = 0; i < jobs.count(); i++)
+        {
+            // The pool deletes the task once it has run.
+            pool.start(new BatchTask(jobs.at(i), &results[i]));
+        }
+        pool.waitForDone();
+        return results;
+    }
+
+    CIEAssemblyBatchResult CIEAssemblyBatchRunner::RunJob(const CIEAssemblyBatchJob &job)
+    {
+        CIEAssemblyBatchResult result;
+        CIEAssemblyMachine machine(job.program);
+        machine.SetEngine(job.engine);
+        machine.SetOptimized(job.optimized);
+        machine.SetLimits(job.limits);
+        auto inputPosition = 0;
+        machine.SetInputHandler([&]() -> int { return inputPosition < job.input.size() ? quint8(job.input.at(inputPosition++)) : -1; });
+        machine.SetOutputHandler([&](char c) { result.output.append(c); });
+        machine.Run(job.maxCycles);
+        //
+        result.memory = machine.Memory();
+        result.cycles = machine.Cycles();
+        result.cir = machine.CIR();
+        result.savedDispatches = machine.SavedDispatches();
+        result.lastBreak = machine.LastBreak();
+        return result;
+    }
+} // namespace CIEAssembly
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "CIEAssemMachine.hpp"
+
+#include <QByteArray>
+#include <QThread>
+#include <QThreadPool>
+
+namespace CIEAssembly
+{
+    struct CIEAssemblyBatchJob
+    {
+        CIEAssemblyProgram program;
+        /// Characters consumed by IN, in order.
+        QByteArray input;
+        /// Stop after this many cycles, negative for no limit.
+        qint64 maxCycles = -1;
+        CIEAssemblyEngine engine = ENGINE_THREADED;
+        /// See CIEAssemblyMachine::SetOptimized.
+        bool optimized = false;
+        CIEAssemblyLimits limits;
+    };
+
+    struct CIEAssemblyBatchResult
+    {
+        /// Characters written by OUT.
+        QByteArray output;
+        CIEAssemblyMemory memory;
+        qint64 cycles = 0;
+        /// CIR when the machine stopped, -1 if the program ran out of input.
+        int cir = 0;
+        qint64 savedDispatches = 0;
+        /// Set when a limit of the job stopped the program.
+        CIEAssemblyBreak lastBreak;
+    };
+
+    /// Runs independent programs concurrently, each job on its own CIEAssemblyMachine.
+    class CIEAssemblyBatchRunner
+    {
+      public:
+        explicit CIEAssemblyBatchRunner(int threadCount = QThread::idealThreadCount());
+        /// Blocks until every job has finished, results have the same indexes as jobs.
+        QVector<CIEAssemblyBatchResult> Run(const QVector<CIEAssemblyBatchJob> &jobs);
+        /// Runs one job on the calling thread.
+        static CIEAssemblyBatchResult RunJob(const CIEAssemblyBatchJob &job);
+
+      private:
+        QThreadPool pool;
+    };
+} // namespace CIEAssembly
@@ -0,0 +1,152 @@
+#include "CIEAssemBreakpoints.hpp"
+
+#include <algorithm>
+
+namespace CIEAssembly
+{
+    namespace
+    {
+        /// Decodes an operand like the operand of CMP, numbers are parsed the same way and symbols must already be in memory.
+        bool ParseOperand(const QString &text, const CIEAssemblyMemory &memory, CIEAssemblyCondition::Operand *operand, QString *errorMessage)
+        {
+            if (text.isEmpty())
+            {
+                *errorMessage = "A condition needs an operand on both sides of its operator.";
+                return false;
+            }
+            if (!text.startsWith('#'))
+            {
+                operand->address = memory.Find(text);
+                if (operand->address < 0)
+                {
+                    *errorMessage = "\"" + text + "\" is not used by the program.";
+                    return false;
+                }
+                return true;
+            }
+            CIEAssemblyInstruction instruction;
+            instruction.opcode = CMP;
+            instruction.operand = text;
+            const auto decoded = DecodeInstruction(instruction, nullptr, errorMessage);
+            operand->immediate = decoded.immediate;
+            return errorMessage->isEmpty();
+        }
+    } // namespace
+
+    void CIEAssemblyBreakpoints::SetBreakpoint(int instruction, const CIEAssemblyCondition &condition)
+    {
+        RemoveBreakpoint(instruction);
+        breakpoints.append({ instruction, condition });
+    }
+
+    void CIEAssemblyBreakpoints::RemoveBreakpoint(int instruction)
+    {
+        breakpoints.erase(std::remove_if(breakpoints.begin(), breakpoints.end(),
+                                         [instruction](const Breakpoint &breakpoint) { return breakpoint.instruction == instruction; }),
+                          breakpoints.end());
+    }
+
+    void CIEAssemblyBreakpoints::SetWatchpoint(int address, const CIEAssemblyCondition &condition)
+    {
+        RemoveWatchpoint(address);
+        watchpoints.append({ address, condition });
+    }
+
+    void CIEAssemblyBreakpoints::RemoveWatchpoint(int address)
+    {
+        watchpoints.erase(std::remove_if(watchpoints.begin(), watchpoints.end(),
+                                         [address](const Watchpoint &watchpoint) { return watchpoint.address == address; }),
+                          watchpoints.end());
+    }
+
+    void CIEAssemblyBreakpoints::Clear()
+    {
+        breakpoints.clear();
+        watchpoints.clear();
+    }
+
+    const CIEAssemblyBreakpoints::Breakpoint *CIEAssemblyBreakpoints::BreakpointAt(int instruction) const
+    {
+        for (const auto &breakpoint : breakpoints)
+        {
+            if (breakpoint.instruction == instruction)
+            {
+                return &breakpoint;
+            }
+        }
+        return nullptr;
+    }
+
+    const CIEAssemblyBreakpoints::Watchpoint *CIEAssemblyBreakpoints::WatchpointAt(int address) const
+    {
+        for (const auto &watchpoint : watchpoints)
+        {
+            if (watchpoint.address == address)
+            {
+                return &watchpoint;
+            }
+        }
+        return nullptr;
+    }
+
+    bool ParseCondition(const QString &text, const CIEAssemblyMemory &memory, CIEAssemblyCondition *condition, QString *errorMessage)
+    {
+        *condition = CIEAssemblyCondition();
+        const auto trimmed = text.trimmed();
+        if (trimmed.isEmpty())
+        {
+            return true;
+        }
+        // Two-character operators first, so "<=" is not read as "<" followed by "=".
+        static const QVector<QPair<QString, CIEAssemblyCondition::Operator>> operators{
+            { "==", CIEAssemblyCondition::OP_EQUAL },     { "!=", CIEAssemblyCondition::OP_NOT_EQUAL },
+            { "<=", CIEAssemblyCondition::OP_LESS_EQUAL }, { ">=", CIEAssemblyCondition::OP_GREATER_EQUAL },
+            { "<", CIEAssemblyCondition::OP_LESS },        { ">", CIEAssemblyCondition::OP_GREATER },
+        };
+        for (const auto &op : operators)
+        {
+            const auto index = trimmed.indexOf(op.first);
+            if (index < 0)
+            {
+                continue;
+            }
+            condition->op = op.second;
+            if (!ParseOperand(trimmed.left(index).trimmed(), memory, &condition->left, errorMessage) ||
+                !ParseOperand(trimmed.mid(index + op.first.length()).trimmed(), memory, &condition->right, errorMessage))
+            {
+                *errorMessage = "Invalid condition \"" + trimmed + "\": " + *errorMessage;
+                return false;
+            }
+            condition->text = trimmed;
+            return true;
+        }
+        *errorMessage = "Invalid condition \"" + trimmed + "\": expected ==, !=, <, <=, > or >= between two operands.";
+        return false;
+    }
+
+    int FindInstruction(const CIEAssemblyProgram &program, const QString &location)
+    {
+        // The same forms as jump targets, see LinkAssemblyCode.
+        auto labelId = program.labelNames.indexOf(location);
+        auto labelOffset = 0;
+        const auto plusIndex = location.lastIndexOf('+');
+        if (labelId < 0 && plusIndex > 0)
+        {
+            auto ok = false;
+            labelOffset = location.mid(plusIndex + 1).toInt(&ok);
+            labelId = ok && labelOffset > 0 ? program.labelNames.indexOf(location.left(plusIndex)) : -1;
+        }
+        if (labelId < 0)
+        {
+            return -1;
+        }
+        for (auto i = 0; i < program.code.count(); i++)
+        {
+            if (program.code.at(i).labelId == labelId && program.code.at(i).labelOffset == labelOffset)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+} // namespace CIEAssembly
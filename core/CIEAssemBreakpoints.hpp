@@ -0,0 +1,148 @@
+#pragma once
+
+#include "CIEAssemRunner.hpp"
+
+#include <QVector>
+
+namespace CIEAssembly
+{
+    /// A comparison such as "ACC == #10" or "x+1 < IX", checked when a breakpoint or a watchpoint is reached.
+    ///
+    /// Operands are memory slots or numbers, compared as CMP compares them: slots are signed characters, numbers are not truncated.
+    struct CIEAssemblyCondition
+    {
+        enum Operator
+        {
+            OP_EQUAL,
+            OP_NOT_EQUAL,
+            OP_LESS,
+            OP_LESS_EQUAL,
+            OP_GREATER,
+            OP_GREATER_EQUAL
+        };
+        struct Operand
+        {
+            /// Memory slot of the operand, -1 for a number.
+            int address = -1;
+            long immediate = 0;
+            long Value(const char *memory) const
+            {
+                return address >= 0 ? memory[address] : immediate;
+            }
+        };
+        //
+        Operand left;
+        Operator op = OP_EQUAL;
+        Operand right;
+        /// The condition as it was written, empty for a condition that always holds.
+        QString text;
+        //
+        bool IsAlways() const
+        {
+            return text.isEmpty();
+        }
+        bool Holds(const char *memory) const
+        {
+            if (IsAlways())
+            {
+                return true;
+            }
+            const auto a = left.Value(memory);
+            const auto b = right.Value(memory);
+            switch (op)
+            {
+                case OP_EQUAL: return a == b;
+                case OP_NOT_EQUAL: return a != b;
+                case OP_LESS: return a < b;
+                case OP_LESS_EQUAL: return a <= b;
+                case OP_GREATER: return a > b;
+                case OP_GREATER_EQUAL: return a >= b;
+            }
+            return false;
+        }
+    };
+
+    /// Why Run returned while the program was still running and the budget was not used up.
+    struct CIEAssemblyBreak
+    {
+        enum Kind
+        {
+            BREAK_NONE,
+            /// Stopped before executing a breakpoint instruction.
+            BREAK_BREAKPOINT,
+            /// Stopped after an instruction wrote a watched slot.
+            BREAK_WATCHPOINT,
+            // Stops caused by CIEAssemblyLimits, running again stops at once.
+            /// The program has run for the maximum number of cycles.
+            BREAK_CYCLE_LIMIT,
+            /// Run has spent the maximum time on the program.
+            BREAK_TIME_LIMIT,
+            /// A back-edge brought the machine back to an earlier state, so the program never ends.
+            BREAK_LOOP
+        };
+        Kind kind = BREAK_NONE;
+        /// The breakpoint instruction, the instruction that wrote the watched slot, the back-edge of a loop, or CIR at a limit.
+        int instruction = -1;
+        /// The watched slot, -1 for the other kinds.
+        int address = -1;
+        /// For BREAK_LOOP, the number of cycles between the two equal states, a multiple of the length of the loop.
+        qint64 period = 0;
+        //
+        bool IsLimit() const
+        {
+            return kind >= BREAK_CYCLE_LIMIT;
+        }
+    };
+
+    /// Breakpoints on instructions and watchpoints on memory slots, each with an optional condition.
+    ///
+    /// A breakpoint stops the machine before its instruction executes, if the condition holds then. A watchpoint stops it after
+    /// any instruction that writes the slot, even with the same value, if the condition holds afterwards.
+    class CIEAssemblyBreakpoints
+    {
+      public:
+        struct Breakpoint
+        {
+            int instruction;
+            CIEAssemblyCondition condition;
+        };
+        struct Watchpoint
+        {
+            int address;
+            CIEAssemblyCondition condition;
+        };
+        //
+        /// Adds a breakpoint, or replaces the condition of the breakpoint already on that instruction.
+        void SetBreakpoint(int instruction, const CIEAssemblyCondition &condition = {});
+        void RemoveBreakpoint(int instruction);
+        /// Adds a watchpoint, or replaces the condition of the watchpoint already on that slot.
+        void SetWatchpoint(int address, const CIEAssemblyCondition &condition = {});
+        void RemoveWatchpoint(int address);
+        void Clear();
+        bool IsEmpty() const
+        {
+            return breakpoints.isEmpty() && watchpoints.isEmpty();
+        }
+        const QVector<Breakpoint> &Breakpoints() const
+        {
+            return breakpoints;
+        }
+        const QVector<Watchpoint> &Watchpoints() const
+        {
+            return watchpoints;
+        }
+        /// The breakpoint on an instruction, null if there is none.
+        const Breakpoint *BreakpointAt(int instruction) const;
+        const Watchpoint *WatchpointAt(int address) const;
+
+      private:
+        QVector<Breakpoint> breakpoints;
+        QVector<Watchpoint> watchpoints;
+    };
+    //
+    /// Parses "<operand> <operator> <operand>" with ==, !=, <, <=, > or >=. Operands are symbols of memory, such as ACC, IX or x+1,
+    /// or numbers such as #10, #&0A or #B1010. An empty text gives a condition that always holds.
+    bool ParseCondition(const QString &text, const CIEAssemblyMemory &memory, CIEAssemblyCondition *condition, QString *errorMessage);
+    /// Index of the instruction at "label" or "label+N", -1 if there is no such instruction.
+    int FindInstruction(const CIEAssemblyProgram &program, const QString &location);
+} // namespace CIEAssembly
@@ -0,0 +1,388 @@
+#include "CIEAssemCompiled.hpp"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cstring>
+#include <limits>
+
+// Layout of a compiled program, every integer is little-endian:
+//
+//   header         HEADER_SIZE bytes, see the HEADER_ offsets below
+//   instructions   INSTRUCTION_SIZE bytes per instruction, see the INSTRUCTION_ offsets below
+//   strings        the end offset of every string, then their UTF-8 bytes; every other section refers to strings by index
+//   labels         the string index of every label name
+//   blocks         the string index of every memory block name, the first block holds the registers and has no name
+//   symbols        the interned memory slots, in the order they were interned
+//   memory         the initial contents of the memory
+//
+// Sections start at the offsets stored in the header, aligned to 8 bytes. A new version may add fields at the end of the header
+// and sections after the last one, readers check the version before anything else.
+namespace CIEAssembly
+{
+    namespace
+    {
+        constexpr char MAGIC[8] = { 'Q', 'C', 'I', 'E', 'A', 'S', 'M', '\0' };
+        constexpr quint32 VERSION = 1;
+        constexpr int HASH_SIZE = 32;
+        //
+        enum HeaderOffset
+        {
+            HEADER_MAGIC = 0,
+            HEADER_VERSION = 8,
+            HEADER_HEADER_SIZE = 12,
+            HEADER_SOURCE_HASH = 16,
+            HEADER_SOURCE_NAME = HEADER_SOURCE_HASH + HASH_SIZE,
+            HEADER_INSTRUCTION_COUNT = HEADER_SOURCE_NAME + 4,
+            HEADER_INSTRUCTIONS = HEADER_INSTRUCTION_COUNT + 4,
+            HEADER_STRING_COUNT = HEADER_INSTRUCTIONS + 4,
+            HEADER_STRINGS = HEADER_STRING_COUNT + 4,
+            HEADER_STRING_BYTES = HEADER_STRINGS + 4,
+            HEADER_LABEL_COUNT = HEADER_STRING_BYTES + 4,
+            HEADER_LABELS = HEADER_LABEL_COUNT + 4,
+            HEADER_BLOCK_COUNT = HEADER_LABELS + 4,
+            HEADER_BLOCKS = HEADER_BLOCK_COUNT + 4,
+            HEADER_SYMBOL_COUNT = HEADER_BLOCKS + 4,
+            HEADER_SYMBOLS = HEADER_SYMBOL_COUNT + 4,
+            HEADER_MEMORY_SIZE = HEADER_SYMBOLS + 4,
+            HEADER_MEMORY = HEADER_MEMORY_SIZE + 4,
+            HEADER_SIZE = HEADER_MEMORY + 4
+        };
+        enum InstructionOffset
+        {
+            INSTRUCTION_OPCODE = 0,
+            INSTRUCTION_OPERAND_TYPE = 1,
+            INSTRUCTION_ADDRESS = 4,
+            INSTRUCTION_TARGET = 8,
+            INSTRUCTION_LABEL_ID = 12,
+            INSTRUCTION_LABEL_OFFSET = 16,
+            /// String index of the operand as written, -1 for no operand.
+            INSTRUCTION_OPERAND = 20,
+            INSTRUCTION_IMMEDIATE = 24,
+            INSTRUCTION_SIZE = 32
+        };
+
+        /// Builds the file in memory, the sections are small next to what parsing the source costs.
+        class Writer
+        {
+          public:
+            explicit Writer(int headerSize) : data(headerSize, '\0')
+            {
+            }
+            template<typename T>
+            void Put(int offset, T value)
+            {
+                qToLittleEndian(value, data.data() + offset);
+            }
+            template<typename T>
+            void Append(T value)
+            {
+                char bytes[sizeof(T)];
+                qToLittleEndian(value, bytes);
+                data.append(bytes, sizeof(T));
+            }
+            /// Starts a section, returns its offset.
+            quint32 Align()
+            {
+                data.append((8 - data.size() % 8) % 8, '\0');
+                return quint32(data.size());
+            }
+            qint32 String(const QString &string)
+            {
+                auto index = stringIds.value(string, -1);
+                if (index < 0)
+                {
+                    index = strings.count();
+                    stringIds.insert(string, index);
+                    strings.append(string);
+                }
+                return index;
+            }
+            //
+            QByteArray data;
+            QStringList strings;
+
+          private:
+            QHash<QString, qint32> stringIds;
+        };
+
+        /// Reads the mapped file, every access is checked against its size.
+        class Reader
+        {
+          public:
+            Reader(const uchar *data, qint64 size) : data(data), size(size)
+            {
+            }
+            template<typename T>
+            T Get(qint64 offset) const
+            {
+                return qFromLittleEndian<T>(data + offset);
+            }
+            /// True if count items of itemSize bytes starting at offset are inside the file.
+            bool Contains(qint64 offset, qint64 count, qint64 itemSize) const
+            {
+                return offset >= 0 && count >= 0 && offset <= size && count * itemSize <= size - offset;
+            }
+            const uchar *const data;
+            const qint64 size;
+        };
+    } // namespace
+
+    QByteArray HashSource(const QString &code)
+    {
+        auto bytes = code.toUtf8();
+        bytes.replace("\r\n", "\n");
+        return QCryptographicHash::hash(bytes, QCryptographicHash::Sha256);
+    }
+
+    bool IsCompiledProgram(const QString &fileName)
+    {
+        QFile file(fileName);
+        return file.open(QIODevice::ReadOnly) && file.read(sizeof(MAGIC)) == QByteArray(MAGIC, sizeof(MAGIC));
+    }
+
+    bool WriteCompiledProgram(const QString &fileName, const CIEAssemblyProgram &program, const CIEAssemblySourceInfo &source,
+                              QString *errorMessage)
+    {
+        Writer writer(HEADER_SIZE);
+        memcpy(writer.data.data() + HEADER_MAGIC, MAGIC, sizeof(MAGIC));
+        writer.Put<quint32>(HEADER_VERSION, VERSION);
+        writer.Put<quint32>(HEADER_HEADER_SIZE, HEADER_SIZE);
+        memcpy(writer.data.data() + HEADER_SOURCE_HASH, source.hash.leftJustified(HASH_SIZE, '\0', true).constData(), HASH_SIZE);
+        const auto sourceName = source.fileName.isEmpty() ? QString() : QFileInfo(fileName).absoluteDir().relativeFilePath(source.fileName);
+        writer.Put<qint32>(HEADER_SOURCE_NAME, sourceName.isEmpty() ? -1 : writer.String(sourceName));
+        //
+        writer.Put<quint32>(HEADER_INSTRUCTION_COUNT, program.decoded.count());
+        writer.Put<quint32>(HEADER_INSTRUCTIONS, writer.Align());
+        for (auto i = 0; i < program.decoded.count(); i++)
+        {
+            const auto &instruction = program.code.at(i);
+            const auto &decoded = program.decoded.at(i);
+            writer.Append<quint8>(decoded.opcode);
+            writer.Append<quint8>(decoded.operandType);
+            writer.Append<quint16>(0);
+            writer.Append<qint32>(decoded.address);
+            writer.Append<qint32>(decoded.target);
+            writer.Append<qint32>(instruction.labelId);
+            writer.Append<qint32>(instruction.labelOffset);
+            writer.Append<qint32>(instruction.operand.isEmpty() ? -1 : writer.String(instruction.operand));
+            writer.Append<qint64>(decoded.immediate);
+        }
+        //
+        // Every string is known once the other sections are built, they are written after the strings but refer to them.
+        QVector<qint32> labels;
+        for (const auto &label : program.labelNames)
+        {
+            labels << writer.String(label);
+        }
+        QVector<qint32> blocks;
+        for (const auto &block : program.memory.BlockNames())
+        {
+            blocks << writer.String(block);
+        }
+        QVector<QByteArray> utf8Strings;
+        for (const auto &string : writer.strings)
+        {
+            utf8Strings << string.toUtf8();
+        }
+        writer.Put<quint32>(HEADER_STRING_COUNT, utf8Strings.count());
+        writer.Put<quint32>(HEADER_STRINGS, writer.Align());
+        quint32 stringEnd = 0;
+        for (const auto &string : utf8Strings)
+        {
+            stringEnd += string.size();
+            writer.Append<quint32>(stringEnd);
+        }
+        writer.Put<quint32>(HEADER_STRING_BYTES, stringEnd);
+        for (const auto &string : utf8Strings)
+        {
+            writer.data.append(string);
+        }
+        //
+        writer.Put<quint32>(HEADER_LABEL_COUNT, labels.count());
+        writer.Put<quint32>(HEADER_LABELS, writer.Align());
+        for (const auto label : labels)
+        {
+            writer.Append<qint32>(label);
+        }
+        writer.Put<quint32>(HEADER_BLOCK_COUNT, blocks.count());
+        writer.Put<quint32>(HEADER_BLOCKS, writer.Align());
+        for (const auto block : blocks)
+        {
+            writer.Append<qint32>(block);
+        }
+        writer.Put<quint32>(HEADER_SYMBOL_COUNT, program.memory.Symbols().count());
+        writer.Put<quint32>(HEADER_SYMBOLS, writer.Align());
+        for (const auto symbol : program.memory.Symbols())
+        {
+            writer.Append<qint32>(symbol);
+        }
+        writer.Put<quint32>(HEADER_MEMORY_SIZE, program.memory.Size());
+        writer.Put<quint32>(HEADER_MEMORY, writer.Align());
+        writer.data.append(program.memory.Data(), program.memory.Size());
+        //
+        QSaveFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly) || file.write(writer.data) != writer.data.size() || !file.commit())
+        {
+            *errorMessage = "Cannot write " + fileName + ": " + file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    bool ReadCompiledProgram(const QString &fileName, CIEAssemblyProgram *program, CIEAssemblySourceInfo *source, QString *errorMessage)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            *errorMessage = "Cannot open " + fileName + ": " + file.errorString();
+            return false;
+        }
+        const auto invalid = [&](const QString &reason) {
+            *errorMessage = fileName + " is not a valid compiled program: " + reason;
+            return false;
+        };
+        if (file.size() < HEADER_SIZE)
+        {
+            return invalid("the file is too short.");
+        }
+        const auto *mapped = file.map(0, file.size());
+        if (!mapped)
+        {
+            *errorMessage = "Cannot map " + fileName + ": " + file.errorString();
+            return false;
+        }
+        const Reader reader(mapped, file.size());
+        if (memcmp(mapped + HEADER_MAGIC, MAGIC, sizeof(MAGIC)) != 0)
+        {
+            return invalid("the file is not a compiled program.");
+        }
+        const auto version = reader.Get<quint32>(HEADER_VERSION);
+        if (version != VERSION)
+        {
+            *errorMessage = fileName + " has version " + QString::number(version) + " of the compiled format, only version " +
+                            QString::number(VERSION) + " is supported, compile it again.";
+            return false;
+        }
+        const auto headerSize = reader.Get<quint32>(HEADER_HEADER_SIZE);
+        const auto instructionCount = reader.Get<quint32>(HEADER_INSTRUCTION_COUNT);
+        const auto instructions = reader.Get<quint32>(HEADER_INSTRUCTIONS);
+        const auto stringCount = reader.Get<quint32>(HEADER_STRING_COUNT);
+        const auto strings = reader.Get<quint32>(HEADER_STRINGS);
+        const auto stringBytes = reader.Get<quint32>(HEADER_STRING_BYTES);
+        const auto labelCount = reader.Get<quint32>(HEADER_LABEL_COUNT);
+        const auto labels = reader.Get<quint32>(HEADER_LABELS);
+        const auto blockCount = reader.Get<quint32>(HEADER_BLOCK_COUNT);
+        const auto blocks = reader.Get<quint32>(HEADER_BLOCKS);
+        const auto symbolCount = reader.Get<quint32>(HEADER_SYMBOL_COUNT);
+        const auto symbols = reader.Get<quint32>(HEADER_SYMBOLS);
+        const auto memorySize = reader.Get<quint32>(HEADER_MEMORY_SIZE);
+        const auto memory = reader.Get<quint32>(HEADER_MEMORY);
+        if (headerSize < HEADER_SIZE || !reader.Contains(instructions, instructionCount, INSTRUCTION_SIZE) ||
+            !reader.Contains(strings, stringCount, 4) || !reader.Contains(strings + 4 * qint64(stringCount), stringBytes, 1) ||
+            !reader.Contains(labels, labelCount, 4) || !reader.Contains(blocks, blockCount, 4) || !reader.Contains(symbols, symbolCount, 4) ||
+            !reader.Contains(memory, memorySize, 1) || instructionCount > quint32(std::numeric_limits<int>::max() / INSTRUCTION_SIZE))
+        {
+            return invalid("a section is outside of the file.");
+        }
+        //
+        // Only the distinct strings are allocated, the instructions share them.
+        QStringList stringTable;
+        stringTable.reserve(stringCount);
+        const auto *stringData = reinterpret_cast<const char *>(mapped + strings + 4 * qint64(stringCount));
+        quint32 stringStart = 0;
+        for (quint32 i = 0; i < stringCount; i++)
+        {
+            const auto stringEnd = reader.Get<quint32>(strings + 4 * qint64(i));
+            if (stringEnd < stringStart || stringEnd > stringBytes)
+            {
+                return invalid("the string table is damaged.");
+            }
+            stringTable << QString::fromUtf8(stringData + stringStart, stringEnd - stringStart);
+            stringStart = stringEnd;
+        }
+        const auto readString = [&](qint64 offset, QString *value) {
+            const auto index = reader.Get<qint32>(offset);
+            if (index < -1 || index >= stringTable.count())
+            {
+                return false;
+            }
+            *value = index < 0 ? QString() : stringTable.at(index);
+            return true;
+        };
+        //
+        CIEAssemblyProgram loaded;
+        for (quint32 i = 0; i < labelCount; i++)
+        {
+            QString label;
+            if (!readString(labels + 4 * qint64(i), &label))
+            {
+                return invalid("a label name is damaged.");
+            }
+            loaded.labelNames << label;
+        }
+        QStringList blockNames;
+        for (quint32 i = 0; i < blockCount; i++)
+        {
+            QString block;
+            if (!readString(blocks + 4 * qint64(i), &block))
+            {
+                return invalid("a memory block name is damaged.");
+            }
+            blockNames << block;
+        }
+        QVector<int> symbolAddresses;
+        symbolAddresses.reserve(symbolCount);
+        for (quint32 i = 0; i < symbolCount; i++)
+        {
+            symbolAddresses << reader.Get<qint32>(symbols + 4 * qint64(i));
+        }
+        if (!loaded.memory.Restore(blockNames, symbolAddresses, reinterpret_cast<const char *>(mapped + memory), int(memorySize)))
+        {
+            return invalid("the memory does not match its symbols.");
+        }
+        //
+        loaded.code.resize(instructionCount);
+        loaded.decoded.resize(instructionCount);
+        for (quint32 i = 0; i < instructionCount; i++)
+        {
+            const auto offset = instructions + qint64(i) * INSTRUCTION_SIZE;
+            auto &instruction = loaded.code[i];
+            auto &decoded = loaded.decoded[i];
+            const auto opcode = reader.Get<quint8>(offset + INSTRUCTION_OPCODE);
+            const auto operandType = reader.Get<quint8>(offset + INSTRUCTION_OPERAND_TYPE);
+            decoded.address = reader.Get<qint32>(offset + INSTRUCTION_ADDRESS);
+            decoded.target = reader.Get<qint32>(offset + INSTRUCTION_TARGET);
+            decoded.immediate = long(reader.Get<qint64>(offset + INSTRUCTION_IMMEDIATE));
+            instruction.labelId = reader.Get<qint32>(offset + INSTRUCTION_LABEL_ID);
+            instruction.labelOffset = reader.Get<qint32>(offset + INSTRUCTION_LABEL_OFFSET);
+            // The engines trust the decoded program, anything they would index with is checked here.
+            if (opcode > END || operandType > NO_OPERAND || !readString(offset + INSTRUCTION_OPERAND, &instruction.operand) ||
+                instruction.labelId < 0 || instruction.labelId >= loaded.labelNames.count() || decoded.address < 0 ||
+                decoded.address >= loaded.memory.Size() ||
+                (IsJump(CIEAssemblyOpcode(opcode)) && (decoded.target < 0 || quint32(decoded.target) >= instructionCount)))
+            {
+                return invalid("instruction " + QString::number(i) + " is damaged.");
+            }
+            instruction.opcode = decoded.opcode = CIEAssemblyOpcode(opcode);
+            decoded.operandType = CIEAssemblyOperandType(operandType);
+        }
+        if (source)
+        {
+            source->hash = QByteArray(reinterpret_cast<const char *>(mapped + HEADER_SOURCE_HASH), HASH_SIZE);
+            if (!readString(HEADER_SOURCE_NAME, &source->fileName))
+            {
+                return invalid("the source name is damaged.");
+            }
+            if (!source->fileName.isEmpty())
+            {
+                source->fileName = QFileInfo(fileName).absoluteDir().absoluteFilePath(source->fileName);
+            }
+        }
+        *program = loaded;
+        return true;
+    }
+} // namespace CIEAssembly
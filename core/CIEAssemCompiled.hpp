@@ -0,0 +1,29 @@
+#pragma once
+
+#include "CIEAssemRunner.hpp"
+
+#include <QByteArray>
+
+namespace CIEAssembly
+{
+    /// Where a compiled program comes from, so a file compiled from an older source can be detected.
+    struct CIEAssemblySourceInfo
+    {
+        /// The source file, relative to the directory of the compiled file. Empty when the source was not saved in a file.
+        QString fileName;
+        /// HashSource of the source text.
+        QByteArray hash;
+    };
+    //
+    /// SHA-256 of the source text, line endings do not change it.
+    QByteArray HashSource(const QString &code);
+    /// True if the file starts like a compiled program, whatever its version.
+    bool IsCompiledProgram(const QString &fileName);
+    /// Writes an assembled and linked program in the compiled format, so it can be loaded without parsing the source again.
+    /// The file is replaced atomically, source.fileName is made relative to the directory of fileName.
+    bool WriteCompiledProgram(const QString &fileName, const CIEAssemblyProgram &program, const CIEAssemblySourceInfo &source,
+                              QString *errorMessage);
+    /// Maps a compiled program into memory and loads it, source is filled with the origin recorded in the file if it's not null.
+    /// The file is checked completely, a damaged file or a file of another version is reported instead of being loaded.
+    bool ReadCompiledProgram(const QString &fileName, CIEAssemblyProgram *program, CIEAssemblySourceInfo *source, QString *errorMessage);
+} // namespace CIEAssembly
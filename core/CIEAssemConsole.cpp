@@ -0,0 +1,56 @@
+#include "CIEAssemConsole.hpp"
+
+#include <QMutexLocker>
+#include <QtGlobal>
+
+namespace CIEAssembly
+{
+    void CIEAssemblyConsole::SetInput(const QByteArray &tape)
+    {
+        input = tape;
+        inputPosition = 0;
+    }
+
+    void CIEAssemblyConsole::AppendInput(const QByteArray &characters)
+    {
+        input.append(characters);
+    }
+
+    void CIEAssemblyConsole::Unread(int count)
+    {
+        inputPosition = qMax(0, inputPosition - count);
+    }
+
+    void CIEAssemblyConsole::Write(char c)
+    {
+        QMutexLocker locker(&outputMutex);
+        if (output.size() >= OUTPUT_CAPACITY)
+        {
+            // Dropping half at once keeps writing constant time on average.
+            const auto removed = OUTPUT_CAPACITY / 2;
+            output.remove(0, removed);
+            droppedOutput += removed;
+        }
+        output.append(c);
+    }
+
+    QByteArray CIEAssemblyConsole::TakeOutput(qint64 *dropped)
+    {
+        QMutexLocker locker(&outputMutex);
+        if (dropped)
+        {
+            *dropped = droppedOutput;
+        }
+        droppedOutput = 0;
+        QByteArray taken;
+        taken.swap(output);
+        return taken;
+    }
+
+    void CIEAssemblyConsole::ClearOutput()
+    {
+        QMutexLocker locker(&outputMutex);
+        output.clear();
+        droppedOutput = 0;
+    }
+} // namespace CIEAssembly
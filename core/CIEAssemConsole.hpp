@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QByteArray>
+#include <QMutex>
+
+namespace CIEAssembly
+{
+    /// The input tape read by IN and the output written by OUT, between the thread running a CIEAssemblyMachine and the GUI thread.
+    ///
+    /// The tape is only touched by the thread running the machine, or by any thread while the machine is not running. The
+    /// output is written one character at a time by OUT and taken in chunks by the thread showing it, at its own pace: the
+    /// machine never waits for the output to be shown. When the output is not taken fast enough, the oldest characters are
+    /// dropped so at most OUTPUT_CAPACITY of them are waiting.
+    class CIEAssemblyConsole
+    {
+      public:
+        static constexpr int OUTPUT_CAPACITY = 1 << 20;
+        //
+        /// Replaces the tape and goes back to its start.
+        void SetInput(const QByteArray &tape);
+        /// Adds characters at the end of the tape, after the ones not read yet.
+        void AppendInput(const QByteArray &characters);
+        /// The next character of the tape, -1 when all of it has been read.
+        int Read()
+        {
+            return inputPosition < input.size() ? quint8(input.at(inputPosition++)) : -1;
+        }
+        /// Moves back by count characters, which will be read again, after the machine went back over IN instructions.
+        void Unread(int count);
+        const QByteArray &Input() const
+        {
+            return input;
+        }
+        /// Number of characters read.
+        int InputPosition() const
+        {
+            return inputPosition;
+        }
+        //
+        void Write(char c);
+        /// Removes and returns the characters written since the last call. dropped is set to the number of characters lost in
+        /// between because there were too many, it may be null.
+        QByteArray TakeOutput(qint64 *dropped = nullptr);
+        /// Forgets the characters that have not been taken yet.
+        void ClearOutput();
+
+      private:
+        QByteArray input;
+        int inputPosition = 0;
+        //
+        QMutex outputMutex;
+        QByteArray output;
+        qint64 droppedOutput = 0;
+    };
+} // namespace CIEAssembly
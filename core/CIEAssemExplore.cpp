@@ -0,0 +1,451 @@
+#include "CIEAssemExplore.hpp"
+
+#include <QMutex>
+#include <QRunnable>
+#include <QWaitCondition>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <vector>
+
+namespace CIEAssembly
+{
+    namespace
+    {
+        /// A program paused before an IN, or stopped.
+        struct ExploreState
+        {
+            /// The output written and the cycles run so far, CIR at the IN while waiting.
+            CIEAssemblyBatchResult result;
+            CIEAssemblyCompareResult compareResult = RESULT_EQUAL;
+            bool waiting = false;
+        };
+
+        /// The programs after reading an input prefix.
+        struct Fork
+        {
+            QByteArray input;
+            QVector<ExploreState> states;
+        };
+
+        /// One double-ended queue of forks per thread.
+        class ForkQueues
+        {
+          public:
+            explicit ForkQueues(int threadCount) : queues(size_t(threadCount))
+            {
+            }
+            void Push(int thread, Fork &&fork)
+            {
+                pending++;
+                {
+                    auto &queue = queues[size_t(thread)];
+                    QMutexLocker locker(&queue.mutex);
+                    queue.forks.push_back(std::move(fork));
+                }
+                QMutexLocker locker(&idleMutex);
+                idle.wakeOne();
+            }
+            /// Takes the newest fork of the thread, or else the oldest fork of another one. Sleeps while there is none and other
+            /// threads are still exploring, returns false once every fork has been explored.
+            bool Take(int thread, Fork *fork)
+            {
+                if (TryTake(thread, fork))
+                {
+                    return true;
+                }
+                QMutexLocker locker(&idleMutex);
+                // Push and Done wake the threads under idleMutex, so nothing is missed between these checks and the wait.
+                while (pending > 0)
+                {
+                    if (TryTake(thread, fork))
+                    {
+                        return true;
+                    }
+                    idle.wait(&idleMutex);
+                }
+                return false;
+            }
+            /// Called once a taken fork has been explored, after its own forks have been pushed.
+            void Done()
+            {
+                if (--pending == 0)
+                {
+                    QMutexLocker locker(&idleMutex);
+                    idle.wakeAll();
+                }
+            }
+
+          private:
+            struct Queue
+            {
+                QMutex mutex;
+                std::deque<Fork> forks;
+            };
+            bool TryTake(int thread, Fork *fork)
+            {
+                const auto threadCount = int(queues.size());
+                for (auto i = 0; i < threadCount; i++)
+                {
+                    auto &queue = queues[size_t((thread + i) % threadCount)];
+                    QMutexLocker locker(&queue.mutex);
+                    if (queue.forks.empty())
+                    {
+                        continue;
+                    }
+                    if (i == 0)
+                    {
+                        *fork = std::move(queue.forks.back());
+                        queue.forks.pop_back();
+                    }
+                    else
+                    {
+                        *fork = std::move(queue.forks.front());
+                        queue.forks.pop_front();
+                    }
+                    return true;
+                }
+                return false;
+            }
+            //
+            std::vector<Queue> queues;
+            /// Forks pushed and not explored yet.
+            std::atomic<qint64> pending{ 0 };
+            /// Where the threads sleep while every queue is empty.
+            QMutex idleMutex;
+            QWaitCondition idle;
+        };
+
+        /// How a run ended, for comparing programs: -1 out of input, else the kind of break, BREAK_NONE when it finished.
+        int Ending(const CIEAssemblyBatchResult &result)
+        {
+            return result.cir < 0 ? -1 : int(result.lastBreak.kind);
+        }
+
+        bool InputLess(const QByteArray &a, const QByteArray &b)
+        {
+            return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) { return quint8(x) < quint8(y); });
+        }
+
+        class Explorer
+        {
+          public:
+            Explorer(const QVector<CIEAssemblyProgram> &programs, const CIEAssemblyExploreOptions &options)
+                : programs(programs), options(options), threadCount(qMax(1, options.threadCount)), queues(threadCount), reports(threadCount)
+            {
+                // Sequences of at most depth characters starting with a prefix of each length.
+                weights.resize(options.depth + 1);
+                weights[options.depth] = 1;
+                for (auto length = options.depth - 1; length >= 0; length--)
+                {
+                    weights[length] = 1 + 256 * weights.at(length + 1);
+                }
+                limits.maxCycles = options.maxCycles;
+                limits.detectLoops = options.detectLoops;
+                for (auto &report : reports)
+                {
+                    report.programs.resize(programs.count());
+                }
+            }
+
+            CIEAssemblyExploreReport Run()
+            {
+                {
+                    // The first run, up to the first IN of every program.
+                    Worker worker(this, 0);
+                    Fork root;
+                    for (auto i = 0; i < programs.count(); i++)
+                    {
+                        root.states << worker.Start(i);
+                    }
+                    queues.Push(0, std::move(root));
+                }
+                QThreadPool pool;
+                pool.setMaxThreadCount(threadCount);
+                for (auto thread = 0; thread < threadCount; thread++)
+                {
+                    pool.start(new Task(this, thread));
+                }
+                pool.waitForDone();
+                return MergeReports();
+            }
+
+          private:
+            /// The machines and the report of one thread.
+            struct Worker
+            {
+                Worker(Explorer *explorer, int thread)
+                    : explorer(explorer), thread(thread), report(explorer->reports[thread]), machines(size_t(explorer->programs.count()))
+                {
+                    // Every IN is a breakpoint: a run stops in front of it, so the state can be forked there.
+                    for (size_t index = 0; index < machines.size(); index++)
+                    {
+                        const auto &program = explorer->programs.at(int(index));
+                        auto &machine = machines[index];
+                        CIEAssemblyBreakpoints breakpoints;
+                        for (auto i = 0; i < program.decoded.count(); i++)
+                        {
+                            if (program.decoded.at(i).opcode == IN)
+                            {
+                                breakpoints.SetBreakpoint(i);
+                            }
+                        }
+                        machine.Load(program);
+                        machine.SetOptimized(explorer->options.optimized);
+                        machine.SetBreakpoints(breakpoints);
+                        machine.SetLimits(explorer->limits);
+                        machine.SetInputHandler([this]() { return input; });
+                        machine.SetOutputHandler([this](char c) { output->append(c); });
+                    }
+                }
+
+                ExploreState Capture(const CIEAssemblyMachine &machine)
+                {
+                    ExploreState state;
+                    state.result.memory = machine.Memory();
+                    state.result.cycles = machine.Cycles();
+                    state.result.cir = machine.CIR();
+                    state.compareResult = machine.CompareResult();
+                    state.waiting = machine.LastBreak().kind == CIEAssemblyBreak::BREAK_BREAKPOINT;
+                    if (!state.waiting)
+                    {
+                        state.result.lastBreak = machine.LastBreak();
+                    }
+                    return state;
+                }
+
+                /// Runs a program from its first instruction up to its first IN.
+                ExploreState Start(int index)
+                {
+                    auto &machine = machines[size_t(index)];
+                    QByteArray runOutput;
+                    output = &runOutput;
+                    machine.Reset();
+                    machine.Run();
+                    report.segments++;
+                    report.executedCycles += machine.Cycles();
+                    auto started = Capture(machine);
+                    started.result.output = runOutput;
+                    return started;
+                }
+
+                /// Runs a program paused before an IN, with the character c read by that IN, up to its next IN.
+                ExploreState Resume(int index, const ExploreState &state, char c)
+                {
+                    auto &machine = machines[size_t(index)];
+                    machine.Restore({ state.result.cycles, state.result.cir, state.compareResult, state.result.memory });
+                    QByteArray runOutput = state.result.output;
+                    output = &runOutput;
+                    input = quint8(c);
+                    // Step ignores the breakpoint of the IN.
+                    machine.Step();
+                    input = -1;
+                    machine.Run();
+                    report.segments++;
+                    report.executedCycles += machine.Cycles() - state.result.cycles;
+                    auto resumed = Capture(machine);
+                    resumed.result.output = runOutput;
+                    return resumed;
+                }
+
+                void Explore(const Fork &fork)
+                {
+                    const auto length = fork.input.size();
+                    auto waiting = false;
+                    for (const auto &state : fork.states)
+                    {
+                        waiting = waiting || state.waiting;
+                    }
+                    if (!waiting)
+                    {
+                        // No program reads further, every longer input gives the same runs.
+                        Record(fork, explorer->weights.at(length));
+                        return;
+                    }
+                    {
+                        // The input ends here, the waiting programs stop at their IN.
+                        Fork end = fork;
+                        for (auto &state : end.states)
+                        {
+                            if (state.waiting)
+                            {
+                                state.result.cycles++;
+                                state.result.cir = -1;
+                            }
+                        }
+                        Record(end, 1);
+                    }
+                    if (length == explorer->options.depth)
+                    {
+                        return;
+                    }
+                    for (auto c = 0; c < 256; c++)
+                    {
+                        Fork next;
+                        next.input = fork.input;
+                        next.input.append(char(c));
+                        next.states.reserve(fork.states.count());
+                        for (auto i = 0; i < fork.states.count(); i++)
+                        {
+                            const auto &state = fork.states.at(i);
+                            next.states << (state.waiting ? Resume(i, state, char(c)) : state);
+                        }
+                        // The last level is explored at once, it forks no further.
+                        if (length + 1 == explorer->options.depth)
+                        {
+                            Explore(next);
+                        }
+                        else
+                        {
+                            explorer->queues.Push(thread, std::move(next));
+                        }
+                    }
+                }
+
+                void Record(const Fork &fork, qint64 sequences)
+                {
+                    report.sequences += sequences;
+                    const auto &first = fork.states.first().result;
+                    auto divergent = false;
+                    auto crashed = false;
+                    for (auto i = 0; i < fork.states.count(); i++)
+                    {
+                        const auto &result = fork.states.at(i).result;
+                        auto &program = report.programs[i];
+                        if (result.cir < 0)
+                        {
+                            program.outOfInput += sequences;
+                        }
+                        else if (result.lastBreak.IsLimit())
+                        {
+                            program.crashed += sequences;
+                            crashed = true;
+                        }
+                        else
+                        {
+                            program.finished += sequences;
+                        }
+                        program.cycles[result.cycles] += sequences;
+                        divergent = divergent || result.output != first.output || Ending(result) != Ending(first);
+                    }
+                    if (divergent)
+                    {
+                        report.divergences += sequences;
+                        AddExample(&report.divergenceExamples, fork, sequences);
+                    }
+                    if (crashed)
+                    {
+                        report.crashes += sequences;
+                        AddExample(&report.crashExamples, fork, sequences);
+                    }
+                }
+
+                void AddExample(QVector<CIEAssemblyExploreCase> *examples, const Fork &fork, qint64 sequences)
+                {
+                    const auto maxExamples = explorer->options.maxExamples;
+                    if (examples->count() >= maxExamples && (maxExamples == 0 || !InputLess(fork.input, examples->last().input)))
+                    {
+                        return;
+                    }
+                    CIEAssemblyExploreCase example;
+                    example.input = fork.input;
+                    example.sequences = sequences;
+                    for (const auto &state : fork.states)
+                    {
+                        example.results << state.result;
+                    }
+                    const auto position = std::upper_bound(examples->begin(), examples->end(), example,
+                                                           [](const CIEAssemblyExploreCase &a, const CIEAssemblyExploreCase &b) {
+                                                               return InputLess(a.input, b.input);
+                                                           });
+                    examples->insert(int(position - examples->begin()), example);
+                    if (examples->count() > maxExamples)
+                    {
+                        examples->removeLast();
+                    }
+                }
+
+                Explorer *explorer;
+                int thread;
+                CIEAssemblyExploreReport &report;
+                std::vector<CIEAssemblyMachine> machines;
+                /// What the next IN reads, and where OUT writes.
+                int input = -1;
+                QByteArray *output = nullptr;
+            };
+
+            class Task : public QRunnable
+            {
+              public:
+                Task(Explorer *explorer, int thread) : explorer(explorer), thread(thread){};
+                void run() override
+                {
+                    Worker worker(explorer, thread);
+                    Fork fork;
+                    while (explorer->queues.Take(thread, &fork))
+                    {
+                        worker.Explore(fork);
+                        explorer->queues.Done();
+                    }
+                }
+
+              private:
+                Explorer *explorer;
+                int thread;
+            };
+
+            CIEAssemblyExploreReport MergeReports() const
+            {
+                CIEAssemblyExploreReport merged;
+                merged.programs.resize(programs.count());
+                for (const auto &report : reports)
+                {
+                    merged.sequences += report.sequences;
+                    merged.segments += report.segments;
+                    merged.executedCycles += report.executedCycles;
+                    merged.divergences += report.divergences;
+                    merged.crashes += report.crashes;
+                    merged.divergenceExamples += report.divergenceExamples;
+                    merged.crashExamples += report.crashExamples;
+                    for (auto i = 0; i < programs.count(); i++)
+                    {
+                        const auto &program = report.programs.at(i);
+                        auto &mergedProgram = merged.programs[i];
+                        mergedProgram.finished += program.finished;
+                        mergedProgram.outOfInput += program.outOfInput;
+                        mergedProgram.crashed += program.crashed;
+                        for (auto it = program.cycles.constBegin(); it != program.cycles.constEnd(); ++it)
+                        {
+                            mergedProgram.cycles[it.key()] += it.value();
+                        }
+                    }
+                }
+                for (auto *examples : { &merged.divergenceExamples, &merged.crashExamples })
+                {
+                    std::sort(examples->begin(), examples->end(),
+                              [](const CIEAssemblyExploreCase &a, const CIEAssemblyExploreCase &b) { return InputLess(a.input, b.input); });
+                    examples->resize(qMin(examples->count(), options.maxExamples));
+                }
+                return merged;
+            }
+
+            const QVector<CIEAssemblyProgram> &programs;
+            const CIEAssemblyExploreOptions &options;
+            const int threadCount;
+            ForkQueues queues;
+            /// One report per thread, merged at the end.
+            QVector<CIEAssemblyExploreReport> reports;
+            QVector<qint64> weights;
+            CIEAssemblyLimits limits;
+        };
+    } // namespace
+
+    CIEAssemblyExploreReport ExplorePrograms(const QVector<CIEAssemblyProgram> &programs, const CIEAssemblyExploreOptions &options)
+    {
+        if (programs.isEmpty() || options.depth < 0 || options.depth > CIEAssemblyExploreOptions::MAX_DEPTH)
+        {
+            return {};
+        }
+        return Explorer(programs, options).Run();
+    }
+} // namespace CIEAssembly
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "CIEAssemBatch.hpp"
+
+#include <QMap>
+
+namespace CIEAssembly
+{
+    struct CIEAssemblyExploreOptions
+    {
+        /// Deepest space whose sequences can be counted in a qint64: there are more than 2^64 sequences of 8 characters.
+        static constexpr int MAX_DEPTH = 7;
+        /// Longest input sequence, in characters, from 0 to MAX_DEPTH. Each character takes the 256 values of a byte.
+        int depth = 1;
+        /// Stop a run after this many cycles, needed for the programs that never end on some input.
+        qint64 maxCycles = 1000000;
+        /// Stop a run that comes back to an earlier state, see CIEAssemblyLimits.
+        bool detectLoops = false;
+        /// See CIEAssemblyMachine::SetOptimized.
+        bool optimized = false;
+        int threadCount = QThread::idealThreadCount();
+        /// Divergences and crashes kept as examples, the ones with the smallest inputs.
+        int maxExamples = 10;
+    };
+
+    /// The runs of the explored programs on an input sequence.
+    struct CIEAssemblyExploreCase
+    {
+        QByteArray input;
+        /// Input sequences of the explored space this case stands for: the input, and every longer sequence starting with it when
+        /// no program read past it.
+        qint64 sequences = 1;
+        /// One result per program.
+        QVector<CIEAssemblyBatchResult> results;
+    };
+
+    struct CIEAssemblyExploreReport
+    {
+        struct Program
+        {
+            /// Sequences on which the program reached END or ran past its last instruction.
+            qint64 finished = 0;
+            /// Sequences too short for the program, which stopped at an IN.
+            qint64 outOfInput = 0;
+            /// Sequences on which a limit stopped the program: the cycle limit, or a detected endless loop.
+            qint64 crashed = 0;
+            /// Number of sequences by the cycles the program ran on them.
+            QMap<qint64, qint64> cycles;
+        };
+        /// Every sequence of at most depth characters, the empty one included.
+        qint64 sequences = 0;
+        /// Runs from an IN to the next one, each shared by all the sequences starting with the input read so far.
+        qint64 segments = 0;
+        /// Cycles executed by those runs, all programs together.
+        qint64 executedCycles = 0;
+        QVector<Program> programs;
+        /// Sequences on which the programs wrote different outputs, or did not stop the same way.
+        qint64 divergences = 0;
+        QVector<CIEAssemblyExploreCase> divergenceExamples;
+        /// Sequences on which a limit stopped any program.
+        qint64 crashes = 0;
+        QVector<CIEAssemblyExploreCase> crashExamples;
+    };
+
+    /// Runs one program, or compares several, over every input sequence up to a depth.
+    ///
+    /// The programs run until they reach an IN, where the state of every program that is still running is forked once per
+    /// character. A prefix of the input is thus executed once for all the sequences that start with it, and a program that stops
+    /// before reading the whole prefix stands for all its extensions at once. The forks are spread over the threads through
+    /// one double-ended queue per thread: a thread takes its most recent fork, going depth-first, and when it runs out, steals the
+    /// oldest fork of another thread, which is the largest part of the space left there.
+    ///
+    /// Returns an empty report when there is no program or the depth is out of range.
+    CIEAssemblyExploreReport ExplorePrograms(const QVector<CIEAssemblyProgram> &programs, const CIEAssemblyExploreOptions &options);
+} // namespace CIEAssembly
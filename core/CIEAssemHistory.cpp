@@ -0,0 +1,105 @@
+#include "CIEAssemHistory.hpp"
+
+#include <algorithm>
+
+namespace CIEAssembly
+{
+    CIEAssemblyHistory::CIEAssemblyHistory(int capacity, int checkpointInterval)
+        : capacity(capacity), initialCheckpointInterval(checkpointInterval), checkpointInterval(checkpointInterval)
+    {
+        Q_ASSERT(capacity > 0 && checkpointInterval > 0);
+    }
+
+    void CIEAssemblyHistory::Clear()
+    {
+        steps.clear();
+        firstStep = 0;
+        stepCount = 0;
+        checkpoints.clear();
+        checkpointInterval = initialCheckpointInterval;
+        inputCycles.clear();
+        inputValues.clear();
+    }
+
+    void CIEAssemblyHistory::PushStep(const Step &step)
+    {
+        if (stepCount < steps.count())
+        {
+            steps[(firstStep + stepCount) % steps.count()] = step;
+            stepCount++;
+        }
+        else if (steps.count() < capacity)
+        {
+            // The ring only wraps once it has reached its capacity, until then it starts at 0.
+            steps << step;
+            stepCount++;
+        }
+        else
+        {
+            steps[firstStep] = step;
+            firstStep = (firstStep + 1) % capacity;
+        }
+    }
+
+    CIEAssemblyHistory::Step CIEAssemblyHistory::PopStep()
+    {
+        Q_ASSERT(stepCount > 0);
+        stepCount--;
+        return steps.at((firstStep + stepCount) % steps.count());
+    }
+
+    void CIEAssemblyHistory::AddCheckpoint(const Checkpoint &checkpoint)
+    {
+        if (!checkpoints.isEmpty() && checkpoint.cycle <= checkpoints.last().cycle)
+        {
+            // Executing forward again after going back, the checkpoint is already there.
+            return;
+        }
+        checkpoints << checkpoint;
+        if (checkpoints.count() > MAXIMUM_CHECKPOINTS)
+        {
+            QVector<Checkpoint> kept;
+            for (auto i = 0; i < checkpoints.count(); i += 2)
+            {
+                kept << checkpoints.at(i);
+            }
+            checkpoints = kept;
+            checkpointInterval *= 2;
+        }
+    }
+
+    const CIEAssemblyHistory::Checkpoint *CIEAssemblyHistory::CheckpointAtOrBefore(qint64 cycle) const
+    {
+        const auto next = std::upper_bound(checkpoints.cbegin(), checkpoints.cend(), cycle,
+                                           [](qint64 cycle, const Checkpoint &checkpoint) { return cycle < checkpoint.cycle; });
+        return next == checkpoints.cbegin() ? nullptr : &*(next - 1);
+    }
+
+    void CIEAssemblyHistory::AddInput(qint64 cycle, int value)
+    {
+        if (!inputCycles.isEmpty() && cycle <= inputCycles.last())
+        {
+            // Executing forward again after going back, the input is already there.
+            return;
+        }
+        inputCycles << cycle;
+        inputValues << value;
+    }
+
+    int CIEAssemblyHistory::InputAt(qint64 cycle) const
+    {
+        const auto found = std::lower_bound(inputCycles.cbegin(), inputCycles.cend(), cycle);
+        return found != inputCycles.cend() && *found == cycle ? inputValues.at(found - inputCycles.cbegin()) : -1;
+    }
+
+    void CIEAssemblyHistory::DiscardAfter(qint64 cycle)
+    {
+        while (!checkpoints.isEmpty() && checkpoints.last().cycle > cycle)
+        {
+            checkpoints.removeLast();
+        }
+        const auto kept = int(std::upper_bound(inputCycles.cbegin(), inputCycles.cend(), cycle) - inputCycles.cbegin());
+        inputCycles.resize(kept);
+        inputValues.resize(kept);
+    }
+} // namespace CIEAssembly
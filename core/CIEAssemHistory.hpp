@@ -0,0 +1,92 @@
+#pragma once
+
+#include "CIEAssemMemory.hpp"
+#include "Common.hpp"
+
+#include <QVector>
+
+namespace CIEAssembly
+{
+    /// Undo information recorded by a CIEAssemblyMachine while a history is set, used to move backwards in time.
+    ///
+    /// Every executed instruction leaves a Step with what it overwrote, at most one slot, in a ring of bounded capacity. Full
+    /// checkpoints of the machine are taken at regular intervals, and the values read by IN are kept, so cycles that fell out
+    /// of the ring are reached again by restoring the closest checkpoint and executing forward from it. When there are too many
+    /// checkpoints every other one is dropped and the interval doubles, the first checkpoint is always kept.
+    class CIEAssemblyHistory
+    {
+      public:
+        static constexpr int DEFAULT_CAPACITY = 1 << 20;
+        static constexpr int DEFAULT_CHECKPOINT_INTERVAL = 1 << 16;
+        static constexpr int MAXIMUM_CHECKPOINTS = 64;
+        //
+        /// What an instruction changed, the state before it executed.
+        struct Step
+        {
+            int cir;
+            /// The slot written by the instruction, -1 if it wrote nothing.
+            int address;
+            char oldValue;
+            qint8 compareResult;
+        };
+        struct Checkpoint
+        {
+            qint64 cycle;
+            int cir;
+            CIEAssemblyCompareResult compareResult;
+            /// Shares its data with the memory of the machine until either is written.
+            CIEAssemblyMemory memory;
+        };
+        //
+        explicit CIEAssemblyHistory(int capacity = DEFAULT_CAPACITY, int checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL);
+        void Clear();
+        //
+        /// Appends the step of the next instruction, dropping the oldest step when the ring is full.
+        void PushStep(const Step &step);
+        /// Removes and returns the step of the last instruction, there must be one.
+        Step PopStep();
+        /// Empties the ring, before the machine restores a checkpoint.
+        void DiscardSteps()
+        {
+            stepCount = 0;
+        }
+        /// Number of instructions that can be undone from the ring.
+        int StepCount() const
+        {
+            return stepCount;
+        }
+        //
+        bool CheckpointDue(qint64 cycle) const
+        {
+            return checkpoints.isEmpty() || cycle >= checkpoints.last().cycle + checkpointInterval;
+        }
+        void AddCheckpoint(const Checkpoint &checkpoint);
+        /// The last checkpoint taken at or before cycle, null if there is none.
+        const Checkpoint *CheckpointAtOrBefore(qint64 cycle) const;
+        //
+        /// Keeps the value read by the IN instruction executed as the given cycle.
+        void AddInput(qint64 cycle, int value);
+        /// The value read by IN at the given cycle, -1 if none was recorded.
+        int InputAt(qint64 cycle) const;
+        /// Number of values read by IN since the history was cleared, up to the current cycle once the future has been discarded.
+        int InputCount() const
+        {
+            return inputCycles.count();
+        }
+        //
+        /// Forgets the checkpoints and inputs after cycle, as the machine went back to it and the future will be executed again.
+        void DiscardAfter(qint64 cycle);
+
+      private:
+        int capacity;
+        int initialCheckpointInterval;
+        QVector<Step> steps;
+        int firstStep = 0;
+        int stepCount = 0;
+        QVector<Checkpoint> checkpoints;
+        qint64 checkpointInterval;
+        /// Cycles of the IN instructions, in increasing order, and the values they read.
+        QVector<qint64> inputCycles;
+        QVector<int> inputValues;
+    };
+} // namespace CIEAssembly
@@ -0,0 +1,241 @@
+#pragma once
+
+#include "Common.hpp"
+
+namespace CIEAssembly
+{
+    /// Groups of opcodes, as the highlighter colors them.
+    enum CIEAssemblyCategory
+    {
+        CATEGORY_DATA_MOVEMENT,
+        CATEGORY_ARITHMETIC,
+        CATEGORY_COMPARISON_JUMP,
+        CATEGORY_IO,
+        CATEGORY_BITWISE,
+        CATEGORY_OTHER,
+        CATEGORY_COUNT
+    };
+
+    /// The operands an opcode accepts.
+    enum CIEAssemblyOperandRule
+    {
+        /// No operand, one written anyway is ignored.
+        RULE_NONE,
+        /// "#n", "#&n" or "#bn".
+        RULE_NUMBER,
+        /// "ACC" or "IX".
+        RULE_REGISTER,
+        /// A memory location.
+        RULE_ADDRESS,
+        /// A number or a memory location.
+        RULE_NUMBER_OR_ADDRESS,
+        /// "label" or "label+N".
+        RULE_LABEL
+    };
+
+    /// Where the execution goes after an opcode.
+    enum CIEAssemblyControlFlow
+    {
+        FLOW_NEXT,
+        /// To the target.
+        FLOW_JUMP,
+        /// To the target or to the next instruction, depending on the last comparison.
+        FLOW_BRANCH,
+        /// Nowhere, the program ends.
+        FLOW_STOP
+    };
+
+    struct CIEAssemblyInstructionInfo
+    {
+        const char *mnemonic;
+        CIEAssemblyOperandRule operand;
+        CIEAssemblyCategory category;
+        CIEAssemblyControlFlow flow;
+        /// Cycles counted for one execution.
+        int cycles;
+    };
+
+    /// The instruction set, in the order of CIEAssemblyOpcode. The lexer, the operand checks, the highlighter and the engines
+    /// derive what they know about an opcode from it.
+    constexpr CIEAssemblyInstructionInfo INSTRUCTION_SET[] = {
+        { "LDM", RULE_NUMBER, CATEGORY_DATA_MOVEMENT, FLOW_NEXT, 1 },
+        { "LDD", RULE_ADDRESS, CATEGORY_DATA_MOVEMENT, FLOW_NEXT, 1 },
+        { "LDI", RULE_ADDRESS, CATEGORY_DATA_MOVEMENT, FLOW_NEXT, 1 },
+        { "LDX", RULE_ADDRESS, CATEGORY_DATA_MOVEMENT, FLOW_NEXT, 1 },
+        { "LDR", RULE_NUMBER, CATEGORY_DATA_MOVEMENT, FLOW_NEXT, 1 },
+        { "STO", RULE_ADDRESS, CATEGORY_DATA_MOVEMENT, FLOW_NEXT, 1 },
+        { "STX", RULE_ADDRESS, CATEGORY_DATA_MOVEMENT, FLOW_NEXT, 1 },
+        { "STI", RULE_ADDRESS, CATEGORY_DATA_MOVEMENT, FLOW_NEXT, 1 },
+        { "ADD", RULE_NUMBER_OR_ADDRESS, CATEGORY_ARITHMETIC, FLOW_NEXT, 1 },
+        { "INC", RULE_REGISTER, CATEGORY_ARITHMETIC, FLOW_NEXT, 1 },
+        { "DEC", RULE_REGISTER, CATEGORY_ARITHMETIC, FLOW_NEXT, 1 },
+        { "JMP", RULE_LABEL, CATEGORY_COMPARISON_JUMP, FLOW_JUMP, 1 },
+        { "CMP", RULE_NUMBER_OR_ADDRESS, CATEGORY_COMPARISON_JUMP, FLOW_NEXT, 1 },
+        { "JPE", RULE_LABEL, CATEGORY_COMPARISON_JUMP, FLOW_BRANCH, 1 },
+        { "JPN", RULE_LABEL, CATEGORY_COMPARISON_JUMP, FLOW_BRANCH, 1 },
+        { "IN", RULE_NONE, CATEGORY_IO, FLOW_NEXT, 1 },
+        { "OUT", RULE_NONE, CATEGORY_IO, FLOW_NEXT, 1 },
+        { "AND", RULE_NUMBER_OR_ADDRESS, CATEGORY_BITWISE, FLOW_NEXT, 1 },
+        { "XOR", RULE_NUMBER_OR_ADDRESS, CATEGORY_BITWISE, FLOW_NEXT, 1 },
+        { "OR", RULE_NUMBER_OR_ADDRESS, CATEGORY_BITWISE, FLOW_NEXT, 1 },
+        { "LSL", RULE_NUMBER, CATEGORY_BITWISE, FLOW_NEXT, 1 },
+        { "LSR", RULE_NUMBER, CATEGORY_BITWISE, FLOW_NEXT, 1 },
+        { "END", RULE_NONE, CATEGORY_OTHER, FLOW_STOP, 1 },
+    };
+    constexpr int OPCODE_COUNT = int(sizeof(INSTRUCTION_SET) / sizeof(*INSTRUCTION_SET));
+    static_assert(OPCODE_COUNT == END + 1, "Every opcode needs an entry in the instruction set.");
+
+    constexpr const CIEAssemblyInstructionInfo &InstructionInfo(CIEAssemblyOpcode opcode)
+    {
+        return INSTRUCTION_SET[opcode];
+    }
+    inline QString Mnemonic(CIEAssemblyOpcode opcode)
+    {
+        return QString::fromLatin1(InstructionInfo(opcode).mnemonic);
+    }
+    /// JMP, JPE and JPN, which have a target.
+    constexpr bool IsJump(CIEAssemblyOpcode opcode)
+    {
+        return InstructionInfo(opcode).flow == FLOW_JUMP || InstructionInfo(opcode).flow == FLOW_BRANCH;
+    }
+    constexpr bool IsConditionalJump(CIEAssemblyOpcode opcode)
+    {
+        return InstructionInfo(opcode).flow == FLOW_BRANCH;
+    }
+    /// False when the next instruction is never executed right after this one.
+    constexpr bool FallsThrough(CIEAssemblyOpcode opcode)
+    {
+        return InstructionInfo(opcode).flow == FLOW_NEXT || InstructionInfo(opcode).flow == FLOW_BRANCH;
+    }
+
+    /// Number of places LSL and LSR shift ACC by. The 8 bits of ACC are all shifted out past 8 places, so larger counts act as 8,
+    /// and negative counts as 0: every count has the same meaning in every engine.
+    constexpr int ShiftCount(long count)
+    {
+        return count < 0 ? 0 : count > 8 ? 8 : int(count);
+    }
+    /// LSL, zeros come in from the right.
+    constexpr char ShiftLeft(char value, long count)
+    {
+        return char(quint8(quint8(value) << ShiftCount(count)));
+    }
+    /// LSR, copies of the sign bit come in from the left, as ACC is a signed character.
+    constexpr char ShiftRight(char value, long count)
+    {
+        return char(qint8(value) >> ShiftCount(count));
+    }
+
+    namespace InstructionSetDetail
+    {
+        constexpr bool HasUnitCycles()
+        {
+            for (const auto &info : INSTRUCTION_SET)
+            {
+                if (info.cycles != 1)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    } // namespace InstructionSetDetail
+    // The step count, the cycle limits, the threaded code and the JIT all count one cycle per instruction.
+    static_assert(InstructionSetDetail::HasUnitCycles(), "The engines only support instructions of one cycle.");
+
+    // -------------------------- Mnemonic lookup --------------------------
+    //
+    // A mnemonic of two or three characters is packed into a key, one byte per character. The key is hashed by a multiplication,
+    // keeping the top MNEMONIC_HASH_BITS bits, with a multiplier searched at compile time so that no two mnemonics share a bucket.
+    // Looking up a word is then packing it, one multiplication and one comparison with the key of its bucket.
+
+    constexpr int MNEMONIC_HASH_BITS = 7;
+    constexpr int MNEMONIC_BUCKETS = 1 << MNEMONIC_HASH_BITS;
+
+    constexpr quint32 MnemonicKey(const char *mnemonic)
+    {
+        quint32 key = 0;
+        for (auto i = 0; mnemonic[i] != 0; i++)
+        {
+            key |= quint32(quint8(mnemonic[i])) << (8 * i);
+        }
+        return key;
+    }
+
+    constexpr int MnemonicBucket(quint32 key, quint32 multiplier)
+    {
+        return int((key * multiplier) >> (32 - MNEMONIC_HASH_BITS));
+    }
+
+    namespace InstructionSetDetail
+    {
+        constexpr bool IsPerfectMultiplier(quint32 multiplier)
+        {
+            bool used[MNEMONIC_BUCKETS] = {};
+            for (const auto &info : INSTRUCTION_SET)
+            {
+                const auto bucket = MnemonicBucket(MnemonicKey(info.mnemonic), multiplier);
+                if (used[bucket])
+                {
+                    return false;
+                }
+                used[bucket] = true;
+            }
+            return true;
+        }
+
+        constexpr quint32 FindPerfectMultiplier()
+        {
+            // Odd multipliers from the golden ratio, about a hundred are tried before one fits the mnemonics in 128 buckets.
+            auto multiplier = quint32(0x9E3779B1);
+            while (!IsPerfectMultiplier(multiplier))
+            {
+                multiplier += 2;
+            }
+            return multiplier;
+        }
+
+        struct MnemonicTable
+        {
+            /// Key of the mnemonic in every bucket, 0 for an empty bucket.
+            quint32 keys[MNEMONIC_BUCKETS] = {};
+            qint8 opcodes[MNEMONIC_BUCKETS] = {};
+        };
+
+        constexpr MnemonicTable MakeMnemonicTable(quint32 multiplier)
+        {
+            MnemonicTable table;
+            for (auto opcode = 0; opcode < OPCODE_COUNT; opcode++)
+            {
+                const auto key = MnemonicKey(INSTRUCTION_SET[opcode].mnemonic);
+                const auto bucket = MnemonicBucket(key, multiplier);
+                table.keys[bucket] = key;
+                table.opcodes[bucket] = qint8(opcode);
+            }
+            return table;
+        }
+    } // namespace InstructionSetDetail
+
+    constexpr quint32 MNEMONIC_HASH_MULTIPLIER = InstructionSetDetail::FindPerfectMultiplier();
+    constexpr InstructionSetDetail::MnemonicTable MNEMONIC_TABLE = InstructionSetDetail::MakeMnemonicTable(MNEMONIC_HASH_MULTIPLIER);
+
+    /// Returns the opcode spelled by the characters, or -1 if there is none. Mnemonics are case-sensitive.
+    inline int LookupOpcode(const QChar *text, int length)
+    {
+        if (length < 2 || length > 3)
+        {
+            return -1;
+        }
+        quint32 key = 0;
+        for (auto i = 0; i < length; i++)
+        {
+            const auto c = text[i].unicode();
+            if (c == 0 || c > 0x7F)
+            {
+                return -1;
+            }
+            key |= quint32(c) << (8 * i);
+        }
+        const auto bucket = MnemonicBucket(key, MNEMONIC_HASH_MULTIPLIER);
+        return MNEMONIC_TABLE.keys[bucket] == key ? MNEMONIC_TABLE.opcodes[bucket] : -1;
+    }
+} // namespace CIEAssembly
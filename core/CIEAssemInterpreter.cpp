@@ -0,0 +1,581 @@
+#include "CIEAssemMachine.hpp"
+#include "CIEAssemOptimizer.hpp"
+
+#include <limits>
+
+// Direct-threaded dispatch needs the "labels as values" extension, other compilers get a switch in a loop.
+// Define CIE_NO_THREADED_DISPATCH to compare both.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(CIE_NO_THREADED_DISPATCH)
+    #define CIE_THREADED_DISPATCH
+#endif
+
+namespace CIEAssembly
+{
+    namespace
+    {
+        /// Opcodes of the threaded code, operand kinds are split into different handlers.
+        enum ThreadedOpcode
+        {
+            T_LDM,
+            T_LDD,
+            T_LDX,
+            T_LDR,
+            T_STO,
+            T_STX,
+            T_ADD_M,
+            T_ADD_I,
+            T_INC,
+            T_DEC,
+            T_JMP,
+            T_CMP_M,
+            T_CMP_I,
+            T_JPE,
+            T_JPN,
+            T_IN,
+            T_OUT,
+            T_AND_M,
+            T_AND_I,
+            T_XOR_M,
+            T_XOR_I,
+            T_OR_M,
+            T_OR_I,
+            T_LSL,
+            T_LSR,
+            T_END,
+            T_NOP,
+            // Superinstructions, see CIEAssemblyFusion. They read the operands of the instructions they cover from the following
+            // slots, which keep their own handlers for the jumps that land there.
+            T_LDD_STO,
+            T_LDD_ADD_M_STO,
+            T_LDD_ADD_I_STO,
+            T_LDD_INC_STO,
+            T_LDD_DEC_STO,
+            T_CMP_M_JPE,
+            T_CMP_M_JPN,
+            T_CMP_I_JPE,
+            T_CMP_I_JPN,
+            T_INC_LDD_CMP_JPE,
+            T_INC_LDD_CMP_JPN,
+            // Jumps to the end of a chain of JMP, charging a cycle for every JMP skipped.
+            T_JMP_CHAIN,
+            T_JPE_CHAIN,
+            T_JPN_CHAIN,
+            /// Replaces an instruction that may hit a breakpoint or a watchpoint, Run checks and executes it.
+            T_TRAP,
+            /// Placed after the last instruction, so falling off the end needs no bounds check.
+            T_HALT
+        };
+
+        ThreadedOpcode ToThreadedOpcode(const CIEAssemblyDecodedInstruction &instruction)
+        {
+            const auto isMemory = instruction.operandType == MEMORY_LOCATION;
+            switch (instruction.opcode)
+            {
+                case LDM: return T_LDM;
+                case LDD: return T_LDD;
+                case LDX: return T_LDX;
+                case LDR: return T_LDR;
+                case STO: return T_STO;
+                case STX: return T_STX;
+                case ADD: return isMemory ? T_ADD_M : T_ADD_I;
+                case INC: return T_INC;
+                case DEC: return T_DEC;
+                case JMP: return T_JMP;
+                case CMP: return isMemory ? T_CMP_M : T_CMP_I;
+                case JPE: return T_JPE;
+                case JPN: return T_JPN;
+                case IN: return T_IN;
+                case OUT: return T_OUT;
+                case AND: return isMemory ? T_AND_M : T_AND_I;
+                case XOR: return isMemory ? T_XOR_M : T_XOR_I;
+                case OR: return isMemory ? T_OR_M : T_OR_I;
+                case LSL: return T_LSL;
+                case LSR: return T_LSR;
+                case END: return T_END;
+                case LDI:
+                case STI:
+                default: return T_NOP;
+            }
+        }
+
+        /// The superinstruction or the folded jump the optimizer found for an instruction, the plain handler if there is none.
+        ThreadedOpcode ToThreadedOpcode(const CIEAssemblyDecodedProgram &program, int index, const CIEAssemblyOptimization::Instruction &optimized)
+        {
+            const auto &instruction = program.at(index);
+            const auto isMemory = instruction.operandType == MEMORY_LOCATION;
+            const auto jumpIfEqual = index + optimized.length - 1 < program.count() && program.at(index + optimized.length - 1).opcode == JPE;
+            switch (optimized.fusion)
+            {
+                case FUSION_LDD_STO: return T_LDD_STO;
+                case FUSION_LDD_ADD_STO: return program.at(index + 1).operandType == MEMORY_LOCATION ? T_LDD_ADD_M_STO : T_LDD_ADD_I_STO;
+                case FUSION_LDD_INC_STO: return T_LDD_INC_STO;
+                case FUSION_LDD_DEC_STO: return T_LDD_DEC_STO;
+                case FUSION_CMP_JUMP:
+                    return isMemory ? (jumpIfEqual ? T_CMP_M_JPE : T_CMP_M_JPN) : (jumpIfEqual ? T_CMP_I_JPE : T_CMP_I_JPN);
+                case FUSION_INC_LDD_CMP_JUMP: return jumpIfEqual ? T_INC_LDD_CMP_JPE : T_INC_LDD_CMP_JPN;
+                case FUSION_NONE: break;
+            }
+            if (optimized.hops > 0)
+            {
+                switch (instruction.opcode)
+                {
+                    case JMP: return T_JMP_CHAIN;
+                    case JPE: return T_JPE_CHAIN;
+                    case JPN: return T_JPN_CHAIN;
+                    default: break;
+                }
+            }
+            return ToThreadedOpcode(instruction);
+        }
+    } // namespace
+
+    qint64 CIEAssemblyMachine::RunThreaded(qint64 maxCycles)
+    {
+#ifdef CIE_THREADED_DISPATCH
+        static const void *const handlers[] = {
+            &&L_T_LDM,   &&L_T_LDD,   &&L_T_LDX,   &&L_T_LDR,   &&L_T_STO, &&L_T_STX,  &&L_T_ADD_M, &&L_T_ADD_I, &&L_T_INC,   &&L_T_DEC,
+            &&L_T_JMP,   &&L_T_CMP_M, &&L_T_CMP_I, &&L_T_JPE,   &&L_T_JPN, &&L_T_IN,   &&L_T_OUT,   &&L_T_AND_M, &&L_T_AND_I, &&L_T_XOR_M,
+            &&L_T_XOR_I, &&L_T_OR_M,  &&L_T_OR_I,  &&L_T_LSL,   &&L_T_LSR, &&L_T_END,  &&L_T_NOP,
+            &&L_T_LDD_STO,       &&L_T_LDD_ADD_M_STO, &&L_T_LDD_ADD_I_STO, &&L_T_LDD_INC_STO, &&L_T_LDD_DEC_STO,
+            &&L_T_CMP_M_JPE,     &&L_T_CMP_M_JPN,     &&L_T_CMP_I_JPE,     &&L_T_CMP_I_JPN,   &&L_T_INC_LDD_CMP_JPE,
+            &&L_T_INC_LDD_CMP_JPN, &&L_T_JMP_CHAIN,   &&L_T_JPE_CHAIN,     &&L_T_JPN_CHAIN,   &&L_T_TRAP, &&L_T_HALT,
+        };
+    #define HANDLER(op) L_##op:
+    #define DISPATCH()                                                                                                                          \
+        if (Q_UNLIKELY(budget-- == 0))                                                                                                          \
+            goto budgetExhausted;                                                                                                               \
+        goto *pc->handler
+#else
+    #define HANDLER(op) case op:
+    #define DISPATCH() continue
+#endif
+        // Translate the program into threaded code once per Load, SetBreakpoints or SetOptimized.
+        if (threadedCode.count() != program.decoded.count() + 1)
+        {
+            threadedCode.clear();
+            threadedCode.reserve(program.decoded.count() + 1);
+            const auto optimization = optimized ? OptimizeProgram(program.decoded, traps) : CIEAssemblyOptimization();
+            for (auto i = 0; i < program.decoded.count(); i++)
+            {
+                const auto &instruction = program.decoded.at(i);
+                ThreadedInstruction threaded;
+                threaded.opcode = !traps.isEmpty() && traps.at(i) ? T_TRAP
+                                  : optimized                     ? ToThreadedOpcode(program.decoded, i, optimization.instructions.at(i))
+                                                                  : ToThreadedOpcode(instruction);
+                threaded.address = instruction.address;
+                threaded.target = instruction.target;
+                threaded.immediate = instruction.immediate;
+                if (optimized && optimization.instructions.at(i).hops > 0)
+                {
+                    threaded.target = optimization.instructions.at(i).target;
+                    threaded.hops = optimization.instructions.at(i).hops;
+                }
+                threadedCode.append(threaded);
+            }
+            ThreadedInstruction halt;
+            halt.opcode = T_HALT;
+            threadedCode.append(halt);
+#ifdef CIE_THREADED_DISPATCH
+            for (auto &threaded : threadedCode)
+            {
+                threaded.handler = handlers[threaded.opcode];
+            }
+#endif
+        }
+        //
+        const auto *const code = threadedCode.constData();
+        const auto *pc = code + cir;
+        auto *const mem = memory.Data();
+        auto &acc = mem[CIEAssemblyMemory::ADDRESS_ACC];
+        auto &ix = mem[CIEAssemblyMemory::ADDRESS_IX];
+        auto compare = compareResult;
+        const auto startBudget = maxCycles < 0 ? std::numeric_limits<qint64>::max() : maxCycles;
+        auto budget = startBudget;
+        // A superinstruction covering n instructions saves n - 1 dispatches, a folded jump one per JMP skipped.
+        qint64 saved = 0;
+        int nextCir;
+        //
+#ifdef CIE_THREADED_DISPATCH
+        DISPATCH();
+#else
+        for (;;)
+        {
+            if (Q_UNLIKELY(budget-- == 0))
+                goto budgetExhausted;
+            switch (pc->opcode)
+            {
+#endif
+        HANDLER(T_LDM)
+        {
+            acc = pc->immediate;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_LDD)
+    singleLdd:
+        {
+            acc = mem[pc->address];
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_LDX)
+        {
+            acc = mem[CIEAssemblyMemory::Offset(pc->address, ix)];
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_LDR)
+        {
+            ix = pc->immediate;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_STO)
+        {
+            mem[pc->address] = acc;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_STX)
+        {
+            mem[CIEAssemblyMemory::Offset(pc->address, ix)] = acc;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_ADD_M)
+        {
+            acc += mem[pc->address];
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_ADD_I)
+        {
+            acc += pc->immediate;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_INC)
+    singleInc:
+        {
+            mem[pc->address]++;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_DEC)
+        {
+            mem[pc->address]--;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_JMP)
+        {
+            pc = code + pc->target;
+            DISPATCH();
+        }
+        HANDLER(T_CMP_M)
+    singleCmpM:
+        {
+            const long operand2 = mem[pc->address];
+            compare = (acc > operand2) ? RESULT_ARG1 : (acc == operand2) ? RESULT_EQUAL : RESULT_ARG2;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_CMP_I)
+    singleCmpI:
+        {
+            const auto operand2 = pc->immediate;
+            compare = (acc > operand2) ? RESULT_ARG1 : (acc == operand2) ? RESULT_EQUAL : RESULT_ARG2;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_JPE)
+        {
+            pc = compare == RESULT_EQUAL ? code + pc->target : pc + 1;
+            DISPATCH();
+        }
+        HANDLER(T_JPN)
+        {
+            pc = compare != RESULT_EQUAL ? code + pc->target : pc + 1;
+            DISPATCH();
+        }
+        HANDLER(T_IN)
+        {
+            const auto input = inputHandler ? inputHandler() : -1;
+            if (input < 0)
+            {
+                nextCir = -1;
+                goto finished;
+            }
+            acc = input;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_OUT)
+        {
+            if (outputHandler)
+            {
+                outputHandler(acc);
+            }
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_AND_M)
+        {
+            acc = mem[pc->address] & acc;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_AND_I)
+        {
+            acc = pc->immediate & acc;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_XOR_M)
+        {
+            acc = mem[pc->address] ^ acc;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_XOR_I)
+        {
+            acc = pc->immediate ^ acc;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_OR_M)
+        {
+            acc = mem[pc->address] | acc;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_OR_I)
+        {
+            acc = pc->immediate | acc;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_LSL)
+        {
+            acc = ShiftLeft(acc, pc->immediate);
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_LSR)
+        {
+            acc = ShiftRight(acc, pc->immediate);
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_NOP)
+        {
+            pc++;
+            DISPATCH();
+        }
+        // A superinstruction runs only if the budget pays for every instruction it covers, and for the longest path it may take,
+        // otherwise the plain handler of its first instruction runs and the budget runs out exactly where it would have.
+        HANDLER(T_LDD_STO)
+        {
+            if (Q_UNLIKELY(budget < 1))
+                goto singleLdd;
+            acc = mem[pc->address];
+            mem[pc[1].address] = acc;
+            budget -= 1;
+            saved += 1;
+            pc += 2;
+            DISPATCH();
+        }
+        HANDLER(T_LDD_ADD_M_STO)
+        {
+            if (Q_UNLIKELY(budget < 2))
+                goto singleLdd;
+            acc = mem[pc->address];
+            acc += mem[pc[1].address];
+            mem[pc[2].address] = acc;
+            budget -= 2;
+            saved += 2;
+            pc += 3;
+            DISPATCH();
+        }
+        HANDLER(T_LDD_ADD_I_STO)
+        {
+            if (Q_UNLIKELY(budget < 2))
+                goto singleLdd;
+            acc = mem[pc->address];
+            acc += pc[1].immediate;
+            mem[pc[2].address] = acc;
+            budget -= 2;
+            saved += 2;
+            pc += 3;
+            DISPATCH();
+        }
+        HANDLER(T_LDD_INC_STO)
+        {
+            if (Q_UNLIKELY(budget < 2))
+                goto singleLdd;
+            acc = mem[pc->address];
+            mem[pc[1].address]++;
+            mem[pc[2].address] = acc;
+            budget -= 2;
+            saved += 2;
+            pc += 3;
+            DISPATCH();
+        }
+        HANDLER(T_LDD_DEC_STO)
+        {
+            if (Q_UNLIKELY(budget < 2))
+                goto singleLdd;
+            acc = mem[pc->address];
+            mem[pc[1].address]--;
+            mem[pc[2].address] = acc;
+            budget -= 2;
+            saved += 2;
+            pc += 3;
+            DISPATCH();
+        }
+        HANDLER(T_CMP_M_JPE)
+        {
+            const auto *const jump = pc + 1;
+            if (Q_UNLIKELY(budget < 1 + jump->hops))
+                goto singleCmpM;
+            const long operand2 = mem[pc->address];
+            compare = (acc > operand2) ? RESULT_ARG1 : (acc == operand2) ? RESULT_EQUAL : RESULT_ARG2;
+            const auto taken = compare == RESULT_EQUAL;
+            budget -= taken ? 1 + jump->hops : 1;
+            saved += taken ? 1 + jump->hops : 1;
+            pc = taken ? code + jump->target : pc + 2;
+            DISPATCH();
+        }
+        HANDLER(T_CMP_M_JPN)
+        {
+            const auto *const jump = pc + 1;
+            if (Q_UNLIKELY(budget < 1 + jump->hops))
+                goto singleCmpM;
+            const long operand2 = mem[pc->address];
+            compare = (acc > operand2) ? RESULT_ARG1 : (acc == operand2) ? RESULT_EQUAL : RESULT_ARG2;
+            const auto taken = compare != RESULT_EQUAL;
+            budget -= taken ? 1 + jump->hops : 1;
+            saved += taken ? 1 + jump->hops : 1;
+            pc = taken ? code + jump->target : pc + 2;
+            DISPATCH();
+        }
+        HANDLER(T_CMP_I_JPE)
+        {
+            const auto *const jump = pc + 1;
+            if (Q_UNLIKELY(budget < 1 + jump->hops))
+                goto singleCmpI;
+            const auto operand2 = pc->immediate;
+            compare = (acc > operand2) ? RESULT_ARG1 : (acc == operand2) ? RESULT_EQUAL : RESULT_ARG2;
+            const auto taken = compare == RESULT_EQUAL;
+            budget -= taken ? 1 + jump->hops : 1;
+            saved += taken ? 1 + jump->hops : 1;
+            pc = taken ? code + jump->target : pc + 2;
+            DISPATCH();
+        }
+        HANDLER(T_CMP_I_JPN)
+        {
+            const auto *const jump = pc + 1;
+            if (Q_UNLIKELY(budget < 1 + jump->hops))
+                goto singleCmpI;
+            const auto operand2 = pc->immediate;
+            compare = (acc > operand2) ? RESULT_ARG1 : (acc == operand2) ? RESULT_EQUAL : RESULT_ARG2;
+            const auto taken = compare != RESULT_EQUAL;
+            budget -= taken ? 1 + jump->hops : 1;
+            saved += taken ? 1 + jump->hops : 1;
+            pc = taken ? code + jump->target : pc + 2;
+            DISPATCH();
+        }
+        HANDLER(T_INC_LDD_CMP_JPE)
+        {
+            const auto *const jump = pc + 3;
+            if (Q_UNLIKELY(budget < 3 + jump->hops))
+                goto singleInc;
+            mem[pc->address]++;
+            acc = mem[pc[1].address];
+            const auto operand2 = pc[2].immediate;
+            compare = (acc > operand2) ? RESULT_ARG1 : (acc == operand2) ? RESULT_EQUAL : RESULT_ARG2;
+            const auto taken = compare == RESULT_EQUAL;
+            budget -= taken ? 3 + jump->hops : 3;
+            saved += taken ? 3 + jump->hops : 3;
+            pc = taken ? code + jump->target : pc + 4;
+            DISPATCH();
+        }
+        HANDLER(T_INC_LDD_CMP_JPN)
+        {
+            const auto *const jump = pc + 3;
+            if (Q_UNLIKELY(budget < 3 + jump->hops))
+                goto singleInc;
+            mem[pc->address]++;
+            acc = mem[pc[1].address];
+            const auto operand2 = pc[2].immediate;
+            compare = (acc > operand2) ? RESULT_ARG1 : (acc == operand2) ? RESULT_EQUAL : RESULT_ARG2;
+            const auto taken = compare != RESULT_EQUAL;
+            budget -= taken ? 3 + jump->hops : 3;
+            saved += taken ? 3 + jump->hops : 3;
+            pc = taken ? code + jump->target : pc + 4;
+            DISPATCH();
+        }
+        // Without the budget for the whole chain, only the first jump is taken, the JMP it lands on follows the rest of the chain.
+        HANDLER(T_JMP_CHAIN)
+    takeChain:
+        {
+            if (Q_UNLIKELY(budget < pc->hops))
+            {
+                pc = code + program.decoded.at(pc - code).target;
+                DISPATCH();
+            }
+            budget -= pc->hops;
+            saved += pc->hops;
+            pc = code + pc->target;
+            DISPATCH();
+        }
+        HANDLER(T_JPE_CHAIN)
+        {
+            if (compare == RESULT_EQUAL)
+                goto takeChain;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_JPN_CHAIN)
+        {
+            if (compare != RESULT_EQUAL)
+                goto takeChain;
+            pc++;
+            DISPATCH();
+        }
+        HANDLER(T_TRAP)
+        {
+            // Not executed here, give its cycle back.
+            budget++;
+            nextCir = pc - code;
+            goto finished;
+        }
+        HANDLER(T_END)
+        {
+            nextCir = program.decoded.count();
+            goto finished;
+        }
+        HANDLER(T_HALT)
+        {
+            // Not an instruction of the program, give its cycle back.
+            budget++;
+            nextCir = program.decoded.count();
+            goto finished;
+        }
+#ifndef CIE_THREADED_DISPATCH
+            }
+        }
+#endif
+    budgetExhausted:
+        budget = 0;
+        nextCir = pc - code;
+    finished:
+        compareResult = compare;
+        cir = nextCir;
+        cycles += startBudget - budget;
+        savedDispatches += saved;
+        return startBudget - budget;
+#undef HANDLER
+#undef DISPATCH
+    }
+} // namespace CIEAssembly
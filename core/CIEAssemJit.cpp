@@ -0,0 +1,636 @@
+#include "CIEAssemJit.hpp"
+
+#include <cstddef>
+
+#ifdef CIE_JIT_X86_64
+    #include <cstring>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace CIEAssembly
+{
+#ifdef CIE_JIT_X86_64
+    namespace
+    {
+        enum Register
+        {
+            RAX = 0,
+            RCX = 1,
+            RDX = 2,
+            RBX = 3,
+            RSP = 4,
+            RBP = 5,
+            RSI = 6,
+            RDI = 7,
+            R12 = 12,
+            R13 = 13,
+            R14 = 14,
+            R15 = 15
+        };
+        // Register assignment of the generated code, all of them are callee-saved.
+        constexpr auto REG_CONTEXT = RBP;
+        constexpr auto REG_MEMORY = RBX;
+        constexpr auto REG_BUDGET = R12;
+        constexpr auto REG_ACC = R13;
+        constexpr auto REG_IX = R14;
+        constexpr auto REG_COMPARE = R15;
+        //
+        // Opcode extensions of the "/digit" instruction groups.
+        enum GroupOperation
+        {
+            OP_ADD = 0,
+            OP_OR = 1,
+            OP_AND = 4,
+            OP_SUB = 5,
+            OP_XOR = 6,
+            OP_CMP = 7
+        };
+        enum ShiftOperation
+        {
+            SHIFT_SHL = 4,
+            SHIFT_SAR = 7
+        };
+        enum Condition
+        {
+            COND_Z = 0x4,
+            COND_NZ = 0x5,
+            COND_NS = 0x9,
+            COND_L = 0xC
+        };
+
+        /// Just enough of an x86-64 assembler for the instructions the JIT needs. Jumps go to labels, resolved by Link.
+        class Assembler
+        {
+          public:
+            int Size() const
+            {
+                return code.size();
+            }
+            const QByteArray &Code() const
+            {
+                return code;
+            }
+            int NewLabel()
+            {
+                labels.append(-1);
+                return labels.count() - 1;
+            }
+            void Bind(int label)
+            {
+                labels[label] = code.size();
+            }
+            int LabelOffset(int label) const
+            {
+                return labels.at(label);
+            }
+            //
+            void Byte(quint8 byte)
+            {
+                code.append(char(byte));
+            }
+            void Int32(qint32 value)
+            {
+                code.append(reinterpret_cast<const char *>(&value), sizeof(value));
+            }
+            void Int64(qint64 value)
+            {
+                code.append(reinterpret_cast<const char *>(&value), sizeof(value));
+            }
+            /// op reg, rm
+            void RegReg(bool wide, std::initializer_list<quint8> opcode, int reg, int rm)
+            {
+                Rex(wide, reg, 0, rm);
+                Opcode(opcode);
+                Byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+            }
+            /// op reg, [base + displacement]
+            void RegMem(bool wide, std::initializer_list<quint8> opcode, int reg, int base, qint32 displacement)
+            {
+                Rex(wide, reg, 0, base);
+                Opcode(opcode);
+                Byte(0x80 | (reg & 7) << 3 | (base & 7));
+                if ((base & 7) == RSP)
+                {
+                    Byte(0x24);
+                }
+                Int32(displacement);
+            }
+            /// op reg, [base + index + displacement]
+            void RegMemIndex(bool wide, std::initializer_list<quint8> opcode, int reg, int base, int index, qint32 displacement)
+            {
+                Rex(wide, reg, index, base);
+                Opcode(opcode);
+                Byte(0x84 | (reg & 7) << 3);
+                Byte((index & 7) << 3 | (base & 7));
+                Int32(displacement);
+            }
+            void MovImm8(int reg, quint8 value)
+            {
+                Rex(false, 0, 0, reg);
+                Byte(0xB0 | (reg & 7));
+                Byte(value);
+            }
+            void MovImm32(int reg, qint32 value)
+            {
+                Rex(false, 0, 0, reg);
+                Byte(0xB8 | (reg & 7));
+                Int32(value);
+            }
+            void MovImm64(int reg, qint64 value)
+            {
+                Rex(true, 0, 0, reg);
+                Byte(0xB8 | (reg & 7));
+                Int64(value);
+            }
+            void Push(int reg)
+            {
+                Rex(false, 0, 0, reg);
+                Byte(0x50 | (reg & 7));
+            }
+            void Pop(int reg)
+            {
+                Rex(false, 0, 0, reg);
+                Byte(0x58 | (reg & 7));
+            }
+            void Call(int reg)
+            {
+                RegReg(false, { 0xFF }, 2, reg);
+            }
+            void JumpRegister(int reg)
+            {
+                RegReg(false, { 0xFF }, 4, reg);
+            }
+            void Jump(int label)
+            {
+                Byte(0xE9);
+                Fixup(label);
+            }
+            void JumpIf(Condition condition, int label)
+            {
+                Byte(0x0F);
+                Byte(0x80 | condition);
+                Fixup(label);
+            }
+            /// Resolves the jumps, every label they refer to must have been bound.
+            void Link()
+            {
+                for (const auto &fixup : qAsConst(fixups))
+                {
+                    const qint32 displacement = labels.at(fixup.second) - (fixup.first + 4);
+                    memcpy(code.data() + fixup.first, &displacement, sizeof(displacement));
+                }
+            }
+
+          private:
+            void Rex(bool wide, int reg, int index, int base)
+            {
+                const quint8 rex = 0x40 | (wide ? 8 : 0) | (reg & 8) >> 1 | (index & 8) >> 2 | (base & 8) >> 3;
+                // The byte registers the JIT uses are either below SPL or need a REX prefix anyway.
+                if (rex != 0x40)
+                {
+                    Byte(rex);
+                }
+            }
+            void Opcode(std::initializer_list<quint8> opcode)
+            {
+                for (const auto byte : opcode)
+                {
+                    Byte(byte);
+                }
+            }
+            void Fixup(int label)
+            {
+                fixups.append({ code.size(), label });
+                Int32(0);
+            }
+            //
+            QByteArray code;
+            QVector<int> labels;
+            QVector<QPair<int, int>> fixups;
+        };
+
+        int JitInput(CIEAssemblyJit::Context *context)
+        {
+            return *context->inputHandler ? (*context->inputHandler)() : -1;
+        }
+
+        void JitOutput(CIEAssemblyJit::Context *context, int c)
+        {
+            if (*context->outputHandler)
+            {
+                (*context->outputHandler)(char(c));
+            }
+        }
+
+        /// The register holding a memory slot, or -1 if the slot only lives in memory.
+        int RegisterOf(int address)
+        {
+            return address == CIEAssemblyMemory::ADDRESS_ACC ? REG_ACC : address == CIEAssemblyMemory::ADDRESS_IX ? REG_IX : -1;
+        }
+
+        /// Zero-extends the contents of a memory slot into EAX.
+        void LoadOperand(Assembler &as, int address)
+        {
+            const auto reg = RegisterOf(address);
+            if (reg >= 0)
+                as.RegReg(false, { 0x89 }, reg, RAX);
+            else
+                as.RegMem(false, { 0x0F, 0xB6 }, RAX, REG_MEMORY, address);
+        }
+
+        /// Sign-extends the contents of a memory slot into RAX.
+        void LoadOperandSigned(Assembler &as, int address)
+        {
+            const auto reg = RegisterOf(address);
+            if (reg >= 0)
+                as.RegReg(true, { 0x0F, 0xBE }, RAX, reg);
+            else
+                as.RegMem(true, { 0x0F, 0xBE }, RAX, REG_MEMORY, address);
+        }
+
+        /// Copies ACC and IX into memory, before an access that may reach their slots.
+        void SpillRegisters(Assembler &as)
+        {
+            as.RegMem(false, { 0x88 }, REG_ACC, REG_MEMORY, CIEAssemblyMemory::ADDRESS_ACC);
+            as.RegMem(false, { 0x88 }, REG_IX, REG_MEMORY, CIEAssemblyMemory::ADDRESS_IX);
+        }
+
+        void ReloadRegisters(Assembler &as)
+        {
+            as.RegMem(false, { 0x0F, 0xB6 }, REG_ACC, REG_MEMORY, CIEAssemblyMemory::ADDRESS_ACC);
+            as.RegMem(false, { 0x0F, 0xB6 }, REG_IX, REG_MEMORY, CIEAssemblyMemory::ADDRESS_IX);
+        }
+
+        /// LDX and STX: the slot is the block of the operand, plus the low byte of operand + IX.
+        void IndexedAccess(Assembler &as, int address, bool store)
+        {
+            const auto block = address & ~(CIEAssemblyMemory::BLOCK_SIZE - 1);
+            as.RegReg(false, { 0x89 }, REG_IX, RAX);
+            as.RegReg(false, { 0x80 }, OP_ADD, RAX);
+            as.Byte(quint8(address));
+            as.RegReg(false, { 0x0F, 0xB6 }, RAX, RAX);
+            // The register block may be indexed into ACC or IX.
+            const auto mayAliasRegisters = block == 0;
+            if (mayAliasRegisters)
+            {
+                SpillRegisters(as);
+            }
+            as.RegMemIndex(false, { quint8(store ? 0x88 : 0x8A) }, REG_ACC, REG_MEMORY, RAX, block);
+            if (mayAliasRegisters && store)
+            {
+                ReloadRegisters(as);
+            }
+        }
+    } // namespace
+
+    CIEAssemblyJit::~CIEAssemblyJit()
+    {
+        if (buffer)
+        {
+            munmap(buffer, bufferSize);
+        }
+    }
+
+    bool CIEAssemblyJit::IsSupported()
+    {
+        return true;
+    }
+
+    bool CIEAssemblyJit::Compile(const CIEAssemblyDecodedProgram &program, QString *errorMessage)
+    {
+        const auto count = program.count();
+        // Basic blocks start at jump targets and after jumps and END, the end of the program is a block of its own.
+        QVector<bool> leaders(count + 1, false);
+        leaders[0] = true;
+        leaders[count] = true;
+        for (auto i = 0; i < count; i++)
+        {
+            const auto &instruction = program.at(i);
+            if (IsJump(instruction.opcode))
+            {
+                leaders[instruction.target] = true;
+            }
+            if (InstructionInfo(instruction.opcode).flow != FLOW_NEXT)
+            {
+                leaders[i + 1] = true;
+            }
+        }
+        // blockEnds[i] is the first leader after i, so a block starting at i costs blockEnds[i] - i cycles.
+        QVector<int> blockEnds(count + 1, count);
+        for (auto i = count - 1; i >= 0; i--)
+        {
+            blockEnds[i] = leaders.at(i + 1) ? i + 1 : blockEnds.at(i + 1);
+        }
+        //
+        Assembler as;
+        QVector<int> instructionLabels;
+        for (auto i = 0; i <= count; i++)
+        {
+            instructionLabels << as.NewLabel();
+        }
+        const auto epilogue = as.NewLabel();
+        QHash<int, int> exitLabels;
+        const auto exitTo = [&](int cir) {
+            if (!exitLabels.contains(cir))
+            {
+                exitLabels.insert(cir, as.NewLabel());
+            }
+            return exitLabels.value(cir);
+        };
+        //
+        // int entry(Context *context, const void *instruction)
+        for (const auto reg : { RBX, RBP, R12, R13, R14, R15 })
+        {
+            as.Push(reg);
+        }
+        // Keeps the stack aligned for the handler calls.
+        as.RegReg(true, { 0x83 }, OP_SUB, RSP);
+        as.Byte(8);
+        as.RegReg(true, { 0x89 }, RDI, REG_CONTEXT);
+        as.RegMem(true, { 0x8B }, REG_MEMORY, REG_CONTEXT, offsetof(Context, memory));
+        as.RegMem(true, { 0x8B }, REG_BUDGET, REG_CONTEXT, offsetof(Context, budget));
+        as.RegMem(false, { 0x8B }, REG_COMPARE, REG_CONTEXT, offsetof(Context, compareResult));
+        ReloadRegisters(as);
+        as.JumpRegister(RSI);
+        //
+        for (auto i = 0; i < count; i++)
+        {
+            const auto &instruction = program.at(i);
+            const auto address = instruction.address;
+            const auto isMemory = instruction.operandType == MEMORY_LOCATION;
+            const auto unusedCycles = blockEnds.at(i) - i - 1;
+            as.Bind(instructionLabels.at(i));
+            if (leaders.at(i))
+            {
+                as.RegReg(true, { 0x81 }, OP_SUB, REG_BUDGET);
+                as.Int32(blockEnds.at(i) - i);
+            }
+            //
+            const auto emitAluOperation = [&](quint8 opcode, GroupOperation operation) {
+                if (isMemory)
+                {
+                    LoadOperand(as, address);
+                    as.RegReg(false, { opcode }, RAX, REG_ACC);
+                }
+                else
+                {
+                    as.RegReg(false, { 0x80 }, operation, REG_ACC);
+                    as.Byte(quint8(instruction.immediate));
+                }
+            };
+            const auto emitJump = [&](Condition condition, bool conditional) {
+                const auto target = instruction.target;
+                if (target > i)
+                {
+                    if (conditional)
+                        as.JumpIf(condition, instructionLabels.at(target));
+                    else
+                        as.Jump(instructionLabels.at(target));
+                    return;
+                }
+                // A back-edge, continue only if the budget covers the longest path to the next one.
+                const auto notTaken = as.NewLabel();
+                if (conditional)
+                {
+                    as.JumpIf(Condition(condition ^ 1), notTaken);
+                }
+                as.RegReg(true, { 0x81 }, OP_CMP, REG_BUDGET);
+                as.Int32(count + 1);
+                as.JumpIf(COND_L, exitTo(target));
+                as.Jump(instructionLabels.at(target));
+                as.Bind(notTaken);
+            };
+            //
+            switch (instruction.opcode)
+            {
+                case LDM:
+                {
+                    as.MovImm8(REG_ACC, quint8(instruction.immediate));
+                    break;
+                }
+                case LDD:
+                {
+                    const auto reg = RegisterOf(address);
+                    if (reg >= 0)
+                        as.RegReg(false, { 0x89 }, reg, REG_ACC);
+                    else
+                        as.RegMem(false, { 0x8A }, REG_ACC, REG_MEMORY, address);
+                    break;
+                }
+                case LDX:
+                {
+                    IndexedAccess(as, address, false);
+                    break;
+                }
+                case LDR:
+                {
+                    as.MovImm8(REG_IX, quint8(instruction.immediate));
+                    break;
+                }
+                case STO:
+                {
+                    const auto reg = RegisterOf(address);
+                    if (reg >= 0)
+                        as.RegReg(false, { 0x89 }, REG_ACC, reg);
+                    else
+                        as.RegMem(false, { 0x88 }, REG_ACC, REG_MEMORY, address);
+                    break;
+                }
+                case STX:
+                {
+                    IndexedAccess(as, address, true);
+                    break;
+                }
+                case ADD:
+                {
+                    emitAluOperation(0x00, OP_ADD);
+                    break;
+                }
+                case INC:
+                case DEC:
+                {
+                    const auto operation = instruction.opcode == INC ? 0 : 1;
+                    const auto reg = RegisterOf(address);
+                    if (reg >= 0)
+                        as.RegReg(false, { 0xFE }, operation, reg);
+                    else
+                        as.RegMem(false, { 0xFE }, operation, REG_MEMORY, address);
+                    break;
+                }
+                case JMP:
+                {
+                    emitJump(COND_Z, false);
+                    break;
+                }
+                case CMP:
+                {
+                    // compareResult = (ACC < operand) - (ACC > operand), compared as signed 64-bit numbers like the interpreter.
+                    if (isMemory)
+                        LoadOperandSigned(as, address);
+                    else
+                        as.MovImm64(RAX, instruction.immediate);
+                    as.RegReg(true, { 0x0F, 0xBE }, RCX, REG_ACC);
+                    as.RegReg(true, { 0x39 }, RAX, RCX);
+                    as.RegReg(false, { 0x0F, 0x9C }, 0, RAX);
+                    as.RegReg(false, { 0x0F, 0x9F }, 0, RDX);
+                    as.RegReg(false, { 0x0F, 0xB6 }, REG_COMPARE, RAX);
+                    as.RegReg(false, { 0x0F, 0xB6 }, RDX, RDX);
+                    as.RegReg(false, { 0x29 }, RDX, REG_COMPARE);
+                    break;
+                }
+                case JPE:
+                case JPN:
+                {
+                    as.RegReg(false, { 0x85 }, REG_COMPARE, REG_COMPARE);
+                    emitJump(instruction.opcode == JPE ? COND_Z : COND_NZ, true);
+                    break;
+                }
+                case IN:
+                {
+                    as.RegReg(true, { 0x89 }, REG_CONTEXT, RDI);
+                    as.MovImm64(RAX, qint64(&JitInput));
+                    as.Call(RAX);
+                    as.RegReg(false, { 0x85 }, RAX, RAX);
+                    const auto hasInput = as.NewLabel();
+                    as.JumpIf(COND_NS, hasInput);
+                    // Stopped: the rest of the block has been charged but does not run.
+                    as.RegReg(true, { 0x81 }, OP_ADD, REG_BUDGET);
+                    as.Int32(unusedCycles);
+                    as.MovImm32(RAX, -1);
+                    as.Jump(epilogue);
+                    as.Bind(hasInput);
+                    as.RegReg(false, { 0x89 }, RAX, REG_ACC);
+                    break;
+                }
+                case OUT:
+                {
+                    as.RegReg(true, { 0x89 }, REG_CONTEXT, RDI);
+                    as.RegReg(false, { 0x0F, 0xBE }, RSI, REG_ACC);
+                    as.MovImm64(RAX, qint64(&JitOutput));
+                    as.Call(RAX);
+                    break;
+                }
+                case AND:
+                {
+                    emitAluOperation(0x20, OP_AND);
+                    break;
+                }
+                case XOR:
+                {
+                    emitAluOperation(0x30, OP_XOR);
+                    break;
+                }
+                case OR:
+                {
+                    emitAluOperation(0x08, OP_OR);
+                    break;
+                }
+                case LSL:
+                case LSR:
+                {
+                    // A shift of the byte register, SAR keeps the sign like ShiftRight. ShiftCount is at most 8, within the 5 bits the
+                    // processor takes from the count.
+                    as.RegReg(false, { 0xC0 }, instruction.opcode == LSL ? SHIFT_SHL : SHIFT_SAR, REG_ACC);
+                    as.Byte(quint8(ShiftCount(instruction.immediate)));
+                    break;
+                }
+                case END:
+                {
+                    as.RegReg(true, { 0x81 }, OP_ADD, REG_BUDGET);
+                    as.Int32(unusedCycles);
+                    as.MovImm32(RAX, count);
+                    as.Jump(epilogue);
+                    break;
+                }
+                case LDI:
+                case STI:
+                default: break;
+            }
+        }
+        // Falling off the end of the program.
+        as.Bind(instructionLabels.at(count));
+        as.MovImm32(RAX, count);
+        as.Jump(epilogue);
+        //
+        for (auto it = exitLabels.constBegin(); it != exitLabels.constEnd(); ++it)
+        {
+            as.Bind(it.value());
+            as.MovImm32(RAX, it.key());
+            as.Jump(epilogue);
+        }
+        //
+        as.Bind(epilogue);
+        SpillRegisters(as);
+        as.RegMem(true, { 0x89 }, REG_BUDGET, REG_CONTEXT, offsetof(Context, budget));
+        as.RegMem(false, { 0x89 }, REG_COMPARE, REG_CONTEXT, offsetof(Context, compareResult));
+        as.RegReg(true, { 0x83 }, OP_ADD, RSP);
+        as.Byte(8);
+        for (const auto reg : { R15, R14, R13, R12, RBP, RBX })
+        {
+            as.Pop(reg);
+        }
+        as.Byte(0xC3);
+        as.Link();
+        //
+        // Write the code into a fresh mapping, then make it executable and read-only.
+        const qint64 pageSize = sysconf(_SC_PAGESIZE);
+        const auto size = (as.Size() + pageSize - 1) / pageSize * pageSize;
+        auto *const mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED)
+        {
+            *errorMessage = "Cannot allocate memory for the JIT.";
+            return false;
+        }
+        memcpy(mapping, as.Code().constData(), as.Size());
+        if (mprotect(mapping, size, PROT_READ | PROT_EXEC) != 0)
+        {
+            munmap(mapping, size);
+            *errorMessage = "Cannot make the JIT code executable.";
+            return false;
+        }
+        if (buffer)
+        {
+            munmap(buffer, bufferSize);
+        }
+        buffer = mapping;
+        bufferSize = size;
+        entry = reinterpret_cast<EntryFunction>(mapping);
+        //
+        offsets.clear();
+        entryCharges.clear();
+        for (auto i = 0; i <= count; i++)
+        {
+            offsets << as.LabelOffset(instructionLabels.at(i));
+            entryCharges << (leaders.at(i) ? 0 : blockEnds.at(i) - i);
+        }
+        return true;
+    }
+
+    int CIEAssemblyJit::Run(int cir, Context *context) const
+    {
+        context->budget -= entryCharges.at(cir);
+        return entry(context, static_cast<const char *>(buffer) + offsets.at(cir));
+    }
+#else
+    CIEAssemblyJit::~CIEAssemblyJit()
+    {
+    }
+
+    bool CIEAssemblyJit::IsSupported()
+    {
+        return false;
+    }
+
+    bool CIEAssemblyJit::Compile(const CIEAssemblyDecodedProgram &, QString *errorMessage)
+    {
+        *errorMessage = "The JIT is only available on x86-64.";
+        return false;
+    }
+
+    int CIEAssemblyJit::Run(int cir, Context *) const
+    {
+        return cir;
+    }
+#endif
+} // namespace CIEAssembly
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CIEAssemRunner.hpp"
+
+#include <QByteArray>
+#include <functional>
+
+// The JIT emits x86-64 code for the System V calling convention, other hosts keep using the interpreter.
+#if defined(Q_PROCESSOR_X86_64) && defined(Q_OS_UNIX)
+    #define CIE_JIT_X86_64
+#endif
+
+namespace CIEAssembly
+{
+    /// Native x86-64 code compiled from a decoded program.
+    ///
+    /// ACC, IX and the compare flag are kept in callee-saved registers while running, and written back to memory on exit.
+    /// Cycles are charged once per basic block, the budget is only checked at back-edges: a loop keeps running as long as the
+    /// budget can pay for any path to the next back-edge, otherwise the code returns and the interpreter finishes the budget exactly.
+    class CIEAssemblyJit
+    {
+        Q_DISABLE_COPY(CIEAssemblyJit)
+
+      public:
+        /// Shared with the generated code, which accesses the fields by their offsets.
+        struct Context
+        {
+            char *memory;
+            /// Cycles left, decreased by the generated code.
+            qint64 budget;
+            qint32 compareResult;
+            const std::function<int()> *inputHandler;
+            const std::function<void(char)> *outputHandler;
+        };
+        //
+        CIEAssemblyJit() = default;
+        ~CIEAssemblyJit();
+        /// True if this host can run code produced by the JIT.
+        static bool IsSupported();
+        /// Translates the program into native code, an error is reported if the host is not supported.
+        bool Compile(const CIEAssemblyDecodedProgram &program, QString *errorMessage);
+        bool IsCompiled() const
+        {
+            return entry != nullptr;
+        }
+        /// Run needs at least this many cycles in the budget: no path between two budget checks is longer than the program.
+        qint64 MinimumBudget() const
+        {
+            return entryCharges.count();
+        }
+        /// Runs from cir until the program finishes or is stopped, or until the budget gets too low to reach the next back-edge.
+        /// Returns the next CIR, -1 if IN ran out of input.
+        int Run(int cir, Context *context) const;
+
+      private:
+        typedef int (*EntryFunction)(Context *context, const void *instruction);
+        //
+        EntryFunction entry = nullptr;
+        void *buffer = nullptr;
+        qint64 bufferSize = 0;
+        /// Offset of the native code of every instruction, plus the end of the program.
+        QVector<int> offsets;
+        /// Cycles to charge when entering in the middle of a basic block, as the block charges its cycles on entry.
+        QVector<int> entryCharges;
+    };
+} // namespace CIEAssembly
@@ -0,0 +1,481 @@
+#include "CIEAssemLanes.hpp"
+
+#include <QElapsedTimer>
+#include <climits>
+#include <cstring>
+#include <limits>
+
+// SSE2 is part of every x86-64 target, AVX2 is used when the compiler targets it, with -mavx2 or /arch:AVX2. The vector comparison
+// is signed like the comparison of chars in ExecuteSingleInstruction. Define CIE_NO_VECTOR_LANES to compare with the plain loops.
+#if !defined(CIE_NO_VECTOR_LANES) && CHAR_MIN < 0
+    #if defined(__AVX2__)
+        #define CIE_LANES_AVX2
+        #include <immintrin.h>
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define CIE_LANES_SSE2
+        #include <emmintrin.h>
+    #endif
+#endif
+
+namespace CIEAssembly
+{
+    namespace
+    {
+        /// Rows are padded to a multiple of this many lanes, so the vector loops have no remainder.
+        constexpr int LANE_ALIGNMENT = 32;
+        /// The time limit is checked every that many cycles of the lockstep lanes.
+        constexpr qint64 LANE_TIME_CHECK_CYCLES = 1 << 12;
+
+#if defined(CIE_LANES_AVX2)
+        using Vector = __m256i;
+        constexpr int VECTOR_BYTES = 32;
+        inline Vector Load(const char *bytes)
+        {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bytes));
+        }
+        inline void Store(char *bytes, Vector vector)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(bytes), vector);
+        }
+        inline Vector Splat(char value)
+        {
+            return _mm256_set1_epi8(value);
+        }
+        inline Vector AddBytes(Vector a, Vector b)
+        {
+            return _mm256_add_epi8(a, b);
+        }
+        inline Vector AndBytes(Vector a, Vector b)
+        {
+            return _mm256_and_si256(a, b);
+        }
+        inline Vector OrBytes(Vector a, Vector b)
+        {
+            return _mm256_or_si256(a, b);
+        }
+        inline Vector XorBytes(Vector a, Vector b)
+        {
+            return _mm256_xor_si256(a, b);
+        }
+        inline Vector AndNotBytes(Vector a, Vector b)
+        {
+            return _mm256_andnot_si256(a, b);
+        }
+        inline Vector GreaterBytes(Vector a, Vector b)
+        {
+            return _mm256_cmpgt_epi8(a, b);
+        }
+        inline Vector EqualBytes(Vector a, Vector b)
+        {
+            return _mm256_cmpeq_epi8(a, b);
+        }
+#elif defined(CIE_LANES_SSE2)
+        using Vector = __m128i;
+        constexpr int VECTOR_BYTES = 16;
+        inline Vector Load(const char *bytes)
+        {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+        }
+        inline void Store(char *bytes, Vector vector)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(bytes), vector);
+        }
+        inline Vector Splat(char value)
+        {
+            return _mm_set1_epi8(value);
+        }
+        inline Vector AddBytes(Vector a, Vector b)
+        {
+            return _mm_add_epi8(a, b);
+        }
+        inline Vector AndBytes(Vector a, Vector b)
+        {
+            return _mm_and_si128(a, b);
+        }
+        inline Vector OrBytes(Vector a, Vector b)
+        {
+            return _mm_or_si128(a, b);
+        }
+        inline Vector XorBytes(Vector a, Vector b)
+        {
+            return _mm_xor_si128(a, b);
+        }
+        inline Vector AndNotBytes(Vector a, Vector b)
+        {
+            return _mm_andnot_si128(a, b);
+        }
+        inline Vector GreaterBytes(Vector a, Vector b)
+        {
+            return _mm_cmpgt_epi8(a, b);
+        }
+        inline Vector EqualBytes(Vector a, Vector b)
+        {
+            return _mm_cmpeq_epi8(a, b);
+        }
+#endif
+#if defined(CIE_LANES_AVX2) || defined(CIE_LANES_SSE2)
+    #define CIE_LANES_VECTOR
+#endif
+
+        // The operations on a row, byte by byte as ExecuteSingleInstruction does on a char, and on a vector of bytes.
+        struct AddLanes
+        {
+            static char Scalar(char a, char b)
+            {
+                return char(a + b);
+            }
+#ifdef CIE_LANES_VECTOR
+            static Vector Vectorized(Vector a, Vector b)
+            {
+                return AddBytes(a, b);
+            }
+#endif
+        };
+        struct AndLanes
+        {
+            static char Scalar(char a, char b)
+            {
+                return char(a & b);
+            }
+#ifdef CIE_LANES_VECTOR
+            static Vector Vectorized(Vector a, Vector b)
+            {
+                return AndBytes(a, b);
+            }
+#endif
+        };
+        struct OrLanes
+        {
+            static char Scalar(char a, char b)
+            {
+                return char(a | b);
+            }
+#ifdef CIE_LANES_VECTOR
+            static Vector Vectorized(Vector a, Vector b)
+            {
+                return OrBytes(a, b);
+            }
+#endif
+        };
+        struct XorLanes
+        {
+            static char Scalar(char a, char b)
+            {
+                return char(a ^ b);
+            }
+#ifdef CIE_LANES_VECTOR
+            static Vector Vectorized(Vector a, Vector b)
+            {
+                return XorBytes(a, b);
+            }
+#endif
+        };
+        /// The compare flag of CMP, RESULT_ARG1 where a > b, RESULT_EQUAL where they are equal and RESULT_ARG2 elsewhere.
+        struct CompareLanes
+        {
+            static char Scalar(char a, char b)
+            {
+                return char(a > b ? RESULT_ARG1 : a == b ? RESULT_EQUAL : RESULT_ARG2);
+            }
+#ifdef CIE_LANES_VECTOR
+            static Vector Vectorized(Vector a, Vector b)
+            {
+                // RESULT_ARG1 is -1, all bits set like the lanes where a > b.
+                const auto greater = GreaterBytes(a, b);
+                return OrBytes(greater, AndNotBytes(OrBytes(greater, EqualBytes(a, b)), Splat(char(RESULT_ARG2))));
+            }
+#endif
+        };
+
+        /// result = Operation(a, b) over the first bytes lanes of the rows, result may be a or b.
+        template <typename Operation> void Combine(char *result, const char *a, const char *b, int bytes)
+        {
+            auto i = 0;
+#ifdef CIE_LANES_VECTOR
+            for (; i + VECTOR_BYTES <= bytes; i += VECTOR_BYTES)
+            {
+                Store(result + i, Operation::Vectorized(Load(a + i), Load(b + i)));
+            }
+#endif
+            for (; i < bytes; i++)
+            {
+                result[i] = Operation::Scalar(a[i], b[i]);
+            }
+        }
+    } // namespace
+
+    CIEAssemblyLanes::CIEAssemblyLanes(const CIEAssemblyProgram &program) : program(program), machine(program)
+    {
+    }
+
+    void CIEAssemblyLanes::SetEngine(CIEAssemblyEngine engine)
+    {
+        machine.SetEngine(engine);
+    }
+
+    void CIEAssemblyLanes::SetOptimized(bool optimized)
+    {
+        machine.SetOptimized(optimized);
+    }
+
+    void CIEAssemblyLanes::SetLimits(const CIEAssemblyLimits &limits)
+    {
+        this->limits = limits;
+        machine.SetLimits(limits);
+    }
+
+    QVector<CIEAssemblyBatchResult> CIEAssemblyLanes::Run(const QVector<QByteArray> &inputs)
+    {
+        const auto laneCount = inputs.count();
+        QVector<CIEAssemblyBatchResult> results(laneCount);
+        splitLanes = 0;
+        QElapsedTimer timer;
+        timer.start();
+        if (limits.detectLoops)
+        {
+            for (auto lane = 0; lane < laneCount; lane++)
+            {
+                RunAlone({ 0, 0, RESULT_EQUAL, program.memory }, inputs.at(lane), 0, timer.elapsed(), &results[lane]);
+            }
+            return results;
+        }
+        //
+        // Row address holds the slot address of every lane, lane by lane.
+        const auto &decoded = program.decoded;
+        const auto count = decoded.count();
+        const auto memorySize = program.memory.Size();
+        const auto stride = (laneCount + LANE_ALIGNMENT - 1) & ~(LANE_ALIGNMENT - 1);
+        QVector<char> cells(memorySize * stride);
+        const auto rowOf = [&](int address) { return cells.data() + address * stride; };
+        for (auto address = 0; address < memorySize; address++)
+        {
+            memset(rowOf(address), program.memory[address], stride);
+        }
+        auto *const acc = rowOf(CIEAssemblyMemory::ADDRESS_ACC);
+        auto *const ix = rowOf(CIEAssemblyMemory::ADDRESS_IX);
+        QVector<char> compare(stride, char(RESULT_EQUAL));
+        QVector<char> operandRow(stride);
+        QVector<int> inputPositions(laneCount, 0);
+        // The lanes still in lockstep, the rows of the others are stale.
+        QVector<int> live(laneCount);
+        for (auto lane = 0; lane < laneCount; lane++)
+        {
+            live[lane] = lane;
+        }
+        auto cir = 0;
+        qint64 cycles = 0;
+        //
+        const auto memoryOf = [&](int lane) {
+            auto memory = program.memory;
+            auto *data = memory.Data();
+            for (auto address = 0; address < memorySize; address++)
+            {
+                data[address] = cells.at(address * stride + lane);
+            }
+            return memory;
+        };
+        const auto finish = [&](int lane, int laneCir, const CIEAssemblyBreak &lastBreak) {
+            auto &result = results[lane];
+            result.memory = memoryOf(lane);
+            result.cycles = cycles;
+            result.cir = laneCir;
+            result.lastBreak = lastBreak;
+        };
+        const auto finishAll = [&](const CIEAssemblyBreak &lastBreak) {
+            for (const auto lane : live)
+            {
+                finish(lane, cir, lastBreak);
+            }
+            live.clear();
+        };
+        const auto operandOf = [&](const CIEAssemblyDecodedInstruction &instruction) -> const char * {
+            if (instruction.operandType == MEMORY_LOCATION)
+            {
+                return rowOf(instruction.address);
+            }
+            memset(operandRow.data(), char(instruction.immediate), stride);
+            return operandRow.constData();
+        };
+        //
+        while (!live.isEmpty())
+        {
+            if (cir < 0 || cir >= count)
+            {
+                finishAll(CIEAssemblyBreak());
+                break;
+            }
+            if (limits.maxCycles >= 0 && cycles >= limits.maxCycles)
+            {
+                finishAll({ CIEAssemblyBreak::BREAK_CYCLE_LIMIT, cir, -1 });
+                break;
+            }
+            if (limits.timeoutMs >= 0 && cycles % LANE_TIME_CHECK_CYCLES == 0 && timer.elapsed() >= limits.timeoutMs)
+            {
+                finishAll({ CIEAssemblyBreak::BREAK_TIME_LIMIT, cir, -1 });
+                break;
+            }
+            const auto &instruction = decoded.at(cir);
+            const auto operand = instruction.address;
+            cycles++;
+            auto next = cir + 1;
+            switch (instruction.opcode)
+            {
+                case LDM: memset(acc, char(instruction.immediate), stride); break;
+                case LDD: memmove(acc, rowOf(operand), stride); break;
+                case LDX:
+                {
+                    for (const auto lane : live)
+                    {
+                        acc[lane] = rowOf(CIEAssemblyMemory::Offset(operand, ix[lane]))[lane];
+                    }
+                    break;
+                }
+                case LDR: memset(ix, char(instruction.immediate), stride); break;
+                case STO: memmove(rowOf(operand), acc, stride); break;
+                case STX:
+                {
+                    for (const auto lane : live)
+                    {
+                        rowOf(CIEAssemblyMemory::Offset(operand, ix[lane]))[lane] = acc[lane];
+                    }
+                    break;
+                }
+                case LDI:
+                case STI: break;
+                case ADD: Combine<AddLanes>(acc, acc, operandOf(instruction), stride); break;
+                case INC:
+                case DEC:
+                {
+                    memset(operandRow.data(), instruction.opcode == INC ? 1 : -1, stride);
+                    Combine<AddLanes>(rowOf(operand), rowOf(operand), operandRow.constData(), stride);
+                    break;
+                }
+                case JMP: next = instruction.target; break;
+                case CMP:
+                {
+                    // A number out of the range of char compares the same way with every ACC.
+                    const auto number = instruction.immediate;
+                    if (instruction.operandType != MEMORY_LOCATION && number > std::numeric_limits<char>::max())
+                    {
+                        memset(compare.data(), char(RESULT_ARG2), stride);
+                    }
+                    else if (instruction.operandType != MEMORY_LOCATION && number < std::numeric_limits<char>::min())
+                    {
+                        memset(compare.data(), char(RESULT_ARG1), stride);
+                    }
+                    else
+                    {
+                        Combine<CompareLanes>(compare.data(), acc, operandOf(instruction), stride);
+                    }
+                    break;
+                }
+                case JPE:
+                case JPN:
+                {
+                    const auto jumpsOnEqual = instruction.opcode == JPE;
+                    const auto jumps = [&](int lane) { return (compare.at(lane) == RESULT_EQUAL) == jumpsOnEqual; };
+                    auto jumping = 0;
+                    for (const auto lane : live)
+                    {
+                        jumping += jumps(lane);
+                    }
+                    // The larger side stays in lockstep, the lanes of the other side split off.
+                    const auto staysJumping = jumping * 2 >= live.count();
+                    next = staysJumping ? instruction.target : cir + 1;
+                    if (jumping == 0 || jumping == live.count())
+                    {
+                        break;
+                    }
+                    const auto splitCir = staysJumping ? cir + 1 : instruction.target;
+                    auto kept = 0;
+                    for (const auto lane : live)
+                    {
+                        if (jumps(lane) == staysJumping)
+                        {
+                            live[kept++] = lane;
+                            continue;
+                        }
+                        const CIEAssemblyHistory::Checkpoint state{ cycles, splitCir, CIEAssemblyCompareResult(compare.at(lane)), memoryOf(lane) };
+                        RunAlone(state, inputs.at(lane), inputPositions.at(lane), timer.elapsed(), &results[lane]);
+                    }
+                    live.resize(kept);
+                    break;
+                }
+                case IN:
+                {
+                    // A lane without input left stops here.
+                    auto kept = 0;
+                    for (const auto lane : live)
+                    {
+                        auto &position = inputPositions[lane];
+                        if (position < inputs.at(lane).size())
+                        {
+                            acc[lane] = inputs.at(lane).at(position++);
+                            live[kept++] = lane;
+                        }
+                        else
+                        {
+                            finish(lane, -1, CIEAssemblyBreak());
+                        }
+                    }
+                    live.resize(kept);
+                    break;
+                }
+                case OUT:
+                {
+                    for (const auto lane : live)
+                    {
+                        results[lane].output.append(acc[lane]);
+                    }
+                    break;
+                }
+                case LSL:
+                {
+                    for (auto lane = 0; lane < stride; lane++)
+                    {
+                        acc[lane] = ShiftLeft(acc[lane], instruction.immediate);
+                    }
+                    break;
+                }
+                case LSR:
+                {
+                    for (auto lane = 0; lane < stride; lane++)
+                    {
+                        acc[lane] = ShiftRight(acc[lane], instruction.immediate);
+                    }
+                    break;
+                }
+                case AND: Combine<AndLanes>(acc, acc, operandOf(instruction), stride); break;
+                case XOR: Combine<XorLanes>(acc, acc, operandOf(instruction), stride); break;
+                case OR: Combine<OrLanes>(acc, acc, operandOf(instruction), stride); break;
+                case END: next = count; break;
+            }
+            cir = next;
+        }
+        return results;
+    }
+
+    void CIEAssemblyLanes::RunAlone(const CIEAssemblyHistory::Checkpoint &state, const QByteArray &input, int inputPosition, qint64 elapsedMs,
+                                    CIEAssemblyBatchResult *result)
+    {
+        if (limits.timeoutMs >= 0)
+        {
+            auto laneLimits = limits;
+            laneLimits.timeoutMs = qMax<qint64>(0, limits.timeoutMs - elapsedMs);
+            machine.SetLimits(laneLimits);
+        }
+        machine.Restore(state);
+        machine.SetInputHandler([&]() -> int { return inputPosition < input.size() ? quint8(input.at(inputPosition++)) : -1; });
+        machine.SetOutputHandler([&](char c) { result->output.append(c); });
+        machine.Run();
+        machine.SetInputHandler(nullptr);
+        machine.SetOutputHandler(nullptr);
+        //
+        result->memory = machine.Memory();
+        result->cycles = machine.Cycles();
+        result->cir = machine.CIR();
+        result->savedDispatches = machine.SavedDispatches();
+        result->lastBreak = machine.LastBreak();
+        splitLanes++;
+    }
+} // namespace CIEAssembly
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CIEAssemBatch.hpp"
+
+namespace CIEAssembly
+{
+    /// Runs one program over many inputs at once, as when a submission is graded against all of its test vectors.
+    ///
+    /// The lanes share the decoded program and execute it in lockstep. Their state is stored as a structure of arrays: every
+    /// memory slot, ACC and IX included, is a row holding its value in every lane, so an instruction is executed for all the
+    /// lanes by a few vector operations over its rows, with AVX2 or SSE2 when the compiler targets them and plain loops otherwise.
+    /// The lanes stay together as long as they go the same way at JPE and JPN. Where they do not, the larger side carries on in
+    /// lockstep and every lane of the other side splits off: its state is restored into a CIEAssemblyMachine, which finishes it
+    /// on its own. A lane that runs out of input stops there, as in CIEAssemblyBatchRunner.
+    class CIEAssemblyLanes
+    {
+      public:
+        explicit CIEAssemblyLanes(const CIEAssemblyProgram &program);
+        /// How the lanes that split off are run, see CIEAssemblyMachine.
+        void SetEngine(CIEAssemblyEngine engine);
+        void SetOptimized(bool optimized);
+        /// The cycle and time limits stop every lane as if it ran on its own machine. The loop detector compares the states of a
+        /// single machine at its back-edges: with it, every lane runs on its own from the start.
+        void SetLimits(const CIEAssemblyLimits &limits);
+        //
+        /// Runs the program once per input, whose characters are consumed by IN. Blocks until every lane has stopped, results have
+        /// the same indexes as inputs. Only the lanes that split off save dispatches.
+        QVector<CIEAssemblyBatchResult> Run(const QVector<QByteArray> &inputs);
+        /// Lanes of the last Run that were finished on their own machine.
+        int SplitLanes() const
+        {
+            return splitLanes;
+        }
+
+      private:
+        /// Runs a lane on the machine from the given state until it stops, elapsedMs being taken from the time limit.
+        void RunAlone(const CIEAssemblyHistory::Checkpoint &state, const QByteArray &input, int inputPosition, qint64 elapsedMs,
+                      CIEAssemblyBatchResult *result);
+        //
+        CIEAssemblyProgram program;
+        CIEAssemblyMachine machine;
+        CIEAssemblyLimits limits;
+        int splitLanes = 0;
+    };
+} // namespace CIEAssembly
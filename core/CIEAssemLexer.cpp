@@ -0,0 +1,88 @@
+#include "CIEAssemLexer.hpp"
+
+namespace CIEAssembly
+{
+    namespace
+    {
+        bool Spells(const QChar *text, int length, const char *word)
+        {
+            for (auto i = 0; i < length; i++)
+            {
+                if (word[i] == 0 || text[i] != QLatin1Char(word[i]))
+                {
+                    return false;
+                }
+            }
+            return word[length] == 0;
+        }
+    } // namespace
+
+    bool CIEAssemblyLexer::Next(CIEAssemblyToken *token)
+    {
+        while (position < length && text[position].isSpace())
+        {
+            position++;
+        }
+        if (position >= length)
+        {
+            return false;
+        }
+        //
+        token->start = position;
+        if (text[position] == QLatin1Char(';'))
+        {
+            token->type = TOKEN_COMMENT;
+            token->length = length - position;
+            position = length;
+            return true;
+        }
+        auto hasColon = false;
+        while (position < length && !text[position].isSpace() && text[position] != QLatin1Char(';'))
+        {
+            hasColon |= text[position] == QLatin1Char(':');
+            position++;
+        }
+        token->length = position - token->start;
+        const auto *word = text + token->start;
+        //
+        switch (wordIndex++)
+        {
+            case 0:
+            {
+                if (hasColon)
+                {
+                    // A label is only a label when nothing else is on the line.
+                    auto next = position;
+                    while (next < length && text[next].isSpace())
+                    {
+                        next++;
+                    }
+                    if (next == length || text[next] == QLatin1Char(';'))
+                    {
+                        token->type = TOKEN_LABEL;
+                        return true;
+                    }
+                }
+                const auto opcode = LookupOpcode(word, token->length);
+                token->type = opcode < 0 ? TOKEN_INVALID : TOKEN_OPCODE;
+                token->opcode = CIEAssemblyOpcode(opcode);
+                return true;
+            }
+            case 1:
+            {
+                if (word[0] == QLatin1Char('#'))
+                    token->type = TOKEN_IMMEDIATE;
+                else if (Spells(word, token->length, "ACC") || Spells(word, token->length, "IX"))
+                    token->type = TOKEN_REGISTER;
+                else
+                    token->type = TOKEN_SYMBOL;
+                return true;
+            }
+            default:
+            {
+                token->type = TOKEN_EXTRA;
+                return true;
+            }
+        }
+    }
+} // namespace CIEAssembly
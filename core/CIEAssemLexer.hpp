@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CIEAssemInstructionSet.hpp"
+#include "Common.hpp"
+
+#include <QStringView>
+
+namespace CIEAssembly
+{
+    enum CIEAssemblyTokenType
+    {
+        /// "name:" alone on its line.
+        TOKEN_LABEL,
+        TOKEN_OPCODE,
+        /// "ACC" or "IX" as the operand.
+        TOKEN_REGISTER,
+        /// An operand starting with "#".
+        TOKEN_IMMEDIATE,
+        /// Any other operand, a memory location or a jump target.
+        TOKEN_SYMBOL,
+        /// Words after the operand, the parser ignores them.
+        TOKEN_EXTRA,
+        TOKEN_COMMENT,
+        /// A first word that is neither a label nor an opcode.
+        TOKEN_INVALID
+    };
+
+    struct CIEAssemblyToken
+    {
+        CIEAssemblyTokenType type;
+        int start;
+        int length;
+        /// Only meaningful for TOKEN_OPCODE.
+        CIEAssemblyOpcode opcode;
+    };
+
+    /// Splits one line into tokens in a single left-to-right scan, without allocating.
+    ///
+    /// Words are separated by whitespace and a ";" starts a comment, even in the middle of a word. The first word is the label or the opcode,
+    /// the second one is the operand. Shared by the parser and the highlighter, so both always agree on what a line means.
+    class CIEAssemblyLexer
+    {
+      public:
+        explicit CIEAssemblyLexer(QStringView line) : text(line.data()), length(int(line.size())){};
+        /// Returns false at the end of the line.
+        bool Next(CIEAssemblyToken *token);
+
+      private:
+        const QChar *text;
+        int length;
+        int position = 0;
+        int wordIndex = 0;
+    };
+} // namespace CIEAssembly
@@ -0,0 +1,350 @@
+#include "CIEAssemLoader.hpp"
+
+#include <QAtomicInt>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <cstring>
+#include <functional>
+
+namespace CIEAssembly
+{
+    namespace
+    {
+        /// Number of instructions linked by one task.
+        constexpr int LINK_CHUNK_INSTRUCTIONS = 1 << 16;
+
+        class FunctionTask : public QRunnable
+        {
+          public:
+            explicit FunctionTask(const std::function<void()> &function) : function(function){};
+            void run() override
+            {
+                function();
+            }
+
+          private:
+            std::function<void()> function;
+        };
+
+        /// Lines [firstLine, endLine) of the source, parsed on their own.
+        struct Chunk
+        {
+            int firstLine = 0;
+            int endLine = 0;
+            /// labelId is 0 before the first label declared in the chunk, 1 + the index into labels after it. labelOffset counts
+            /// from there.
+            CIEAssemblyCodeModel code;
+            /// The address of a memory operand is an index into symbols.
+            CIEAssemblyDecodedProgram decoded;
+            /// Index of the operand of every instruction into operands.
+            QVector<int> operandIndexes;
+            QVector<int> lines;
+            /// Distinct operands, in the order the instructions use them.
+            QStringList operands;
+            /// Distinct memory operands, in the order the instructions use them, as indexes into operands.
+            QVector<int> symbols;
+            /// Labels declared, in order, with the index in code of the first instruction after each declaration.
+            QStringList labels;
+            QVector<int> labelStarts;
+            /// The first invalid line stops the chunk, and the load.
+            bool invalid = false;
+            QString errorMessage;
+            bool done = false;
+        };
+
+        /// The mapped source and its index, read by every task.
+        struct Source
+        {
+            const char *data;
+            /// Offset of the first character of every line, then the size of the source plus one, as if it ended with "\n".
+            QVector<qint64> lineStarts;
+            bool wantLines;
+        };
+
+        void ParseChunk(const Source &source, Chunk *chunk)
+        {
+            QHash<QString, int> operandIds;
+            QHash<int, int> symbolIds;
+            CIEAssemblyStringTable strings;
+            const auto parse = [&](QStringView text, int line) {
+                const auto parsed = ParseAssemblyLine(text, &strings);
+                switch (parsed.type)
+                {
+                    case LINE_EMPTY: break;
+                    case LINE_INVALID:
+                    {
+                        chunk->invalid = true;
+                        chunk->errorMessage = parsed.errorMessage;
+                        return false;
+                    }
+                    case LINE_LABEL:
+                    {
+                        chunk->labels << parsed.label;
+                        chunk->labelStarts << chunk->code.count();
+                        break;
+                    }
+                    case LINE_INSTRUCTION:
+                    {
+                        auto instruction = parsed.instruction;
+                        instruction.labelId = chunk->labels.count();
+                        instruction.labelOffset = chunk->code.count() - (chunk->labels.isEmpty() ? 0 : chunk->labelStarts.last());
+                        auto operandId = operandIds.value(instruction.operand, -1);
+                        if (operandId < 0)
+                        {
+                            operandId = chunk->operands.count();
+                            operandIds.insert(instruction.operand, operandId);
+                            chunk->operands << instruction.operand;
+                        }
+                        instruction.operand = chunk->operands.at(operandId);
+                        auto decoded = parsed.decoded;
+                        if (decoded.operandType == MEMORY_LOCATION)
+                        {
+                            auto symbol = symbolIds.value(operandId, -1);
+                            if (symbol < 0)
+                            {
+                                symbol = chunk->symbols.count();
+                                symbolIds.insert(operandId, symbol);
+                                chunk->symbols << operandId;
+                            }
+                            decoded.address = symbol;
+                        }
+                        chunk->code << instruction;
+                        chunk->decoded << decoded;
+                        chunk->operandIndexes << operandId;
+                        if (source.wantLines)
+                        {
+                            chunk->lines << line;
+                        }
+                        break;
+                    }
+                }
+                return true;
+            };
+            // Lines are almost always ASCII, widened into the same buffer instead of a new string each.
+            QString text;
+            const auto decode = [&text](const char *begin, const char *end) {
+                text.resize(int(end - begin));
+                auto *out = text.data();
+                for (const auto *in = begin; in < end; in++, out++)
+                {
+                    if (*in & 0x80)
+                    {
+                        text = QString::fromUtf8(begin, int(end - begin));
+                        return;
+                    }
+                    *out = QLatin1Char(*in);
+                }
+            };
+            for (auto line = chunk->firstLine; line < chunk->endLine; line++)
+            {
+                const auto *begin = source.data + source.lineStarts.at(line);
+                const auto *const end = source.data + source.lineStarts.at(line + 1) - 1;
+                // Lines are also split at "\r", as by ParseAssemblyCode.
+                while (begin < end)
+                {
+                    const auto *carriageReturn = static_cast<const char *>(memchr(begin, '\r', end - begin));
+                    const auto *const segmentEnd = carriageReturn ? carriageReturn : end;
+                    if (segmentEnd > begin)
+                    {
+                        decode(begin, segmentEnd);
+                        if (!parse(text, line))
+                        {
+                            return;
+                        }
+                    }
+                    begin = segmentEnd + 1;
+                }
+            }
+        }
+    } // namespace
+
+    bool LoadAssemblyFile(const QString &fileName, CIEAssemblyProgram *program, QString *errorMessage, QVector<int> *instructionLines, int threadCount)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            *errorMessage = "Cannot open " + fileName + ": " + file.errorString();
+            return false;
+        }
+        const auto size = file.size();
+        Source source{ "", {}, instructionLines != nullptr };
+        if (size > 0)
+        {
+            source.data = reinterpret_cast<const char *>(file.map(0, size));
+            if (!source.data)
+            {
+                *errorMessage = "Cannot map " + fileName + ": " + file.errorString();
+                return false;
+            }
+        }
+        source.lineStarts << 0;
+        for (const auto *next = source.data; (next = static_cast<const char *>(memchr(next, '\n', source.data + size - next)));)
+        {
+            next++;
+            source.lineStarts << next - source.data;
+        }
+        source.lineStarts << size + 1;
+        const auto lineCount = source.lineStarts.count() - 1;
+        //
+        QVector<Chunk> chunks((lineCount + LOAD_CHUNK_LINES - 1) / LOAD_CHUNK_LINES);
+        QThreadPool pool;
+        pool.setMaxThreadCount(qMax(1, threadCount));
+        QMutex mutex;
+        QWaitCondition chunkDone;
+        QAtomicInt stopped;
+        for (auto i = 0; i < chunks.count(); i++)
+        {
+            chunks[i].firstLine = i * LOAD_CHUNK_LINES;
+            chunks[i].endLine = qMin(lineCount, chunks.at(i).firstLine + LOAD_CHUNK_LINES);
+            auto *const chunk = &chunks[i];
+            // The pool deletes the task once it has run.
+            pool.start(new FunctionTask([&, chunk] {
+                if (!stopped.loadAcquire())
+                {
+                    ParseChunk(source, chunk);
+                }
+                QMutexLocker locker(&mutex);
+                chunk->done = true;
+                chunkDone.wakeAll();
+            }));
+        }
+        //
+        // The serial pass, in the order of the source.
+        CIEAssemblyCodeModel code;
+        CIEAssemblyDecodedProgram decoded;
+        QVector<int> lines;
+        CIEAssemblyMemory memory;
+        QStringList labelNames{ "_init_" };
+        QHash<QString, int> labelIds{ { "_init_", 0 } };
+        QHash<QString, QString> operandStrings;
+        auto lastLabel = 0;
+        auto labelOffset = 0;
+        for (auto &chunk : chunks)
+        {
+            {
+                QMutexLocker locker(&mutex);
+                while (!chunk.done)
+                {
+                    chunkDone.wait(&mutex);
+                }
+            }
+            if (chunk.invalid)
+            {
+                *errorMessage = chunk.errorMessage;
+                // The chunks after it are not needed to report it.
+                stopped.storeRelease(1);
+                pool.waitForDone();
+                return false;
+            }
+            QVector<int> labelMap;
+            for (auto i = 0; i < chunk.labels.count(); i++)
+            {
+                const auto &label = chunk.labels.at(i);
+                auto labelId = labelIds.value(label, -1);
+                if (labelId < 0)
+                {
+                    labelId = labelNames.count();
+                    labelIds.insert(label, labelId);
+                    labelNames << label;
+                }
+                labelMap << labelId;
+            }
+            QVector<int> addresses;
+            for (const auto operandId : chunk.symbols)
+            {
+                addresses << memory.Intern(chunk.operands.at(operandId));
+            }
+            QStringList operands;
+            for (const auto &operand : chunk.operands)
+            {
+                auto shared = operandStrings.constFind(operand);
+                if (shared == operandStrings.constEnd())
+                {
+                    shared = operandStrings.insert(operand, operand);
+                }
+                operands << shared.value();
+            }
+            for (auto i = 0; i < chunk.code.count(); i++)
+            {
+                auto instruction = chunk.code.at(i);
+                if (instruction.labelId == 0)
+                {
+                    instruction.labelId = lastLabel;
+                    instruction.labelOffset += labelOffset;
+                }
+                else
+                {
+                    instruction.labelId = labelMap.at(instruction.labelId - 1);
+                }
+                instruction.operand = operands.at(chunk.operandIndexes.at(i));
+                auto decodedInstruction = chunk.decoded.at(i);
+                if (decodedInstruction.operandType == MEMORY_LOCATION)
+                {
+                    decodedInstruction.address = addresses.at(decodedInstruction.address);
+                }
+                code << instruction;
+                decoded << decodedInstruction;
+            }
+            lines << chunk.lines;
+            if (chunk.labels.isEmpty())
+            {
+                labelOffset += chunk.code.count();
+            }
+            else
+            {
+                lastLabel = labelMap.last();
+                labelOffset = chunk.code.count() - chunk.labelStarts.last();
+            }
+            chunk = Chunk();
+        }
+        pool.waitForDone();
+        //
+        const CIEAssemblyLinker linker(code, labelNames);
+        // As LinkAssemblyCode, over ranges of instructions in parallel: the first jump to a missing label is reported.
+        QVector<int> firstMissing((code.count() + LINK_CHUNK_INSTRUCTIONS - 1) / LINK_CHUNK_INSTRUCTIONS, -1);
+        auto *const decodedData = decoded.data();
+        for (auto range = 0; range < firstMissing.count(); range++)
+        {
+            pool.start(new FunctionTask([&, range] {
+                const auto end = qMin(code.count(), (range + 1) * LINK_CHUNK_INSTRUCTIONS);
+                for (auto i = range * LINK_CHUNK_INSTRUCTIONS; i < end; i++)
+                {
+                    auto &instruction = decodedData[i];
+                    if (instruction.operandType != LABEL)
+                    {
+                        continue;
+                    }
+                    instruction.target = linker.Target(code.at(i).operand);
+                    if (instruction.target < 0)
+                    {
+                        firstMissing[range] = i;
+                        return;
+                    }
+                }
+            }));
+        }
+        pool.waitForDone();
+        for (const auto missing : firstMissing)
+        {
+            if (missing >= 0)
+            {
+                *errorMessage = "Cannot find label: " + code.at(missing).operand;
+                return false;
+            }
+        }
+        //
+        program->code = code;
+        program->decoded = decoded;
+        program->labelNames = labelNames;
+        program->memory = memory;
+        if (instructionLines)
+        {
+            *instructionLines = lines;
+        }
+        return true;
+    }
+} // namespace CIEAssembly
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "CIEAssemRunner.hpp"
+
+#include <QThread>
+#include <QVector>
+
+namespace CIEAssembly
+{
+    /// Number of lines of the source parsed by one task of LoadAssemblyFile.
+    constexpr int LOAD_CHUNK_LINES = 1 << 14;
+    //
+    /// Assembles a source file like ParseAssemblyCode, without ever holding the whole source or all of its lines as strings.
+    ///
+    /// The file is mapped and an index of the offsets of its lines is built. Chunks of LOAD_CHUNK_LINES lines are parsed on
+    /// threadCount threads, each into instructions numbered from the labels declared in the chunk, with the memory operands
+    /// numbered in the order the chunk uses them. A serial pass takes the chunks in order as they are done: it numbers the
+    /// labels of the whole program, carrying the last label and its offset across chunk boundaries, interns the memory in the
+    /// order of the source and frees the chunk. The jumps are then linked in parallel. Besides the program itself, the memory
+    /// needed is the mapping, the index and the chunks parsed but not taken yet. Operand strings are shared by the instructions.
+    ///
+    /// instructionLines receives the 0-based line of every instruction, lines being separated by "\n" as in the editor, it
+    /// may be null.
+    bool LoadAssemblyFile(const QString &fileName, CIEAssemblyProgram *program, QString *errorMessage, QVector<int> *instructionLines = nullptr,
+                          int threadCount = QThread::idealThreadCount());
+} // namespace CIEAssembly
@@ -0,0 +1,744 @@
+#include "CIEAssemMachine.hpp"
+
+#include <cstring>
+#include <limits>
+
+#define ACC memory[CIEAssemblyMemory::ADDRESS_ACC]
+#define IX memory[CIEAssemblyMemory::ADDRESS_IX]
+#define MARK_CHANGED(address)                                                                                                                   \
+    if (changedMemory)                                                                                                                          \
+    *changedMemory << (address)
+
+namespace CIEAssembly
+{
+    namespace
+    {
+        /// With a time limit, the engines run at most this many cycles between two looks at the clock, about a millisecond.
+        constexpr qint64 TIME_CHECK_CYCLES = 1 << 20;
+        /// The same for the recorded path, which is much slower per instruction.
+        constexpr qint64 RECORDED_TIME_CHECK_CYCLES = 1 << 10;
+    } // namespace
+
+    CIEAssemblyMachine::CIEAssemblyMachine(const CIEAssemblyProgram &program)
+    {
+        Load(program);
+    }
+
+    void CIEAssemblyMachine::Load(const CIEAssemblyProgram &program)
+    {
+        this->program = program;
+        jit.reset();
+        UpdateTraps();
+        Reset();
+    }
+
+    void CIEAssemblyMachine::Reset()
+    {
+        memory = program.memory;
+        compareResult = RESULT_EQUAL;
+        cir = 0;
+        cycles = 0;
+        savedDispatches = 0;
+        lastBreak = CIEAssemblyBreak();
+        resumeCycle = -1;
+        runNsecs = 0;
+        ResetLoopDetector();
+        if (history)
+        {
+            history->Clear();
+        }
+    }
+
+    void CIEAssemblyMachine::Restore(const CIEAssemblyHistory::Checkpoint &state)
+    {
+        Reset();
+        cycles = state.cycle;
+        cir = state.cir;
+        compareResult = state.compareResult;
+        memory = state.memory;
+    }
+
+    void CIEAssemblyMachine::SetOptimized(bool optimized)
+    {
+        if (this->optimized != optimized)
+        {
+            this->optimized = optimized;
+            threadedCode.clear();
+        }
+    }
+
+    void CIEAssemblyMachine::SetBreakpoints(const CIEAssemblyBreakpoints &breakpoints)
+    {
+        this->breakpoints = breakpoints;
+        UpdateTraps();
+    }
+
+    void CIEAssemblyMachine::SetLimits(const CIEAssemblyLimits &limits)
+    {
+        const auto retrap = limits.detectLoops != this->limits.detectLoops;
+        this->limits = limits;
+        ResetLoopDetector();
+        if (retrap)
+        {
+            UpdateTraps();
+        }
+    }
+
+    void CIEAssemblyMachine::ResetLoopDetector()
+    {
+        loopBackEdges = 0;
+        loopInterval = 1;
+        loopCycle = -1;
+        loopMemory.clear();
+    }
+
+    void CIEAssemblyMachine::UpdateTraps()
+    {
+        threadedCode.clear();
+        traps.clear();
+        if (breakpoints.IsEmpty() && !limits.detectLoops)
+        {
+            return;
+        }
+        const auto count = program.decoded.count();
+        traps.fill(false, count);
+        auto trapped = false;
+        if (limits.detectLoops)
+        {
+            // Every endless run goes through a back-edge again and again. IN makes the state depend on more than the machine.
+            for (auto i = 0; i < count; i++)
+            {
+                const auto &instruction = program.decoded.at(i);
+                if ((IsJump(instruction.opcode) && instruction.target <= i) || instruction.opcode == IN)
+                {
+                    traps[i] = trapped = true;
+                }
+            }
+        }
+        for (const auto &breakpoint : breakpoints.Breakpoints())
+        {
+            if (breakpoint.instruction >= 0 && breakpoint.instruction < count)
+            {
+                traps[breakpoint.instruction] = trapped = true;
+            }
+        }
+        for (auto i = 0; i < count; i++)
+        {
+            const auto &instruction = program.decoded.at(i);
+            for (const auto &watchpoint : breakpoints.Watchpoints())
+            {
+                // STX may write anywhere in the block of its operand, depending on IX.
+                const auto blockMask = ~(CIEAssemblyMemory::BLOCK_SIZE - 1);
+                if (instruction.opcode == STX ? (instruction.address & blockMask) == (watchpoint.address & blockMask)
+                                              : WrittenAddress(instruction) == watchpoint.address)
+                {
+                    traps[i] = trapped = true;
+                }
+            }
+        }
+        if (!trapped)
+        {
+            traps.clear();
+        }
+    }
+
+    bool CIEAssemblyMachine::Step(QVector<int> *changedMemory)
+    {
+        if (!IsRunning())
+        {
+            return false;
+        }
+        QVector<int> localChangedMemory;
+        if (!changedMemory && (trace || profile || history))
+        {
+            changedMemory = &localChangedMemory;
+        }
+        if (changedMemory)
+        {
+            ExecuteRecorded(changedMemory);
+        }
+        else
+        {
+            cycles++;
+            cir = ExecuteSingleInstruction(program.decoded.at(cir), nullptr);
+        }
+        return true;
+    }
+
+    qint64 CIEAssemblyMachine::Run(qint64 maxCycles)
+    {
+        const auto startCycles = cycles;
+        lastBreak = CIEAssemblyBreak();
+        QElapsedTimer timer;
+        timer.start();
+        if (trace || profile || history)
+        {
+            QVector<int> changedMemory;
+            while (IsRunning() && (maxCycles < 0 || cycles - startCycles < maxCycles) &&
+                   !LimitReached(timer, (cycles - startCycles) % RECORDED_TIME_CHECK_CYCLES == 0))
+            {
+                changedMemory.resize(0);
+                if (traps.isEmpty() || !traps.at(cir))
+                {
+                    ExecuteRecorded(&changedMemory);
+                }
+                else if (ExecuteTrapped(&changedMemory))
+                {
+                    break;
+                }
+            }
+        }
+        else
+        {
+            while (IsRunning())
+            {
+                auto remaining = maxCycles < 0 ? -1 : maxCycles - (cycles - startCycles);
+                if (remaining == 0 || LimitReached(timer, true))
+                {
+                    break;
+                }
+                // The threaded code stops in front of a trapped instruction, without executing it.
+                if (!traps.isEmpty() && traps.at(cir))
+                {
+                    if (ExecuteTrapped(nullptr))
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                // The limits are checked again once the engine has used up a budget that stops at them.
+                if (limits.maxCycles >= 0)
+                {
+                    remaining = remaining < 0 ? limits.maxCycles - cycles : qMin(remaining, limits.maxCycles - cycles);
+                }
+                if (limits.timeoutMs >= 0)
+                {
+                    remaining = remaining < 0 ? TIME_CHECK_CYCLES : qMin(remaining, TIME_CHECK_CYCLES);
+                }
+                if (engine == ENGINE_JIT && traps.isEmpty())
+                {
+                    RunJit(remaining);
+                }
+                else
+                {
+                    RunThreaded(remaining);
+                }
+            }
+        }
+        runNsecs += timer.nsecsElapsed();
+        return cycles - startCycles;
+    }
+
+    bool CIEAssemblyMachine::LimitReached(const QElapsedTimer &timer, bool checkTime)
+    {
+        if (limits.maxCycles >= 0 && cycles >= limits.maxCycles)
+        {
+            lastBreak = { CIEAssemblyBreak::BREAK_CYCLE_LIMIT, cir, -1 };
+            return true;
+        }
+        if (checkTime && limits.timeoutMs >= 0 && (runNsecs + timer.nsecsElapsed()) / 1000000 >= limits.timeoutMs)
+        {
+            lastBreak = { CIEAssemblyBreak::BREAK_TIME_LIMIT, cir, -1 };
+            return true;
+        }
+        return false;
+    }
+
+    bool CIEAssemblyMachine::CheckLoop(int instruction)
+    {
+        // The machine went back in time since the state was saved.
+        if (cycles <= loopCycle)
+        {
+            ResetLoopDetector();
+        }
+        if (loopCycle >= 0 && cir == loopCir && compareResult == loopCompareResult && loopMemory.size() == memory.Size() &&
+            memcmp(memory.Data(), loopMemory.constData(), memory.Size()) == 0)
+        {
+            lastBreak = { CIEAssemblyBreak::BREAK_LOOP, instruction, -1, cycles - loopCycle };
+            return true;
+        }
+        if (++loopBackEdges == loopInterval)
+        {
+            loopBackEdges = 0;
+            loopInterval *= 2;
+            loopCycle = cycles;
+            loopCir = cir;
+            loopCompareResult = compareResult;
+            loopMemory.resize(memory.Size());
+            memcpy(loopMemory.data(), memory.Data(), memory.Size());
+        }
+        return false;
+    }
+
+    bool CIEAssemblyMachine::ExecuteTrapped(QVector<int> *changedMemory)
+    {
+        const auto instruction = cir;
+        const auto breakpoint = breakpoints.BreakpointAt(instruction);
+        if (breakpoint && cycles != resumeCycle && breakpoint->condition.Holds(memory.Data()))
+        {
+            resumeCycle = cycles;
+            lastBreak = { CIEAssemblyBreak::BREAK_BREAKPOINT, instruction, -1 };
+            return true;
+        }
+        const auto &decoded = program.decoded.at(instruction);
+        const auto address = WrittenAddress(decoded);
+        if (changedMemory)
+        {
+            ExecuteRecorded(changedMemory);
+        }
+        else
+        {
+            cycles++;
+            cir = ExecuteSingleInstruction(decoded, nullptr);
+        }
+        // An IN without input stops the machine without writing ACC.
+        const auto watchpoint = address >= 0 && cir >= 0 ? breakpoints.WatchpointAt(address) : nullptr;
+        if (watchpoint && watchpoint->condition.Holds(memory.Data()))
+        {
+            lastBreak = { CIEAssemblyBreak::BREAK_WATCHPOINT, instruction, address };
+            return true;
+        }
+        if (limits.detectLoops)
+        {
+            if (decoded.opcode == IN)
+            {
+                ResetLoopDetector();
+            }
+            else if (IsJump(decoded.opcode) && decoded.target <= instruction && cir == decoded.target)
+            {
+                return CheckLoop(instruction);
+            }
+        }
+        return false;
+    }
+
+    void CIEAssemblyMachine::ExecuteRecorded(QVector<int> *changedMemory)
+    {
+        const auto changeCount = changedMemory->count();
+        const auto instruction = cir;
+        const auto &decoded = program.decoded.at(cir);
+        if (profile)
+        {
+            ProfileReads(decoded);
+            if (decoded.opcode == JPE || decoded.opcode == JPN)
+            {
+                profile->AddBranch(instruction, (compareResult == RESULT_EQUAL) == (decoded.opcode == JPE));
+            }
+        }
+        CIEAssemblyHistory::Step step;
+        if (history)
+        {
+            if (history->CheckpointDue(cycles))
+            {
+                history->AddCheckpoint({ cycles, cir, compareResult, memory });
+            }
+            step.cir = cir;
+            step.address = WrittenAddress(decoded);
+            step.oldValue = step.address >= 0 ? memory[step.address] : char(0);
+            step.compareResult = qint8(compareResult);
+        }
+        cycles++;
+        cir = ExecuteSingleInstruction(decoded, changedMemory);
+        if (history)
+        {
+            if (decoded.opcode == IN)
+            {
+                // An IN without input stops the machine without writing ACC.
+                if (cir < 0)
+                {
+                    step.address = -1;
+                }
+                else
+                {
+                    history->AddInput(cycles, quint8(ACC));
+                }
+            }
+            history->PushStep(step);
+        }
+        if (profile)
+        {
+            profile->AddExecution(instruction);
+            for (auto i = changeCount; i < changedMemory->count(); i++)
+            {
+                profile->AddWrite(changedMemory->at(i));
+            }
+        }
+        if (trace && changedMemory->count() > changeCount)
+        {
+            trace->Append(cycles, instruction, changeCount == 0 ? *changedMemory : changedMemory->mid(changeCount), memory);
+        }
+    }
+
+    void CIEAssemblyMachine::ProfileReads(const CIEAssemblyDecodedInstruction &instruction)
+    {
+        const auto operand = instruction.address;
+        const auto fromMemory = instruction.operandType == MEMORY_LOCATION;
+        switch (instruction.opcode)
+        {
+            case LDD: profile->AddRead(operand); break;
+            case LDX:
+                profile->AddRead(CIEAssemblyMemory::ADDRESS_IX);
+                profile->AddRead(CIEAssemblyMemory::Offset(operand, IX));
+                break;
+            case STO:
+            case OUT:
+            case LSL:
+            case LSR: profile->AddRead(CIEAssemblyMemory::ADDRESS_ACC); break;
+            case STX:
+                profile->AddRead(CIEAssemblyMemory::ADDRESS_ACC);
+                profile->AddRead(CIEAssemblyMemory::ADDRESS_IX);
+                break;
+            case INC:
+            case DEC: profile->AddRead(operand); break;
+            case ADD:
+            case CMP:
+            case AND:
+            case XOR:
+            case OR:
+                profile->AddRead(CIEAssemblyMemory::ADDRESS_ACC);
+                if (fromMemory)
+                {
+                    profile->AddRead(operand);
+                }
+                break;
+            default: break;
+        }
+    }
+
+    qint64 CIEAssemblyMachine::RunJit(qint64 maxCycles)
+    {
+        if (!jit)
+        {
+            // A failed compilation is kept too, so the interpreter is used without trying again.
+            jit.reset(new CIEAssemblyJit);
+            QString errorMessage;
+            jit->Compile(program.decoded, &errorMessage);
+        }
+        const auto startCycles = cycles;
+        const auto budget = maxCycles < 0 ? std::numeric_limits<qint64>::max() : maxCycles;
+        if (jit->IsCompiled() && budget >= jit->MinimumBudget())
+        {
+            CIEAssemblyJit::Context context{ memory.Data(), budget, compareResult, &inputHandler, &outputHandler };
+            cir = jit->Run(cir, &context);
+            compareResult = CIEAssemblyCompareResult(context.compareResult);
+            cycles += budget - context.budget;
+        }
+        const auto remaining = budget - (cycles - startCycles);
+        if (IsRunning() && remaining > 0)
+        {
+            RunThreaded(maxCycles < 0 ? -1 : remaining);
+        }
+        return cycles - startCycles;
+    }
+
+    int CIEAssemblyMachine::WrittenAddress(const CIEAssemblyDecodedInstruction &instruction) const
+    {
+        switch (instruction.opcode)
+        {
+            case LDM:
+            case LDD:
+            case LDX:
+            case ADD:
+            case IN:
+            case LSL:
+            case LSR:
+            case AND:
+            case XOR:
+            case OR: return CIEAssemblyMemory::ADDRESS_ACC;
+            case LDR: return CIEAssemblyMemory::ADDRESS_IX;
+            case STO:
+            case INC:
+            case DEC: return instruction.address;
+            case STX: return CIEAssemblyMemory::Offset(instruction.address, IX);
+            default: return -1;
+        }
+    }
+
+    bool CIEAssemblyMachine::StepBack()
+    {
+        CIEAssemblyHistory::Step step;
+        if (!Undo(&step))
+        {
+            return false;
+        }
+        DiscardFuture();
+        return true;
+    }
+
+    bool CIEAssemblyMachine::RunBackToWrite(int address)
+    {
+        if (address < 0)
+        {
+            return false;
+        }
+        const auto startCycles = cycles;
+        CIEAssemblyHistory::Step step;
+        while (Undo(&step))
+        {
+            if (step.address == address)
+            {
+                DiscardFuture();
+                return true;
+            }
+        }
+        // The inputs of the history are still there, nothing has been discarded yet.
+        Replay(startCycles);
+        return false;
+    }
+
+    bool CIEAssemblyMachine::JumpToCycle(qint64 cycle)
+    {
+        if (cycle >= cycles)
+        {
+            Run(cycle - cycles);
+            return cycles == cycle;
+        }
+        if (!history || cycle < 0)
+        {
+            return false;
+        }
+        if (cycles - cycle <= history->StepCount())
+        {
+            CIEAssemblyHistory::Step step;
+            while (cycles > cycle)
+            {
+                Undo(&step);
+            }
+        }
+        else
+        {
+            // Further back than the steps in the history, the closest checkpoint is never more than an interval away.
+            const auto checkpoint = history->CheckpointAtOrBefore(cycle);
+            if (!checkpoint)
+            {
+                return false;
+            }
+            RestoreCheckpoint(*checkpoint);
+            Replay(cycle);
+        }
+        DiscardFuture();
+        return cycles == cycle;
+    }
+
+    bool CIEAssemblyMachine::Undo(CIEAssemblyHistory::Step *step)
+    {
+        if (!history || cycles == 0)
+        {
+            return false;
+        }
+        if (history->StepCount() == 0)
+        {
+            // The steps before the current cycle fell out of the ring, get them back from the previous checkpoint.
+            const auto checkpoint = history->CheckpointAtOrBefore(cycles - 1);
+            if (!checkpoint)
+            {
+                return false;
+            }
+            const auto target = cycles;
+            RestoreCheckpoint(*checkpoint);
+            Replay(target);
+        }
+        *step = history->PopStep();
+        if (step->address >= 0)
+        {
+            memory[step->address] = step->oldValue;
+        }
+        cir = step->cir;
+        compareResult = CIEAssemblyCompareResult(step->compareResult);
+        cycles--;
+        return true;
+    }
+
+    void CIEAssemblyMachine::Replay(qint64 cycle)
+    {
+        const auto savedTrace = trace;
+        const auto savedProfile = profile;
+        const auto savedInputHandler = inputHandler;
+        const auto savedOutputHandler = outputHandler;
+        trace = nullptr;
+        profile = nullptr;
+        inputHandler = [this]() { return history->InputAt(cycles); };
+        outputHandler = nullptr;
+        QVector<int> changedMemory;
+        while (cycles < cycle && IsRunning())
+        {
+            changedMemory.resize(0);
+            ExecuteRecorded(&changedMemory);
+        }
+        trace = savedTrace;
+        profile = savedProfile;
+        inputHandler = savedInputHandler;
+        outputHandler = savedOutputHandler;
+    }
+
+    void CIEAssemblyMachine::RestoreCheckpoint(const CIEAssemblyHistory::Checkpoint &checkpoint)
+    {
+        history->DiscardSteps();
+        cycles = checkpoint.cycle;
+        cir = checkpoint.cir;
+        compareResult = checkpoint.compareResult;
+        memory = checkpoint.memory;
+    }
+
+    void CIEAssemblyMachine::DiscardFuture()
+    {
+        history->DiscardAfter(cycles);
+        if (trace)
+        {
+            trace->RemoveAfter(cycles);
+        }
+    }
+
+    int CIEAssemblyMachine::ExecuteSingleInstruction(const CIEAssemblyDecodedInstruction &instruction, QVector<int> *changedMemory)
+    {
+        const auto operand = instruction.address;
+        const auto &operandNumber = instruction.immediate;
+        const auto operandType = instruction.operandType;
+        //
+        switch (instruction.opcode)
+        {
+            // -------------------------- Data Movement Instructions --------------------------
+            case LDM:
+            {
+                MARK_CHANGED(CIEAssemblyMemory::ADDRESS_ACC);
+                ACC = operandNumber;
+                break;
+            }
+            case LDD:
+            {
+                MARK_CHANGED(CIEAssemblyMemory::ADDRESS_ACC);
+                ACC = memory[operand];
+                break;
+            }
+            case LDI: break;
+            case LDX:
+            {
+                MARK_CHANGED(CIEAssemblyMemory::ADDRESS_ACC);
+                ACC = memory[CIEAssemblyMemory::Offset(operand, IX)];
+                break;
+            }
+            case LDR:
+            {
+                MARK_CHANGED(CIEAssemblyMemory::ADDRESS_IX);
+                IX = operandNumber;
+                break;
+            }
+            case STO:
+            {
+                MARK_CHANGED(operand);
+                memory[operand] = ACC;
+                break;
+            }
+            case STX:
+            {
+                const auto addr = CIEAssemblyMemory::Offset(operand, IX);
+                MARK_CHANGED(addr);
+                memory[addr] = ACC;
+                break;
+            }
+            case STI:
+                break;
+                // :------------------------- Arithmetic Operations --------------------------
+            case ADD:
+            {
+                MARK_CHANGED(CIEAssemblyMemory::ADDRESS_ACC);
+                ACC += (operandType == MEMORY_LOCATION) ? memory[operand] : operandNumber;
+                break;
+            }
+            case INC:
+            {
+                MARK_CHANGED(operand);
+                memory[operand]++;
+                break;
+            }
+            case DEC:
+            {
+                MARK_CHANGED(operand);
+                memory[operand]--;
+                break;
+            }
+                // :------------------------- Comparision and Jump Instructions --------------------------
+            case JMP:
+            {
+                return instruction.target;
+            }
+            case CMP:
+            {
+                auto operand2 = (operandType == MEMORY_LOCATION) ? memory[operand] : operandNumber;
+                compareResult = (ACC > operand2) ? CIEAssemblyCompareResult::RESULT_ARG1 : (ACC == operand2) ? RESULT_EQUAL : RESULT_ARG2;
+                break;
+            }
+            case JPE:
+            {
+                return compareResult == RESULT_EQUAL ? instruction.target : cir + 1;
+            }
+            case JPN:
+            {
+                return compareResult != RESULT_EQUAL ? instruction.target : cir + 1;
+            }
+                // :------------------------- Input/Output Instructions --------------------------
+            case IN:
+            {
+                const auto input = inputHandler ? inputHandler() : -1;
+                if (input < 0)
+                {
+                    return -1;
+                }
+                MARK_CHANGED(CIEAssemblyMemory::ADDRESS_ACC);
+                ACC = input;
+                break;
+            }
+            case OUT:
+            {
+                if (outputHandler)
+                {
+                    outputHandler(ACC);
+                }
+                break;
+            }
+                // :------------------------- Bitwise Instructions --------------------------
+            case LSL:
+            {
+                MARK_CHANGED(CIEAssemblyMemory::ADDRESS_ACC);
+                ACC = ShiftLeft(ACC, operandNumber);
+                break;
+            }
+            case LSR:
+            {
+                MARK_CHANGED(CIEAssemblyMemory::ADDRESS_ACC);
+                ACC = ShiftRight(ACC, operandNumber);
+                break;
+            }
+            case AND:
+            {
+                MARK_CHANGED(CIEAssemblyMemory::ADDRESS_ACC);
+                auto operand2 = (operandType == MEMORY_LOCATION) ? memory[operand] : operandNumber;
+                ACC = operand2 & ACC;
+                break;
+            }
+            case XOR:
+            {
+                MARK_CHANGED(CIEAssemblyMemory::ADDRESS_ACC);
+                auto operand2 = (operandType == MEMORY_LOCATION) ? memory[operand] : operandNumber;
+                ACC = operand2 ^ ACC;
+                break;
+            }
+            case OR:
+            {
+                MARK_CHANGED(CIEAssemblyMemory::ADDRESS_ACC);
+                auto operand2 = (operandType == MEMORY_LOCATION) ? memory[operand] : operandNumber;
+                ACC = operand2 | ACC;
+                break;
+            }
+            // :------------------------- END Instructions --------------------------
+            case END: return program.decoded.count();
+            default:
+            {
+                // Should not touch this line.
+                auto msg = "Assembly instruction \"" + Mnemonic(instruction.opcode) + "\" is not supported ";
+                Q_ASSERT_X(false, Q_FUNC_INFO, msg.toStdString().c_str());
+            }
+        }
+        return cir + 1;
+    }
+} // namespace CIEAssembly
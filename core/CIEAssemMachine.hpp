@@ -0,0 +1,271 @@
+#pragma once
+
+#include "CIEAssemBreakpoints.hpp"
+#include "CIEAssemHistory.hpp"
+#include "CIEAssemJit.hpp"
+#include "CIEAssemProfile.hpp"
+#include "CIEAssemRunner.hpp"
+#include "CIEAssemTrace.hpp"
+
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <functional>
+
+namespace CIEAssembly
+{
+    /// How Run executes a program when no trace, profile or history is recorded.
+    enum CIEAssemblyEngine
+    {
+        /// The direct-threaded interpreter.
+        ENGINE_THREADED,
+        /// Native code from CIEAssemblyJit, falls back to the interpreter when the host is not supported.
+        ENGINE_JIT
+    };
+
+    /// Bounds Run puts on a program that may never end, a reached limit stops it with a CIEAssemblyBreak.
+    struct CIEAssemblyLimits
+    {
+        /// Stop once the program has executed this many cycles since Reset, negative for no limit.
+        qint64 maxCycles = -1;
+        /// Stop once Run has spent this many milliseconds on the program since Reset, negative for no limit.
+        qint64 timeoutMs = -1;
+        /// Stop when a back-edge brings the machine back to a state it was in at an earlier back-edge, with no IN in between.
+        /// Memory, ACC, IX, the compare flag and CIR are compared, so a reported loop never ends.
+        bool detectLoops = false;
+        //
+        bool IsEmpty() const
+        {
+            return maxCycles < 0 && timeoutMs < 0 && !detectLoops;
+        }
+    };
+
+    /// A self-contained CIE assembly machine: it owns its program, memory, compare flag, CIR and cycle counter.
+    ///
+    /// Different instances share nothing, so they can run on different threads at the same time.
+    class CIEAssemblyMachine
+    {
+      public:
+        CIEAssemblyMachine() = default;
+        explicit CIEAssemblyMachine(const CIEAssemblyProgram &program);
+        /// Replaces the program and resets the machine.
+        void Load(const CIEAssemblyProgram &program);
+        /// Restores the initial memory of the program, and moves CIR back to the first instruction. The history is cleared.
+        void Reset();
+        /// Resets the machine into a state saved from the same program, as if it had run up to there, for example to finish a lane
+        /// that left CIEAssemblyLanes on its own.
+        void Restore(const CIEAssemblyHistory::Checkpoint &state);
+        //
+        /// Executes the instruction at CIR, the changed memory slots are appended to changedMemory if it's not null.
+        /// Breakpoints, watchpoints and limits are not checked. Returns false if the program was not running.
+        bool Step(QVector<int> *changedMemory = nullptr);
+        /// Steps until the program finishes or is stopped, or until maxCycles instructions have been executed when maxCycles >= 0,
+        /// or until a breakpoint, a watchpoint or a limit is hit, see LastBreak(). Returns the number of executed instructions.
+        qint64 Run(qint64 maxCycles = -1);
+        //
+        /// Undoes the last executed instruction, returns false if the history does not reach further back.
+        bool StepBack();
+        /// Goes back to the last instruction that wrote the slot at address, and undoes it, so CIR points to that instruction.
+        /// Returns false and keeps the current state if the history has no such write.
+        bool RunBackToWrite(int address);
+        /// Goes to the state after the given number of cycles, backwards through the history or forwards by running.
+        /// Returns false if that cycle cannot be reached, going forward stops early when the program ends or at a breakpoint.
+        bool JumpToCycle(qint64 cycle);
+        //
+        /// Called by IN, returns the character read, or -1 when there is no input left, which stops the program.
+        void SetInputHandler(const std::function<int()> &handler)
+        {
+            inputHandler = handler;
+        }
+        /// Called by OUT with the contents of ACC.
+        void SetOutputHandler(const std::function<void(char)> &handler)
+        {
+            outputHandler = handler;
+        }
+        void SetEngine(CIEAssemblyEngine engine)
+        {
+            this->engine = engine;
+        }
+        CIEAssemblyEngine Engine() const
+        {
+            return engine;
+        }
+        /// Lets the threaded code execute common sequences of instructions as superinstructions, and jump straight to the end of
+        /// chains of JMP, see OptimizeProgram. The results and the cycle counts do not change, only the number of dispatches.
+        void SetOptimized(bool optimized);
+        bool IsOptimized() const
+        {
+            return optimized;
+        }
+        /// Dispatches the threaded code has saved since the last Reset thanks to SetOptimized.
+        qint64 SavedDispatches() const
+        {
+            return savedDispatches;
+        }
+        /// Records every memory change into trace, null to stop recording.
+        void SetTrace(CIEAssemblyTrace *trace)
+        {
+            this->trace = trace;
+        }
+        CIEAssemblyTrace *Trace() const
+        {
+            return trace;
+        }
+        /// Counts executions, branches and memory accesses into profile, null to stop profiling.
+        /// Profiling runs the instructions one by one, without a profile the engines pay nothing for it.
+        void SetProfile(CIEAssemblyProfile *profile)
+        {
+            this->profile = profile;
+        }
+        CIEAssemblyProfile *Profile() const
+        {
+            return profile;
+        }
+        /// Records undo information into history so the machine can go back in time, null to stop recording.
+        /// Like profiling, it runs the instructions one by one.
+        void SetHistory(CIEAssemblyHistory *history)
+        {
+            this->history = history;
+        }
+        CIEAssemblyHistory *History() const
+        {
+            return history;
+        }
+        /// Makes Run stop at these breakpoints and watchpoints, instruction indexes refer to the loaded program.
+        /// Without any, the engines run exactly as before. With some, the threaded code leaves the instructions that may hit one
+        /// to Run and the others still run at full speed, ENGINE_JIT uses the threaded code meanwhile.
+        void SetBreakpoints(const CIEAssemblyBreakpoints &breakpoints);
+        const CIEAssemblyBreakpoints &Breakpoints() const
+        {
+            return breakpoints;
+        }
+        /// Makes Run stop a program that runs too long or loops forever. The cycle and the time limits are checked between slices of
+        /// the engines, at no cost per instruction. The loop detector checks the back-edges, which are left to Run like breakpoints.
+        void SetLimits(const CIEAssemblyLimits &limits);
+        const CIEAssemblyLimits &Limits() const
+        {
+            return limits;
+        }
+        /// Forgets the states seen by the loop detector, needed when the memory of a running program is changed from outside.
+        void ResetLoopDetector();
+        /// Why the last Run returned early, BREAK_NONE if it did not stop at a breakpoint, a watchpoint or a limit.
+        /// Running again from a breakpoint executes its instruction instead of stopping there again.
+        const CIEAssemblyBreak &LastBreak() const
+        {
+            return lastBreak;
+        }
+        //
+        bool IsRunning() const
+        {
+            return cir >= 0 && cir < program.decoded.count();
+        }
+        /// True if the program has been stopped before reaching its end, for example by running out of input.
+        bool IsStopped() const
+        {
+            return cir < 0;
+        }
+        int CIR() const
+        {
+            return cir;
+        }
+        qint64 Cycles() const
+        {
+            return cycles;
+        }
+        CIEAssemblyCompareResult CompareResult() const
+        {
+            return compareResult;
+        }
+        const CIEAssemblyProgram &Program() const
+        {
+            return program;
+        }
+        CIEAssemblyMemory &Memory()
+        {
+            return memory;
+        }
+        const CIEAssemblyMemory &Memory() const
+        {
+            return memory;
+        }
+
+      private:
+        /// Returns the index of the next instruction to execute, or -1 if the program has been stopped.
+        int ExecuteSingleInstruction(const CIEAssemblyDecodedInstruction &instruction, QVector<int> *changedMemory);
+        /// Executes the instruction at CIR with the trace and the profile recorded, changedMemory must not be null.
+        void ExecuteRecorded(QVector<int> *changedMemory);
+        /// Checks the breakpoint of the trapped instruction at CIR, then executes it, recorded if changedMemory is not null, and
+        /// checks the watchpoint of the slot it wrote. Returns true if the machine has to stop.
+        bool ExecuteTrapped(QVector<int> *changedMemory);
+        /// Marks the instructions that may hit a breakpoint or a watchpoint, the back-edges and IN when loops are detected, and
+        /// drops the threaded code that has to be patched.
+        void UpdateTraps();
+        /// Sets lastBreak and returns true if the cycle limit, or the time limit when checkTime is set, has been reached.
+        bool LimitReached(const QElapsedTimer &timer, bool checkTime);
+        /// Called after the back-edge at instruction has been taken, sets lastBreak and returns true if the state repeats.
+        bool CheckLoop(int instruction);
+        /// Counts the slots read by an instruction, before it executes.
+        void ProfileReads(const CIEAssemblyDecodedInstruction &instruction);
+        /// The slot an instruction is going to write, -1 if none.
+        int WrittenAddress(const CIEAssemblyDecodedInstruction &instruction) const;
+        /// Takes the last step out of the history and restores the state before it, executing again from a checkpoint when
+        /// the steps in the history have run out. Returns false when there is nothing to undo.
+        bool Undo(CIEAssemblyHistory::Step *step);
+        /// Executes up to the given cycle with the inputs of the history, without recording a trace or a profile, or producing output.
+        void Replay(qint64 cycle);
+        void RestoreCheckpoint(const CIEAssemblyHistory::Checkpoint &checkpoint);
+        /// Forgets what happened after the current cycle, once the machine has moved back.
+        void DiscardFuture();
+        /// The fast interpreter loop used by Run when no trace is recorded, see CIEAssemInterpreter.cpp.
+        qint64 RunThreaded(qint64 maxCycles);
+        /// Runs the native code as long as the budget allows, then lets RunThreaded finish the budget exactly.
+        qint64 RunJit(qint64 maxCycles);
+        //
+        struct ThreadedInstruction
+        {
+            /// Address of the handler, only used with direct-threaded dispatch.
+            const void *handler = nullptr;
+            int opcode;
+            int address = 0;
+            int target = -1;
+            /// For a jump folded by the optimizer, the number of JMP skipped on the way to target.
+            int hops = 0;
+            long immediate = 0;
+        };
+        //
+        CIEAssemblyProgram program;
+        CIEAssemblyMemory memory;
+        CIEAssemblyCompareResult compareResult = RESULT_EQUAL;
+        int cir = 0;
+        qint64 cycles = 0;
+        std::function<int()> inputHandler;
+        std::function<void(char)> outputHandler;
+        CIEAssemblyTrace *trace = nullptr;
+        CIEAssemblyProfile *profile = nullptr;
+        CIEAssemblyHistory *history = nullptr;
+        CIEAssemblyEngine engine = ENGINE_THREADED;
+        bool optimized = false;
+        qint64 savedDispatches = 0;
+        CIEAssemblyBreakpoints breakpoints;
+        /// One flag per instruction that may hit a breakpoint or a watchpoint, empty when none can be hit.
+        QVector<bool> traps;
+        CIEAssemblyBreak lastBreak;
+        CIEAssemblyLimits limits;
+        /// Time spent in Run since Reset.
+        qint64 runNsecs = 0;
+        /// Brent's cycle detection: the state at a back-edge is compared with the state saved loopInterval back-edges before, and
+        /// the interval doubles every time the state is saved again, so any loop is found within a few turns and a constant memory.
+        qint64 loopBackEdges = 0;
+        qint64 loopInterval = 1;
+        /// Cycle of the saved state, -1 if none has been saved.
+        qint64 loopCycle = -1;
+        int loopCir = 0;
+        CIEAssemblyCompareResult loopCompareResult = RESULT_EQUAL;
+        QVector<char> loopMemory;
+        /// Cycle of the last stop at a breakpoint, the breakpoint lets its instruction execute when running again from there.
+        qint64 resumeCycle = -1;
+        /// Built from program by the first RunThreaded call after Load.
+        QVector<ThreadedInstruction> threadedCode;
+        /// Compiled by the first RunJit call after Load, the code never changes so copies of the machine share it.
+        QSharedPointer<CIEAssemblyJit> jit;
+    };
+} // namespace CIEAssembly
@@ -0,0 +1,131 @@
+#include "CIEAssemMemory.hpp"
+
+#include <cstring>
+
+namespace CIEAssembly
+{
+    CIEAssemblyMemory::CIEAssemblyMemory()
+    {
+        // The registers live in the first block, which has no name.
+        cells.fill(0, BLOCK_SIZE);
+        blockNames.append("");
+        Intern("ACC");
+        Intern("IX");
+    }
+
+    namespace
+    {
+        /// "x+N" is the N-th byte of the block of "x" for N from 0 to BLOCK_SIZE - 1. Any other N is not an offset, "x+300" or
+        /// "x+-1" is a symbol of its own, as is "x+y".
+        void SplitName(const QString &name, QString *blockName, int *offset)
+        {
+            *blockName = name;
+            *offset = 0;
+            const auto plusIndex = name.lastIndexOf('+');
+            if (plusIndex > 0)
+            {
+                auto ok = false;
+                const auto n = name.mid(plusIndex + 1).toInt(&ok);
+                const auto base = name.left(plusIndex);
+                if (ok && n >= 0 && n < CIEAssemblyMemory::BLOCK_SIZE && base != "ACC" && base != "IX")
+                {
+                    *blockName = base;
+                    *offset = n;
+                }
+            }
+        }
+    } // namespace
+
+    int CIEAssemblyMemory::Intern(const QString &name)
+    {
+        int address;
+        if (name == "ACC")
+            address = ADDRESS_ACC;
+        else if (name == "IX")
+            address = ADDRESS_IX;
+        else
+        {
+            QString blockName;
+            int offset;
+            SplitName(name, &blockName, &offset);
+            auto blockId = blockIds.value(blockName, -1);
+            if (blockId < 0)
+            {
+                blockId = blockNames.count();
+                blockIds.insert(blockName, blockId);
+                blockNames.append(blockName);
+                cells.resize(cells.size() + BLOCK_SIZE);
+            }
+            address = blockId * BLOCK_SIZE + offset;
+        }
+        //
+        if (!symbolSet.contains(address))
+        {
+            symbolSet.insert(address);
+            symbols.append(address);
+        }
+        return address;
+    }
+
+    int CIEAssemblyMemory::Find(const QString &name) const
+    {
+        if (name == "ACC")
+            return ADDRESS_ACC;
+        if (name == "IX")
+            return ADDRESS_IX;
+        QString blockName;
+        int offset;
+        SplitName(name, &blockName, &offset);
+        const auto blockId = blockIds.value(blockName, -1);
+        return blockId < 0 ? -1 : blockId * BLOCK_SIZE + offset;
+    }
+
+    QString CIEAssemblyMemory::NameOf(int address) const
+    {
+        if (address == ADDRESS_ACC)
+            return "ACC";
+        if (address == ADDRESS_IX)
+            return "IX";
+        const auto offset = address % BLOCK_SIZE;
+        return blockNames.at(address / BLOCK_SIZE) + (offset == 0 ? "" : ("+" + QString::number(offset)));
+    }
+
+    void CIEAssemblyMemory::Reset()
+    {
+        cells.fill(0);
+    }
+
+    bool CIEAssemblyMemory::Restore(const QStringList &blockNames, const QVector<int> &symbols, const char *data, int size)
+    {
+        if (blockNames.isEmpty() || !blockNames.first().isEmpty() || qint64(blockNames.count()) * BLOCK_SIZE != size)
+        {
+            return false;
+        }
+        QHash<QString, int> restoredBlockIds;
+        for (auto i = 1; i < blockNames.count(); i++)
+        {
+            if (blockNames.at(i).isEmpty() || restoredBlockIds.contains(blockNames.at(i)))
+            {
+                return false;
+            }
+            restoredBlockIds.insert(blockNames.at(i), i);
+        }
+        QSet<int> restoredSymbolSet;
+        for (const auto address : symbols)
+        {
+            if (address < 0 || address >= size || restoredSymbolSet.contains(address))
+            {
+                return false;
+            }
+            restoredSymbolSet.insert(address);
+        }
+        //
+        cells.resize(size);
+        memcpy(cells.data(), data, size);
+        this->blockIds = restoredBlockIds;
+        this->blockNames = blockNames;
+        this->symbolSet = restoredSymbolSet;
+        this->symbols = symbols;
+        return true;
+    }
+} // namespace CIEAssembly
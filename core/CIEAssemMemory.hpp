@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace CIEAssembly
+{
+    /// Memory of the machine, stored as one contiguous byte array.
+    ///
+    /// Symbolic addresses are interned into numeric slots when loading. Every base symbol ("x") owns a block of BLOCK_SIZE bytes,
+    /// "x+N" is the N-th byte of that block, so indexed addressing is a plain offset into the array. The first block holds the registers.
+    /// N must be below BLOCK_SIZE, a name with a larger or negative N is a base symbol of its own rather than wrapping into the block.
+    class CIEAssemblyMemory
+    {
+      public:
+        static constexpr int BLOCK_SIZE = 256;
+        static constexpr int ADDRESS_ACC = 0;
+        static constexpr int ADDRESS_IX = 1;
+        //
+        CIEAssemblyMemory();
+        /// Returns the slot of a symbolic address such as "ACC", "x" or "x+3", allocating a new block for an unknown symbol.
+        int Intern(const QString &name);
+        /// Returns the slot of a symbolic address like Intern, or -1 for an unknown symbol, without allocating anything.
+        int Find(const QString &name) const;
+        /// Returns the symbolic name of a slot.
+        QString NameOf(int address) const;
+        /// Slots that have been given a name by Intern, in the order they were interned.
+        const QVector<int> &Symbols() const
+        {
+            return symbols;
+        }
+        /// Names of the blocks by block index, the first block holds the registers and has no name.
+        const QStringList &BlockNames() const
+        {
+            return blockNames;
+        }
+        /// Sets every byte to zero and keeps the interned symbols.
+        void Reset();
+        /// Replaces the whole memory with blocks, symbols and contents saved from another memory, as by a compiled program.
+        /// Returns false and leaves the memory unchanged if they do not fit together.
+        bool Restore(const QStringList &blockNames, const QVector<int> &symbols, const char *data, int size);
+        //
+        int Size() const
+        {
+            return cells.size();
+        }
+        char *Data()
+        {
+            return cells.data();
+        }
+        const char *Data() const
+        {
+            return cells.constData();
+        }
+        char &operator[](int address)
+        {
+            return cells[address];
+        }
+        char operator[](int address) const
+        {
+            return cells.at(address);
+        }
+        /// Slot of "address + offset" in the block of the given address, with the offset wrapping inside the block.
+        static int Offset(int address, int offset)
+        {
+            return (address & ~(BLOCK_SIZE - 1)) | quint8(address + offset);
+        }
+
+      private:
+        QVector<char> cells;
+        QHash<QString, int> blockIds;
+        QStringList blockNames;
+        QSet<int> symbolSet;
+        QVector<int> symbols;
+    };
+} // namespace CIEAssembly
@@ -0,0 +1,122 @@
+#include "CIEAssemOptimizer.hpp"
+
+namespace CIEAssembly
+{
+    namespace
+    {
+        /// The superinstruction starting at index, FUSION_NONE if the instructions there match none.
+        CIEAssemblyFusion MatchFusion(const CIEAssemblyDecodedProgram &program, int index, int *length)
+        {
+            const auto opcodeAt = [&](int offset) { return index + offset < program.count() ? program.at(index + offset).opcode : END; };
+            // The longest sequences first.
+            if (opcodeAt(0) == INC && opcodeAt(1) == LDD && opcodeAt(2) == CMP && program.at(index + 2).operandType != MEMORY_LOCATION &&
+                IsConditionalJump(opcodeAt(3)))
+            {
+                *length = 4;
+                return FUSION_INC_LDD_CMP_JUMP;
+            }
+            if (opcodeAt(0) == LDD && opcodeAt(2) == STO)
+            {
+                *length = 3;
+                switch (opcodeAt(1))
+                {
+                    case ADD: return FUSION_LDD_ADD_STO;
+                    case INC: return FUSION_LDD_INC_STO;
+                    case DEC: return FUSION_LDD_DEC_STO;
+                    default: break;
+                }
+            }
+            *length = 2;
+            if (opcodeAt(0) == LDD && opcodeAt(1) == STO)
+            {
+                return FUSION_LDD_STO;
+            }
+            if (opcodeAt(0) == CMP && IsConditionalJump(opcodeAt(1)))
+            {
+                return FUSION_CMP_JUMP;
+            }
+            *length = 1;
+            return FUSION_NONE;
+        }
+    } // namespace
+
+    CIEAssemblyOptimization OptimizeProgram(const CIEAssemblyDecodedProgram &program, const QVector<bool> &traps)
+    {
+        const auto count = program.count();
+        const auto isTrapped = [&](int index) { return !traps.isEmpty() && traps.at(index); };
+        CIEAssemblyOptimization optimization;
+        optimization.instructions.resize(count);
+        auto &instructions = optimization.instructions;
+        //
+        // Every instruction but END and JMP falls through to the next one.
+        QVector<int> pending;
+        if (count > 0)
+        {
+            instructions[0].reachable = true;
+            pending << 0;
+        }
+        const auto reach = [&](int index) {
+            if (index >= 0 && index < count && !instructions.at(index).reachable)
+            {
+                instructions[index].reachable = true;
+                pending << index;
+            }
+        };
+        while (!pending.isEmpty())
+        {
+            const auto index = pending.takeLast();
+            const auto &instruction = program.at(index);
+            if (IsJump(instruction.opcode))
+            {
+                reach(instruction.target);
+            }
+            if (FallsThrough(instruction.opcode))
+            {
+                reach(index + 1);
+            }
+        }
+        //
+        for (auto i = 0; i < count; i++)
+        {
+            auto &optimized = instructions[i];
+            if (!optimized.reachable)
+            {
+                optimization.unreachable++;
+                continue;
+            }
+            if (isTrapped(i))
+            {
+                continue;
+            }
+            const auto &instruction = program.at(i);
+            if (IsJump(instruction.opcode))
+            {
+                // A chain of JMP that loops forever ends once every instruction has been visited.
+                optimized.target = instruction.target;
+                while (program.at(optimized.target).opcode == JMP && !isTrapped(optimized.target) && optimized.hops < count)
+                {
+                    optimized.target = program.at(optimized.target).target;
+                    optimized.hops++;
+                }
+                if (optimized.hops > 0)
+                {
+                    optimization.foldedJumps++;
+                }
+            }
+            auto length = 1;
+            const auto fusion = MatchFusion(program, i, &length);
+            auto covered = fusion != FUSION_NONE;
+            for (auto j = i + 1; covered && j < i + length; j++)
+            {
+                covered = !isTrapped(j);
+            }
+            if (covered)
+            {
+                optimized.fusion = fusion;
+                optimized.length = length;
+                optimization.superinstructions++;
+            }
+        }
+        return optimization;
+    }
+} // namespace CIEAssembly
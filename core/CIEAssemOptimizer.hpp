@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CIEAssemRunner.hpp"
+
+#include <QVector>
+
+namespace CIEAssembly
+{
+    /// Instruction sequences the threaded code can execute with a single dispatch.
+    enum CIEAssemblyFusion
+    {
+        FUSION_NONE,
+        /// LDD a / STO b
+        FUSION_LDD_STO,
+        /// LDD a / ADD b / STO c, ADD with a slot or a number.
+        FUSION_LDD_ADD_STO,
+        /// LDD a / INC r / STO b
+        FUSION_LDD_INC_STO,
+        /// LDD a / DEC r / STO b
+        FUSION_LDD_DEC_STO,
+        /// CMP a / JPE or JPN, CMP with a slot or a number.
+        FUSION_CMP_JUMP,
+        /// INC r / LDD a / CMP #n / JPE or JPN, the end of a loop counting in IX or ACC.
+        FUSION_INC_LDD_CMP_JUMP
+    };
+
+    /// What the peephole optimizer found in a decoded program, per instruction index.
+    ///
+    /// Nothing is moved or removed: the indexes stay those of the source, which the trace, the profile, the history and the
+    /// breakpoints refer to. A superinstruction starts at an instruction and covers the following ones, which keep their own
+    /// meaning when a jump lands on them. The executed cycles are still counted per source instruction.
+    struct CIEAssemblyOptimization
+    {
+        struct Instruction
+        {
+            CIEAssemblyFusion fusion = FUSION_NONE;
+            /// Number of source instructions executed by the superinstruction starting here, 1 without one.
+            int length = 1;
+            /// For a jump, the end of the chain of JMP its target starts, the target itself if it's not a JMP.
+            int target = -1;
+            /// Number of JMP of that chain, skipped by jumping straight to target.
+            int hops = 0;
+            /// False if no path from the first instruction reaches this one.
+            bool reachable = false;
+        };
+        //
+        QVector<Instruction> instructions;
+        /// Instructions starting a superinstruction.
+        int superinstructions = 0;
+        /// Jumps whose target has been moved to the end of a chain of JMP.
+        int foldedJumps = 0;
+        /// Instructions no path from the first instruction reaches, after an END or a JMP.
+        int unreachable = 0;
+    };
+    //
+    /// Finds the superinstructions and the jump chains of a program. Instructions flagged in traps are left alone, so a breakpoint
+    /// or a watchpoint still sees them: no superinstruction covers them and no jump chain goes through them. traps may be empty.
+    CIEAssemblyOptimization OptimizeProgram(const CIEAssemblyDecodedProgram &program, const QVector<bool> &traps);
+} // namespace CIEAssembly
@@ -0,0 +1,57 @@
+#include "CIEAssemProfile.hpp"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace CIEAssembly
+{
+    void CIEAssemblyProfile::Clear()
+    {
+        totalExecutions = 0;
+        executions.clear();
+        branchesTaken.clear();
+        branchesNotTaken.clear();
+        reads.clear();
+        writes.clear();
+    }
+
+    QByteArray CIEAssemblyProfile::ToJson(const CIEAssemblyProgram &program, const CIEAssemblyMemory &memory) const
+    {
+        QJsonArray instructions;
+        for (auto i = 0; i < program.code.count(); i++)
+        {
+            const auto &instruction = program.code.at(i);
+            QJsonObject object;
+            object["index"] = i;
+            object["label"] = instruction.labelName(program.labelNames);
+            object["instruction"] = instruction.toString(program.labelNames);
+            object["executions"] = Executions(i);
+            if (IsConditionalJump(instruction.opcode))
+            {
+                object["taken"] = BranchesTaken(i);
+                object["not_taken"] = BranchesNotTaken(i);
+            }
+            instructions << object;
+        }
+        QJsonArray addresses;
+        for (auto address = 0; address < qMax(reads.count(), writes.count()); address++)
+        {
+            if (Reads(address) == 0 && Writes(address) == 0)
+            {
+                continue;
+            }
+            QJsonObject object;
+            object["address"] = address;
+            object["name"] = memory.NameOf(address);
+            object["reads"] = Reads(address);
+            object["writes"] = Writes(address);
+            addresses << object;
+        }
+        QJsonObject profile;
+        profile["cycles"] = totalExecutions;
+        profile["instructions"] = instructions;
+        profile["memory"] = addresses;
+        return QJsonDocument(profile).toJson();
+    }
+} // namespace CIEAssembly
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "CIEAssemRunner.hpp"
+
+#include <QByteArray>
+#include <QMutex>
+#include <QVector>
+
+namespace CIEAssembly
+{
+    /// Execution counts collected by a CIEAssemblyMachine while a profile is set, per instruction index and per memory slot.
+    ///
+    /// Reads and writes include the implicit uses of ACC and IX. The profile is written by the thread running the machine,
+    /// readers on other threads must hold Mutex().
+    class CIEAssemblyProfile
+    {
+      public:
+        void AddExecution(int instruction)
+        {
+            Grow(&executions, instruction);
+            executions[instruction]++;
+            totalExecutions++;
+        }
+        /// Records the outcome of a conditional jump.
+        void AddBranch(int instruction, bool taken)
+        {
+            auto &counts = taken ? branchesTaken : branchesNotTaken;
+            Grow(&counts, instruction);
+            counts[instruction]++;
+        }
+        void AddRead(int address)
+        {
+            Grow(&reads, address);
+            reads[address]++;
+        }
+        void AddWrite(int address)
+        {
+            Grow(&writes, address);
+            writes[address]++;
+        }
+        void Clear();
+        //
+        qint64 TotalExecutions() const
+        {
+            return totalExecutions;
+        }
+        qint64 Executions(int instruction) const
+        {
+            return executions.value(instruction);
+        }
+        qint64 BranchesTaken(int instruction) const
+        {
+            return branchesTaken.value(instruction);
+        }
+        qint64 BranchesNotTaken(int instruction) const
+        {
+            return branchesNotTaken.value(instruction);
+        }
+        qint64 Reads(int address) const
+        {
+            return reads.value(address);
+        }
+        qint64 Writes(int address) const
+        {
+            return writes.value(address);
+        }
+        /// The counts as a JSON document, instructions and memory slots are named after program and memory.
+        QByteArray ToJson(const CIEAssemblyProgram &program, const CIEAssemblyMemory &memory) const;
+        //
+        QMutex &Mutex() const
+        {
+            return mutex;
+        }
+
+      private:
+        static void Grow(QVector<qint64> *counts, int index)
+        {
+            if (index >= counts->count())
+            {
+                counts->resize(qMax(index + 1, counts->count() * 2));
+            }
+        }
+        //
+        qint64 totalExecutions = 0;
+        QVector<qint64> executions;
+        QVector<qint64> branchesTaken;
+        QVector<qint64> branchesNotTaken;
+        QVector<qint64> reads;
+        QVector<qint64> writes;
+        mutable QMutex mutex;
+    };
+} // namespace CIEAssembly
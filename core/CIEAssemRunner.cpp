@@ -1,380 +1,450 @@
 #include "CIEAssemRunner.hpp"
 
-#include <QApplication>
-#include <QInputDialog>
-#include <QMessageBox>
+#include "CIEAssemLexer.hpp"
+
+#include <limits>
 
 namespace CIEAssembly
 {
-    void ParseAssemblyCode(const QString &code, QString *errorMessage)
+    namespace
     {
-        CIEAssemblyCodeModel instructions;
-        auto lines = code.split(QRegExp("[\r\n]"), Qt::SkipEmptyParts);
-        //
-        QString lastLabel = "_init_";
-        int labelOffset = 0;
-        for (const auto &_line : lines)
+        /// Calls parse on every line of code that is not empty, lines being separated by "\r" or "\n", until it returns false.
+        template<typename Function>
+        void ForEachLine(QStringView code, Function parse)
         {
-            auto pureLine = _line.mid(0, _line.indexOf(";")).trimmed();
-            auto splited = pureLine.split(" ", Qt::SkipEmptyParts);
-            if (pureLine.isEmpty() || splited.isEmpty())
+            const auto *const text = code.data();
+            const auto length = int(code.size());
+            auto start = 0;
+            for (auto i = 0; i <= length; i++)
             {
-                continue;
-            }
-            //
-            if (splited.count() == 1 && splited.first().contains(":"))
-            {
-                // Remove the rightmost ":" symbol.
-                lastLabel = splited.first().trimmed().chopped(1).trimmed();
-                labelOffset = 0;
-            }
-            else
-            {
-                auto x = StringToEnum<CIEAssemblyOpcode>(splited.first());
-                if (x < 0)
+                if (i < length && text[i] != QLatin1Char('\n') && text[i] != QLatin1Char('\r'))
+                {
+                    continue;
+                }
+                if (i > start && !parse(code.mid(start, i - start)))
                 {
-                    *errorMessage = "\"" + splited.first() + "\" is not a valid CIE assembly opcode.";
                     return;
                 }
-                CIEAssemblyInstruction instruction;
-                instruction.opcode = x;
-                // For IN and OUT, or those opcode without operands.
-                instruction.operand = splited.count() == 1 ? "" : splited.at(1);
-                instruction.label = lastLabel + (labelOffset == 0 ? "" : ("+" + QString::number(labelOffset)));
-                //
-                instructions.append(instruction);
-                labelOffset++;
+                start = i + 1;
             }
         }
-        //
-        CODE_MODEL = instructions;
-    }
 
-    int FindOffsetByLabel(const QString &label)
-    {
-        for (auto i = 0; i < CODE_MODEL.count(); i++)
+        /// Assembles parsed lines one at a time, in the order of the source.
+        class Assembler
         {
-            if (CODE_MODEL.at(i).label == label)
+          public:
+            /// instructionCapacity is an upper bound of the number of instructions, the arrays of the program are allocated once.
+            explicit Assembler(int instructionCapacity = 0)
             {
-                return i;
+                labels.Add(QStringLiteral("_init_"));
+                instructions.reserve(instructionCapacity);
+                decodedInstructions.reserve(instructionCapacity);
             }
-        }
-        return -1;
-    }
-
-    QStringList GetLabels(const QString &code)
-    {
-        QStringList labels;
-        auto lines = code.split(QRegExp("[\r\n]"), Qt::SkipEmptyParts);
-        //
-        QString lastLabel = "_init_";
-
-        for (auto _line : lines)
-        {
-            auto double_trimmed = _line.remove(" ");
-            double_trimmed = double_trimmed.trimmed();
-            if (double_trimmed.endsWith(":"))
+            /// Returns false for an invalid line, the lines after it are not needed to report it.
+            bool Add(const CIEAssemblyParsedLine &line, QString *errorMessage)
             {
-                labels.append(double_trimmed.chopped(1).trimmed());
+                switch (line.type)
+                {
+                    case LINE_EMPTY: break;
+                    case LINE_INVALID:
+                    {
+                        *errorMessage = line.errorMessage;
+                        return false;
+                    }
+                    case LINE_LABEL:
+                    {
+                        lastLabel = labels.Add(line.label);
+                        labelOffset = 0;
+                        break;
+                    }
+                    case LINE_INSTRUCTION:
+                    {
+                        auto instruction = line.instruction;
+                        instruction.labelId = lastLabel;
+                        instruction.labelOffset = labelOffset;
+                        auto decoded = line.decoded;
+                        if (decoded.operandType == MEMORY_LOCATION)
+                        {
+                            auto symbol = symbols.Find(instruction.operand);
+                            if (symbol < 0)
+                            {
+                                symbol = symbols.Add(instruction.operand);
+                                addresses << memory.Intern(instruction.operand);
+                            }
+                            decoded.address = addresses.at(symbol);
+                        }
+                        instructions.append(instruction);
+                        decodedInstructions.append(decoded);
+                        labelOffset++;
+                        break;
+                    }
+                }
+                return true;
             }
-        }
-        return labels;
-    }
-
-    CIEAssemblyOperandType DetectNumberType(const QString &operand)
-    {
-        if (operand.toLower().startsWith("#b"))
-            return NUMBER_BASE2;
-        else if (operand.startsWith("#&"))
-            return NUMBER_BASE16;
-        else if (operand.startsWith("#"))
-            return NUMBER_BASE10;
-        else
-            return INVALID_OPERAND;
-    }
-
-    CIEAssemblyOperandType DeduceOperandType(const CIEAssemblyInstruction &instruction, QString *errorMessage)
-    {
-        const auto &operand = instruction.operand;
-        switch (instruction.opcode)
-        {
-            case LDM:
-            case LDR:
-            case LSL:
-            case LSR:
+            /// Links the jumps and stores the program, unless a jump is to a missing label.
+            void Finish(CIEAssemblyProgram *program, QString *errorMessage)
             {
-                if (operand.startsWith("#"))
+                QStringList labelNames;
+                labelNames.reserve(labels.Count());
+                for (const auto &label : labels.Strings())
                 {
-                    return DetectNumberType(operand);
+                    labelNames << label;
                 }
-                else
+                LinkAssemblyCode(instructions, labelNames, &decodedInstructions, errorMessage);
+                if (!errorMessage->isEmpty())
                 {
-                    LOG("LDM, LDR, LSL, LSR expect a number as operand.");
-                    *errorMessage = "LDM, LDR, LSL, LSR expect a number as operand.";
-                    return INVALID_OPERAND;
+                    return;
                 }
+                program->code = instructions;
+                program->decoded = decodedInstructions;
+                program->labelNames = labelNames;
+                program->memory = memory;
             }
-            case INC:
-            case DEC:
+
+          private:
+            CIEAssemblyCodeModel instructions;
+            CIEAssemblyDecodedProgram decodedInstructions;
+            CIEAssemblyMemory memory;
+            /// Label names numbered as labelId, "_init_" first.
+            CIEAssemblyStringTable labels;
+            /// Distinct memory operands with their addresses, so each one is interned once however often it is used.
+            CIEAssemblyStringTable symbols;
+            QVector<int> addresses;
+            int lastLabel = 0;
+            int labelOffset = 0;
+        };
+    } // namespace
+
+    CIEAssemblyParsedLine ParseAssemblyLine(QStringView line, CIEAssemblyStringTable *strings)
+    {
+        const auto makeString = [strings](QStringView text) { return strings ? strings->At(strings->Add(text)) : text.toString(); };
+        CIEAssemblyParsedLine parsed;
+        CIEAssemblyLexer lexer(line);
+        CIEAssemblyToken token;
+        while (lexer.Next(&token))
+        {
+            switch (token.type)
             {
-                if (!QStringList{ "ACC", "IX" }.contains(instruction.operand))
+                case TOKEN_LABEL:
                 {
-                    LOG("INC and DEC expect \"ACC\" or \"IX\" as the operand.");
-                    *errorMessage = "INC and DEC expect \"ACC\" or \"IX\" as the operand.";
+                    // Remove the rightmost ":" symbol.
+                    parsed.type = LINE_LABEL;
+                    parsed.label = makeString(line.mid(token.start, token.length - 1).trimmed());
+                    return parsed;
                 }
-                return MEMORY_LOCATION;
-            }
-
-            case LDD:
-            case LDI:
-            case LDX:
-            case STO:
-            case STI:
-            case STX:
-            {
-                if (!operand.startsWith("#"))
-                    return MEMORY_LOCATION;
-                else
+                case TOKEN_INVALID:
                 {
-                    LOG("LDD, LDI, LDX, STO, STI, STX expect an address as the operand.");
-                    *errorMessage = "LDD, LDI, LDX, STO, STI, STX expect an address as the operand.";
-                    return INVALID_OPERAND;
+                    parsed.type = LINE_INVALID;
+                    parsed.errorMessage = "\"" + line.mid(token.start, token.length).toString() + "\" is not a valid CIE assembly opcode.";
+                    return parsed;
                 }
-            }
-
-            case JMP:
-            case JPE:
-            case JPN:
-            {
-                if (!operand.startsWith("#"))
-                    return LABEL;
-                else
+                case TOKEN_OPCODE:
                 {
-                    LOG("JMP JPE and JPN expect an address as the operand.");
-                    *errorMessage = "JMP JPE and JPN expect an address as the operand.";
-                    return INVALID_OPERAND;
+                    parsed.type = LINE_INSTRUCTION;
+                    parsed.instruction.opcode = token.opcode;
+                    break;
                 }
-            }
-            case IN:
-            case OUT:
-            case END:
-            {
-                if (!operand.isEmpty())
+                case TOKEN_REGISTER:
+                case TOKEN_IMMEDIATE:
+                case TOKEN_SYMBOL:
                 {
-                    LOG("Dropped useless operand after IN OUT and END");
+                    parsed.instruction.operand = makeString(line.mid(token.start, token.length));
+                    break;
                 }
-                return NO_OPERAND;
+                case TOKEN_EXTRA:
+                case TOKEN_COMMENT: break;
             }
+        }
+        if (parsed.type == LINE_EMPTY)
+        {
+            return parsed;
+        }
+        // For IN and OUT, or those opcode without operands, the operand stays empty.
+        parsed.instruction.labelId = 0;
+        parsed.instruction.labelOffset = 0;
+        // Memory is interned when assembling, the order of the symbols depends on the whole program.
+        parsed.decoded = DecodeInstruction(parsed.instruction, nullptr, &parsed.errorMessage);
+        if (!parsed.errorMessage.isEmpty())
+        {
+            parsed.type = LINE_INVALID;
+        }
+        return parsed;
+    }
 
-            case ADD:
-            case AND:
-            case OR:
-            case CMP:
-            case XOR:
-            {
-                return operand.startsWith("#") ? DetectNumberType(operand) : MEMORY_LOCATION;
-            }
-            default:
+    void AssembleParsedLines(const QVector<CIEAssemblyParsedLine> &lines, CIEAssemblyProgram *program, QString *errorMessage)
+    {
+        Assembler assembler(lines.count());
+        for (const auto &line : lines)
+        {
+            if (!assembler.Add(line, errorMessage))
             {
-                return INVALID_OPERAND;
+                return;
             }
         }
+        assembler.Finish(program, errorMessage);
     }
 
-    QString NumberToString(int num)
+    void ParseAssemblyCode(QStringView code, CIEAssemblyProgram *program, QString *errorMessage)
     {
-        switch (Base)
+        // There are at most as many instructions as lines.
+        auto lineCount = 1;
+        for (const auto c : code)
         {
-            case BASE2: return "#b" + QString::number(num, 2);
-            case BASE16: return "#&" + QString::number(num, 16);
-            case ASCII: return "\"" + QString(QChar::fromLatin1(num)) + "\"";
-            case BASE10: return "#" + QString::number(num, 10);
-            default: return "Unknown";
+            lineCount += c == QLatin1Char('\n') || c == QLatin1Char('\r');
+        }
+        CIEAssemblyStringTable strings;
+        Assembler assembler(lineCount);
+        auto valid = true;
+        ForEachLine(code, [&](QStringView line) { return valid = assembler.Add(ParseAssemblyLine(line, &strings), errorMessage); });
+        if (valid)
+        {
+            assembler.Finish(program, errorMessage);
         }
     }
 
-    QString ExecuteSingleInstruction(const CIEAssemblyInstruction &instruction, QString *errorMessage, QStringList *changedMemory)
+    CIEAssemblyLinker::CIEAssemblyLinker(const CIEAssemblyCodeModel &code, const QStringList &labelNames)
     {
-        auto operandType = DeduceOperandType(instruction, errorMessage);
-        if (operandType == INVALID_OPERAND || !errorMessage->isEmpty())
+        for (const auto &labelName : labelNames)
         {
-            QMessageBox::warning(qApp->activeWindow(), "Error", *errorMessage);
-            return {};
+            labelIds.Add(labelName);
         }
-        //
-        auto operand = instruction.operand;
-        long operandNumber;
-        switch (operandType)
+        // The instructions after each declaration of a label form a segment, which starts where labelOffset is 0. "label+N" is in
+        // the first segment of the label holding more than N instructions: when a label is declared more than once, the first
+        // declaration wins.
+        auto segmentCount = 0;
+        for (const auto &instruction : code)
         {
-            case LABEL:
-            case NO_OPERAND:
-            case MEMORY_LOCATION:
-            {
-                break;
-            }
-            case NUMBER_BASE2:
-            {
-                operandNumber = operand.remove(0, 2).toLong(nullptr, 2);
-                break;
-            }
-            case NUMBER_BASE10:
-            {
-                operandNumber = operand.remove(0, 1).toLong(nullptr, 10);
-                break;
-            }
-            case NUMBER_BASE16:
-            {
-                operandNumber = operand.remove(0, 2).toLong(nullptr, 16);
-                break;
-            }
-            case INVALID_OPERAND:
-            {
-                Q_UNREACHABLE();
-                break;
-            }
+            segmentCount += instruction.labelOffset == 0;
         }
-        //
-        switch (instruction.opcode)
+        segmentStarts.reserve(segmentCount + 1);
+        nextSegments.reserve(segmentCount);
+        firstSegments.fill(-1, labelNames.count());
+        QVector<int> lastSegments(labelNames.count(), -1);
+        for (auto i = 0; i < code.count(); i++)
         {
-            // -------------------------- Data Movement Instructions --------------------------
-            case LDM:
+            if (code.at(i).labelOffset != 0)
             {
-                *changedMemory << "ACC";
-                ACC = operandNumber;
-                break;
+                continue;
             }
-            case LDD:
+            const auto labelId = code.at(i).labelId;
+            const auto segment = segmentStarts.count();
+            segmentStarts << i;
+            nextSegments << -1;
+            if (lastSegments.at(labelId) < 0)
             {
-                *changedMemory << "ACC";
-                ACC = MEMORY[operand];
-                break;
+                firstSegments[labelId] = segment;
             }
-            case LDI: break;
-            case LDX:
+            else
             {
-                *changedMemory << "ACC";
-                ACC = MEMORY[operand + (IX == 0 ? "" : ("+" + QString::number(IX)))];
-                break;
+                nextSegments[lastSegments.at(labelId)] = segment;
             }
-            case LDR:
+            lastSegments[labelId] = segment;
+        }
+        segmentStarts << code.count();
+    }
+
+    int CIEAssemblyLinker::Target(QStringView operand) const
+    {
+        // Jump targets are either "label" or "label+N".
+        auto labelId = labelIds.Find(operand);
+        auto labelOffset = 0;
+        const auto plusIndex = operand.lastIndexOf(QLatin1Char('+'));
+        if (labelId < 0 && plusIndex > 0)
+        {
+            long n = 0;
+            if (ParseNumber(operand.mid(plusIndex + 1), 10, &n) && n > 0 && n <= std::numeric_limits<int>::max())
             {
-                *changedMemory << "IX";
-                IX = operandNumber;
-                break;
+                labelId = labelIds.Find(operand.left(plusIndex));
+                labelOffset = int(n);
             }
-            case STO:
+        }
+        for (auto segment = labelId < 0 ? -1 : firstSegments.at(labelId); segment >= 0; segment = nextSegments.at(segment))
+        {
+            if (labelOffset < segmentStarts.at(segment + 1) - segmentStarts.at(segment))
             {
-                *changedMemory << operand;
-                MEMORY[operand] = ACC;
-                break;
+                return segmentStarts.at(segment) + labelOffset;
             }
-            case STX:
+        }
+        return -1;
+    }
+
+    void LinkAssemblyCode(const CIEAssemblyCodeModel &code, const QStringList &labelNames, CIEAssemblyDecodedProgram *program, QString *errorMessage)
+    {
+        const CIEAssemblyLinker linker(code, labelNames);
+        for (auto i = 0; i < program->count(); i++)
+        {
+            auto &instruction = (*program)[i];
+            if (instruction.operandType != LABEL)
             {
-                auto addr = operand + (IX == 0 ? "" : ("+" + QString::number(IX)));
-                *changedMemory << addr;
-                MEMORY[addr] = ACC;
-                break;
+                continue;
             }
-            case STI:
-                break;
-                // :------------------------- Arithmetic Operations --------------------------
-            case ADD:
+            instruction.target = linker.Target(code.at(i).operand);
+            if (instruction.target < 0)
             {
-                *changedMemory << operand;
-                ACC += MEMORY[operand];
-                break;
+                *errorMessage = "Cannot find label: " + code.at(i).operand;
+                return;
             }
-            case INC:
+        }
+    }
+
+    QStringList GetLabels(QStringView code)
+    {
+        QStringList labels;
+        ForEachLine(code, [&](QStringView line) {
+            // A line ending with ":" declares the label before it, spaces removed.
+            const auto trimmed = line.trimmed();
+            if (trimmed.endsWith(QLatin1Char(':')))
             {
-                *changedMemory << operand;
-                operand == "ACC" ? ACC++ : IX++;
-                break;
+                labels << trimmed.chopped(1).trimmed().toString().remove(QLatin1Char(' '));
             }
-            case DEC:
-            {
-                *changedMemory << operand;
-                operand == "ACC" ? ACC-- : IX--;
-                break;
+            return true;
+        });
+        return labels;
+    }
+
+    CIEAssemblyOperandType DetectNumberType(QStringView operand)
+    {
+        if (operand.startsWith(QLatin1String("#b"), Qt::CaseInsensitive))
+            return NUMBER_BASE2;
+        else if (operand.startsWith(QLatin1String("#&")))
+            return NUMBER_BASE16;
+        else if (operand.startsWith(QLatin1Char('#')))
+            return NUMBER_BASE10;
+        else
+            return INVALID_OPERAND;
+    }
+
+    CIEAssemblyOperandType DeduceOperandType(const CIEAssemblyInstruction &instruction, QString *errorMessage)
+    {
+        if (instruction.opcode < 0 || instruction.opcode >= OPCODE_COUNT)
+        {
+            return INVALID_OPERAND;
+        }
+        const QStringView operand = instruction.operand;
+        const auto rule = InstructionInfo(instruction.opcode).operand;
+        const auto isNumber = operand.startsWith(QLatin1Char('#'));
+        const auto reject = [&](const char *expected) {
+            // Every opcode sharing the rule, such as "LDM, LDR, LSL, LSR expect a number as the operand."
+            QStringList opcodes;
+            for (auto opcode = 0; opcode < OPCODE_COUNT; opcode++)
+            {
+                if (INSTRUCTION_SET[opcode].operand == rule)
+                {
+                    opcodes << INSTRUCTION_SET[opcode].mnemonic;
+                }
             }
-                // :------------------------- Comparision and Jump Instructions --------------------------
-            case JMP:
+            *errorMessage = opcodes.join(", ") + " expect " + expected + " as the operand.";
+            LOG(*errorMessage);
+            return INVALID_OPERAND;
+        };
+        switch (rule)
+        {
+            case RULE_NONE:
             {
-                return operand;
+                if (!operand.isEmpty())
+                {
+                    LOG("Dropped useless operand after " + Mnemonic(instruction.opcode));
+                }
+                return NO_OPERAND;
             }
-            case CMP:
+            case RULE_NUMBER:
             {
-                auto operand2 = (operandType == MEMORY_LOCATION) ? MEMORY[operand] : operandNumber;
-                COMPARE_RESULT = (ACC > operand2) ? CIEAssemblyCompareResult::RESULT_ARG1 : (ACC == operand2) ? RESULT_EQUAL : RESULT_ARG2;
-                break;
+                return isNumber ? DetectNumberType(operand) : reject("a number");
             }
-            case JPE:
+            case RULE_REGISTER:
             {
-                return COMPARE_RESULT == RESULT_EQUAL ? operand : "";
+                if (instruction.operand != QLatin1String("ACC") && instruction.operand != QLatin1String("IX"))
+                {
+                    reject("\"ACC\" or \"IX\"");
+                }
+                return MEMORY_LOCATION;
             }
-            case JPN:
+            case RULE_ADDRESS:
             {
-                return COMPARE_RESULT != RESULT_EQUAL ? operand : "";
+                return isNumber ? reject("an address") : MEMORY_LOCATION;
             }
-                // :------------------------- Input/Output Instructions --------------------------
-            case IN:
+            case RULE_NUMBER_OR_ADDRESS:
             {
-                *changedMemory << "ACC";
-                QString buf;
-                while (buf.isEmpty())
-                {
-                    buf = QInputDialog::getText(qApp->activeWindow(), "Input", "Input");
-                }
-                ACC = buf.at(0).toLatin1();
-                break;
+                return isNumber ? DetectNumberType(operand) : MEMORY_LOCATION;
             }
-            case OUT:
+            case RULE_LABEL:
             {
-                QMessageBox::information(qApp->activeWindow(), "Program Output", NumberToString(ACC));
-                break;
+                return isNumber ? reject("a label") : LABEL;
             }
-                // :------------------------- Bitwise Instructions --------------------------
-            case LSL:
+        }
+        return INVALID_OPERAND;
+    }
+
+    CIEAssemblyDecodedInstruction DecodeInstruction(const CIEAssemblyInstruction &instruction, CIEAssemblyMemory *memory, QString *errorMessage)
+    {
+        CIEAssemblyDecodedInstruction decoded;
+        decoded.opcode = instruction.opcode;
+        decoded.operandType = DeduceOperandType(instruction, errorMessage);
+        if (!errorMessage->isEmpty())
+        {
+            return decoded;
+        }
+        if (decoded.operandType == INVALID_OPERAND)
+        {
+            *errorMessage = "\"" + instruction.operand + "\" is not a valid operand of " + Mnemonic(instruction.opcode) + ".";
+            return decoded;
+        }
+        if (decoded.operandType != NO_OPERAND && instruction.operand.isEmpty())
+        {
+            *errorMessage = Mnemonic(instruction.opcode) + " expects an operand.";
+            return decoded;
+        }
+        //
+        const QStringView operand = instruction.operand;
+        auto ok = true;
+        switch (decoded.operandType)
+        {
+            case NUMBER_BASE2:
             {
-                *changedMemory << "ACC";
-                ACC = ACC << operandNumber;
+                ok = ParseNumber(operand.mid(2), 2, &decoded.immediate);
                 break;
             }
-            case LSR:
+            case NUMBER_BASE10:
             {
-                *changedMemory << "ACC";
-                ACC = ACC >> operandNumber;
+                ok = ParseNumber(operand.mid(1), 10, &decoded.immediate);
                 break;
             }
-            case AND:
+            case NUMBER_BASE16:
             {
-                *changedMemory << "ACC";
-                auto operand2 = (operandType == MEMORY_LOCATION) ? MEMORY[operand] : operandNumber;
-                ACC = operand2 & ACC;
+                ok = ParseNumber(operand.mid(2), 16, &decoded.immediate);
                 break;
             }
-            case XOR:
+            case MEMORY_LOCATION:
             {
-                *changedMemory << "ACC";
-                auto operand2 = (operandType == MEMORY_LOCATION) ? MEMORY[operand] : operandNumber;
-                ACC = operand2 ^ ACC;
+                if (memory)
+                {
+                    decoded.address = memory->Intern(instruction.operand);
+                }
                 break;
             }
-            case OR:
+            case LABEL:
+            case NO_OPERAND:
+            case INVALID_OPERAND:
             {
-                *changedMemory << "ACC";
-                auto operand2 = (operandType == MEMORY_LOCATION) ? MEMORY[operand] : operandNumber;
-                ACC = operand2 | ACC;
                 break;
             }
-            // :------------------------- END Instructions --------------------------
-            case END: return {};
-            default:
-            {
-                // Should not touch this line.
-                auto msg = "Assembly instruction \"" + EnumToString(instruction.opcode) + "\" is not supported ";
-                Q_ASSERT_X(false, Q_FUNC_INFO, msg.toStdString().c_str());
-            }
         }
-        return {};
+        if (!ok)
+        {
+            *errorMessage = "\"" + instruction.operand + "\" is not a valid number.";
+        }
+        return decoded;
+    }
+
+    QString NumberToString(int num, NumberBase base)
+    {
+        switch (base)
+        {
+            case BASE2: return "#b" + QString::number(num, 2);
+            case BASE16: return "#&" + QString::number(num, 16);
+            case ASCII: return "\"" + QString(QChar::fromLatin1(num)) + "\"";
+            case BASE10: return "#" + QString::number(num, 10);
+            default: return "Unknown";
+        }
     }
 } // namespace CIEAssembly
@@ -1,34 +1,85 @@
 #pragma once
 
+#include "CIEAssemInstructionSet.hpp"
+#include "CIEAssemMemory.hpp"
+#include "CIEAssemStringTable.hpp"
 #include "Common.hpp"
 
-#include <QMap>
+#include <QHash>
 #include <QMetaEnum>
 #include <QObject>
 #include <QStringList>
+#include <QStringView>
+#include <QVector>
 #include <optional>
 
 namespace CIEAssembly
 {
-    typedef QList<CIEAssemblyInstruction> CIEAssemblyCodeModel;
-//
-#define ACC MEMORY["ACC"]
-#define IX MEMORY["IX"]
-    inline CIEAssemblyCompareResult COMPARE_RESULT;
+    typedef QVector<CIEAssemblyInstruction> CIEAssemblyCodeModel;
+    typedef QVector<CIEAssemblyDecodedInstruction> CIEAssemblyDecodedProgram;
     //
-    inline QMap<QString, char> MEMORY;
-    inline CIEAssemblyCodeModel CODE_MODEL;
-    inline NumberBase Base = BASE10;
+    /// A loaded program, produced by ParseAssemblyCode.
+    struct CIEAssemblyProgram
+    {
+        CIEAssemblyCodeModel code;
+        /// Decoded form of code, with the same indexes.
+        CIEAssemblyDecodedProgram decoded;
+        /// Names of the labels referred by CIEAssemblyInstruction::labelId, "_init_" comes first.
+        QStringList labelNames;
+        /// Initial memory, with the symbols of the program interned.
+        CIEAssemblyMemory memory;
+    };
     //
-    [[nodiscard]] int FindOffsetByLabel(const QString &label);
-    QString NumberToString(int num);
+    /// One line of source, parsed on its own. ParseAssemblyLine does everything that does not depend on the other lines.
+    struct CIEAssemblyParsedLine
+    {
+        CIEAssemblyLineType type = LINE_EMPTY;
+        /// Name of the label declared by a LINE_LABEL.
+        QString label;
+        /// For a LINE_INSTRUCTION, labelId and labelOffset are only known once the lines are assembled.
+        CIEAssemblyInstruction instruction;
+        /// For a LINE_INSTRUCTION, memory addresses and jump targets are only known once the lines are assembled.
+        CIEAssemblyDecodedInstruction decoded;
+        /// Why a LINE_INVALID is invalid.
+        QString errorMessage;
+    };
     //
-    [[nodiscard]] QString ExecuteSingleInstruction(const CIEAssemblyInstruction &instruction, QString *errorMessage, QStringList *changedMemory);
-    CIEAssemblyOperandType DetectNumberType(const QString &operand);
-    CIEAssemblyOperandType DeduceOperandType(const CIEAssemblyInstruction &instruction);
+    QString NumberToString(int num, NumberBase base);
     //
-    QStringList GetLabels(const QString &code);
-    void ParseAssemblyCode(const QString &code, QString *errorMessage);
+    CIEAssemblyOperandType DetectNumberType(QStringView operand);
+    CIEAssemblyOperandType DeduceOperandType(const CIEAssemblyInstruction &instruction, QString *errorMessage);
+    /// Memory operands are interned into memory, or left at address 0 when memory is null.
+    CIEAssemblyDecodedInstruction DecodeInstruction(const CIEAssemblyInstruction &instruction, CIEAssemblyMemory *memory, QString *errorMessage);
+    //
+    QStringList GetLabels(QStringView code);
+    /// The label and the operand are interned into strings when it is not null, so the lines of a program share one string per
+    /// distinct operand, otherwise they are copied out of the line. Nothing else is allocated for a valid line.
+    CIEAssemblyParsedLine ParseAssemblyLine(QStringView line, CIEAssemblyStringTable *strings = nullptr);
+    /// Numbers labels, interns memory and links jumps. The first invalid line is reported.
+    void AssembleParsedLines(const QVector<CIEAssemblyParsedLine> &lines, CIEAssemblyProgram *program, QString *errorMessage);
+    /// Parses the lines in place, as views into code. Besides the arrays of the program, allocated once, the allocations depend on
+    /// the number of distinct labels and operands, not on the number of lines.
+    void ParseAssemblyCode(QStringView code, CIEAssemblyProgram *program, QString *errorMessage);
+    //
+    /// Resolves jump operands against the labels of a program, for LinkAssemblyCode and the parallel loader alike.
+    class CIEAssemblyLinker
+    {
+      public:
+        /// The instructions must have their labelId and labelOffset, numbering the labels as labelNames.
+        CIEAssemblyLinker(const CIEAssemblyCodeModel &code, const QStringList &labelNames);
+        /// Index of the instruction a jump to "label" or "label+N" lands on, -1 if there is none. Can be called from any thread.
+        int Target(QStringView operand) const;
+
+      private:
+        CIEAssemblyStringTable labelIds;
+        /// Start of every segment, the instructions from a declaration of a label to the next one, and the end of the code.
+        QVector<int> segmentStarts;
+        /// The next segment of the same label, -1 for the last one.
+        QVector<int> nextSegments;
+        /// First segment of every label, -1 for a label with no instruction.
+        QVector<int> firstSegments;
+    };
+    void LinkAssemblyCode(const CIEAssemblyCodeModel &code, const QStringList &labelNames, CIEAssemblyDecodedProgram *program, QString *errorMessage);
 } // namespace CIEAssembly
 
 using namespace CIEAssembly;
@@ -0,0 +1,104 @@
+#include "CIEAssemStringTable.hpp"
+
+#include <QHash>
+#include <limits>
+
+namespace CIEAssembly
+{
+    int CIEAssemblyStringTable::Find(QStringView text) const
+    {
+        if (buckets.isEmpty())
+        {
+            return -1;
+        }
+        return buckets.at(BucketOf(text, qHash(text))) - 1;
+    }
+
+    int CIEAssemblyStringTable::Add(QStringView text)
+    {
+        if (2 * (strings.count() + 1) > buckets.count())
+        {
+            Rehash(qMax(16, 2 * buckets.count()));
+        }
+        const auto hash = qHash(text);
+        const auto bucket = BucketOf(text, hash);
+        if (buckets.at(bucket) > 0)
+        {
+            return buckets.at(bucket) - 1;
+        }
+        strings << text.toString();
+        hashes << hash;
+        buckets[bucket] = strings.count();
+        return strings.count() - 1;
+    }
+
+    void CIEAssemblyStringTable::Clear()
+    {
+        strings.clear();
+        hashes.clear();
+        buckets.clear();
+    }
+
+    int CIEAssemblyStringTable::BucketOf(QStringView text, uint hash) const
+    {
+        const auto mask = buckets.count() - 1;
+        for (auto bucket = int(hash) & mask;; bucket = (bucket + 1) & mask)
+        {
+            const auto id = buckets.at(bucket) - 1;
+            if (id < 0 || (hashes.at(id) == hash && QStringView(strings.at(id)) == text))
+            {
+                return bucket;
+            }
+        }
+    }
+
+    void CIEAssemblyStringTable::Rehash(int bucketCount)
+    {
+        buckets.fill(0, bucketCount);
+        const auto mask = bucketCount - 1;
+        for (auto id = 0; id < strings.count(); id++)
+        {
+            auto bucket = int(hashes.at(id)) & mask;
+            while (buckets.at(bucket) != 0)
+            {
+                bucket = (bucket + 1) & mask;
+            }
+            buckets[bucket] = id + 1;
+        }
+    }
+
+    bool ParseNumber(QStringView text, int base, long *value)
+    {
+        auto position = 0;
+        auto negative = false;
+        if (position < text.size() && (text.at(position) == QLatin1Char('+') || text.at(position) == QLatin1Char('-')))
+        {
+            negative = text.at(position) == QLatin1Char('-');
+            position++;
+        }
+        if (base == 16 && position + 1 < text.size() && text.at(position) == QLatin1Char('0') &&
+            (text.at(position + 1) == QLatin1Char('x') || text.at(position + 1) == QLatin1Char('X')))
+        {
+            position += 2;
+        }
+        if (position == text.size())
+        {
+            return false;
+        }
+        // Accumulated as a negative number, which also holds the smallest long.
+        long result = 0;
+        const auto limit = negative ? std::numeric_limits<long>::min() : -std::numeric_limits<long>::max();
+        for (; position < text.size(); position++)
+        {
+            const auto c = text.at(position).unicode();
+            const auto digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'z' ? c - 'a' + 10 : c >= 'A' && c <= 'Z' ? c - 'A' + 10 : base;
+            if (digit >= base || result < (limit + digit) / base)
+            {
+                return false;
+            }
+            result = result * base - digit;
+        }
+        *value = negative ? result : -result;
+        return true;
+    }
+} // namespace CIEAssembly
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+namespace CIEAssembly
+{
+    /// Distinct strings numbered in the order they were added, looked up from views into a source without allocating.
+    ///
+    /// The parser keeps one string per distinct operand or label this way, shared by every instruction that uses it, instead
+    /// of a copy per line. Only adding a new string allocates, besides the arrays of the table growing.
+    class CIEAssemblyStringTable
+    {
+      public:
+        /// Number of the string, -1 if it has not been added.
+        int Find(QStringView text) const;
+        /// Number of the string, added if it was not there yet.
+        int Add(QStringView text);
+        const QString &At(int id) const
+        {
+            return strings.at(id);
+        }
+        const QVector<QString> &Strings() const
+        {
+            return strings;
+        }
+        int Count() const
+        {
+            return strings.count();
+        }
+        void Clear();
+
+      private:
+        /// Bucket of the string, or the empty bucket it would take.
+        int BucketOf(QStringView text, uint hash) const;
+        void Rehash(int bucketCount);
+        //
+        QVector<QString> strings;
+        QVector<uint> hashes;
+        /// Open addressing with linear probing, the number of a string plus one in each bucket, zero for an empty bucket. The number
+        /// of buckets is a power of two, at least twice the number of strings.
+        QVector<int> buckets;
+    };
+
+    /// Reads a whole view as a number like QString::toLong does, without a copy: an optional sign, then digits of the base, with
+    /// an optional "0x" for base 16. Returns false when the view is not a number or does not fit.
+    bool ParseNumber(QStringView text, int base, long *value);
+} // namespace CIEAssembly
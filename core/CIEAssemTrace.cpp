@@ -0,0 +1,132 @@
+#include "CIEAssemTrace.hpp"
+
+namespace CIEAssembly
+{
+    void CIEAssemblyTrace::Append(qint64 cycle, int instruction, const QVector<int> &changedMemory, const CIEAssemblyMemory &memory)
+    {
+        rowCycles.append(cycle);
+        rowInstructions.append(instruction);
+        rowFirstRecords.append(recordColumns.count());
+        AppendRecords(changedMemory, memory);
+        DropOldRows();
+    }
+
+    void CIEAssemblyTrace::AppendMarker(const QString &marker, qint64 cycle, const QVector<int> &addresses, const CIEAssemblyMemory &memory)
+    {
+        markers.append(marker);
+        rowCycles.append(cycle);
+        rowInstructions.append(-markers.count());
+        rowFirstRecords.append(recordColumns.count());
+        AppendRecords(addresses, memory);
+        DropOldRows();
+    }
+
+    void CIEAssemblyTrace::AppendRecords(const QVector<int> &addresses, const CIEAssemblyMemory &memory)
+    {
+        for (const auto address : addresses)
+        {
+            // New symbols may have been interned since the last record.
+            if (address >= addressColumns.count())
+            {
+                addressColumns.resize(memory.Size());
+            }
+            auto column = addressColumns.at(address) - 1;
+            if (column < 0)
+            {
+                column = columnAddresses.count();
+                columnAddresses.append(address);
+                addressColumns[address] = column + 1;
+            }
+            recordColumns.append(column);
+            recordValues.append(memory[address]);
+        }
+    }
+
+    void CIEAssemblyTrace::DropOldRows()
+    {
+        if (rowCycles.count() <= CAPACITY)
+        {
+            return;
+        }
+        // A quarter at once, so the rows left are moved once every CAPACITY / 4 appends.
+        const auto rows = CAPACITY / 4;
+        const auto records = rowFirstRecords.at(rows);
+        auto droppedMarkers = 0;
+        for (auto row = 0; row < rows; row++)
+        {
+            if (rowInstructions.at(row) < 0)
+            {
+                droppedMarkers++;
+            }
+        }
+        rowCycles.remove(0, rows);
+        rowInstructions.remove(0, rows);
+        rowFirstRecords.remove(0, rows);
+        recordColumns.remove(0, records);
+        recordValues.remove(0, records);
+        for (auto row = 0; row < rowCycles.count(); row++)
+        {
+            rowFirstRecords[row] -= records;
+            // Marker rows index the markers from the end of the dropped ones.
+            if (rowInstructions.at(row) < 0)
+            {
+                rowInstructions[row] += droppedMarkers;
+            }
+        }
+        markers.erase(markers.begin(), markers.begin() + droppedMarkers);
+        droppedRows += rows;
+    }
+
+    void CIEAssemblyTrace::Clear()
+    {
+        removedRows += rowCycles.count();
+        rowCycles.clear();
+        rowInstructions.clear();
+        rowFirstRecords.clear();
+        recordColumns.clear();
+        recordValues.clear();
+        columnAddresses.clear();
+        addressColumns.clear();
+        markers.clear();
+    }
+
+    void CIEAssemblyTrace::RemoveAfter(qint64 cycle)
+    {
+        auto rows = rowCycles.count();
+        auto removedMarkers = 0;
+        while (rows > 0 && rowCycles.at(rows - 1) > cycle)
+        {
+            rows--;
+            if (rowInstructions.at(rows) < 0)
+            {
+                removedMarkers++;
+            }
+        }
+        if (rows == rowCycles.count())
+        {
+            return;
+        }
+        const auto records = rowFirstRecords.at(rows);
+        removedRows += rowCycles.count() - rows;
+        rowCycles.resize(rows);
+        rowInstructions.resize(rows);
+        rowFirstRecords.resize(rows);
+        recordColumns.resize(records);
+        recordValues.resize(records);
+        markers.erase(markers.end() - removedMarkers, markers.end());
+    }
+
+    bool CIEAssemblyTrace::Value(int row, int column, char *value) const
+    {
+        const auto end = row + 1 < rowFirstRecords.count() ? rowFirstRecords.at(row + 1) : recordColumns.count();
+        for (auto i = rowFirstRecords.at(row); i < end; i++)
+        {
+            if (recordColumns.at(i) == column)
+            {
+                *value = recordValues.at(i);
+                return true;
+            }
+        }
+        return false;
+    }
+} // namespace CIEAssembly
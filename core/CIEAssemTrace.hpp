@@ -0,0 +1,96 @@
+#pragma once
+
+#include "CIEAssemMemory.hpp"
+
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+
+namespace CIEAssembly
+{
+    /// Execution trace, one row per executed instruction that changed memory, stored column by column.
+    ///
+    /// Rows are appended as the machine runs, and only removed from the end when it goes back in time. Past CAPACITY rows,
+    /// the oldest quarter of them is dropped, so a long run keeps its latest rows in bounded memory.
+    ///
+    /// The trace is written by the thread running the machine, readers on other threads must hold Mutex().
+    class CIEAssemblyTrace
+    {
+      public:
+        static constexpr int CAPACITY = 1 << 20;
+        //
+        /// Appends a row for the instruction at the given index, with the current values of the changed slots.
+        void Append(qint64 cycle, int instruction, const QVector<int> &changedMemory, const CIEAssemblyMemory &memory);
+        /// Appends a row that is not produced by an instruction, such as a memory dump.
+        void AppendMarker(const QString &marker, qint64 cycle, const QVector<int> &addresses, const CIEAssemblyMemory &memory);
+        void Clear();
+        /// Removes the rows of the cycles after the given one, when the machine has gone back in time.
+        void RemoveAfter(qint64 cycle);
+        //
+        int RowCount() const
+        {
+            return rowCycles.count();
+        }
+        /// Number of rows removed since the trace was created, rows that may have been appended again since a reader last looked.
+        qint64 RemovedRows() const
+        {
+            return removedRows;
+        }
+        /// Number of rows dropped from the start since the trace was created, the index of the first row counting them.
+        qint64 DroppedRows() const
+        {
+            return droppedRows;
+        }
+        int ColumnCount() const
+        {
+            return columnAddresses.count();
+        }
+        /// Memory slot shown in a column, columns are ordered by first change.
+        int ColumnAddress(int column) const
+        {
+            return columnAddresses.at(column);
+        }
+        qint64 RowCycle(int row) const
+        {
+            return rowCycles.at(row);
+        }
+        /// Index of the instruction of a row, or -1 for a marker row.
+        int RowInstruction(int row) const
+        {
+            return qMax(-1, rowInstructions.at(row));
+        }
+        QString RowMarker(int row) const
+        {
+            return rowInstructions.at(row) < 0 ? markers.at(-rowInstructions.at(row) - 1) : QString();
+        }
+        /// Looks for the value written to the slot of a column in a row, returns false if the row did not change it.
+        bool Value(int row, int column, char *value) const;
+        //
+        QMutex &Mutex() const
+        {
+            return mutex;
+        }
+
+      private:
+        void AppendRecords(const QVector<int> &addresses, const CIEAssemblyMemory &memory);
+        /// Drops the oldest rows once there are more than CAPACITY.
+        void DropOldRows();
+        //
+        // Rows, records of row i are [rowFirstRecords[i], rowFirstRecords[i + 1]).
+        QVector<qint64> rowCycles;
+        QVector<int> rowInstructions;
+        QVector<int> rowFirstRecords;
+        // Records.
+        QVector<int> recordColumns;
+        QVector<char> recordValues;
+        // Columns.
+        QVector<int> columnAddresses;
+        /// Column of each memory slot plus one, zero when the slot has no column yet.
+        QVector<int> addressColumns;
+        //
+        QStringList markers;
+        qint64 removedRows = 0;
+        qint64 droppedRows = 0;
+        mutable QMutex mutex;
+    };
+} // namespace CIEAssembly
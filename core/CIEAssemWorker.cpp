@@ -0,0 +1,112 @@
+#include "CIEAssemWorker.hpp"
+
+#include <QElapsedTimer>
+
+namespace CIEAssembly
+{
+    CIEAssemblyWorker::CIEAssemblyWorker(QObject *parent) : QThread(parent)
+    {
+    }
+
+    void CIEAssemblyWorker::Start(CIEAssemblyMachine *machine)
+    {
+        Q_ASSERT(!isRunning());
+        this->machine = machine;
+        pauseRequested.storeRelease(0);
+        start();
+    }
+
+    void CIEAssemblyWorker::SetPaused(bool paused)
+    {
+        QMutexLocker locker(&pauseMutex);
+        pauseRequested.storeRelease(paused ? 1 : 0);
+        if (!paused)
+        {
+            pauseGeneration.fetchAndAddOrdered(1);
+            pauseCondition.wakeAll();
+        }
+    }
+
+    void CIEAssemblyWorker::RunUnlocked(const std::function<void()> &function)
+    {
+        if (QThread::currentThread() != this || !traceLocker)
+        {
+            function();
+            return;
+        }
+        // Released in the reverse order of locking, taken again in the same order.
+        profileLocker->unlock();
+        traceLocker->unlock();
+        function();
+        traceLocker->relock();
+        profileLocker->relock();
+    }
+
+    void CIEAssemblyWorker::run()
+    {
+        QElapsedTimer timer;
+        timer.start();
+        auto lastReportTime = timer.elapsed();
+        auto lastRateTime = lastReportTime;
+        auto lastRateCycles = machine->Cycles();
+        auto cyclesPerSecond = 0.0;
+        //
+        while (machine->IsRunning() && !isInterruptionRequested())
+        {
+            if (pauseRequested.loadAcquire())
+            {
+                QMutexLocker locker(&pauseMutex);
+                // A resume followed by a new pause before the worker woke up is a new pause, reported again.
+                auto generation = pauseGeneration.loadAcquire() - 1;
+                while (pauseRequested.loadAcquire() && !isInterruptionRequested())
+                {
+                    if (generation != pauseGeneration.loadAcquire())
+                    {
+                        generation = pauseGeneration.fetchAndAddOrdered(1) + 1;
+                        emit paused(machine->Cycles(), machine->CIR(), generation);
+                    }
+                    pauseCondition.wait(&pauseMutex, PROGRESS_INTERVAL_MS);
+                }
+                lastReportTime = timer.elapsed();
+                lastRateTime = lastReportTime;
+                lastRateCycles = machine->Cycles();
+                continue;
+            }
+            //
+            {
+                // Readers of the trace and the profile wait for at most one slice.
+                QMutexLocker sliceTraceLocker(machine->Trace() ? &machine->Trace()->Mutex() : nullptr);
+                QMutexLocker sliceProfileLocker(machine->Profile() ? &machine->Profile()->Mutex() : nullptr);
+                traceLocker = &sliceTraceLocker;
+                profileLocker = &sliceProfileLocker;
+                machine->Run(SLICE_CYCLES);
+                traceLocker = nullptr;
+                profileLocker = nullptr;
+            }
+            if (machine->LastBreak().IsLimit())
+            {
+                // Reported by finished(), running again would stop at once.
+                return;
+            }
+            if (machine->LastBreak().kind != CIEAssemblyBreak::BREAK_NONE)
+            {
+                // Reported by paused(), the machine can be inspected until the worker is resumed.
+                pauseRequested.storeRelease(1);
+                continue;
+            }
+            //
+            const auto now = timer.elapsed();
+            if (now - lastRateTime >= RATE_INTERVAL_MS)
+            {
+                cyclesPerSecond = (machine->Cycles() - lastRateCycles) * 1000.0 / (now - lastRateTime);
+                lastRateTime = now;
+                lastRateCycles = machine->Cycles();
+            }
+            if (now - lastReportTime >= PROGRESS_INTERVAL_MS)
+            {
+                emit progress(machine->Cycles(), cyclesPerSecond, machine->CIR());
+                lastReportTime = now;
+            }
+        }
+    }
+} // namespace CIEAssembly
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CIEAssemMachine.hpp"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+namespace CIEAssembly
+{
+    /// Runs a CIEAssemblyMachine at full speed on its own thread.
+    ///
+    /// Stop with requestInterruption(), the inherited finished() signal is emitted when the machine is not running anymore.
+    /// The worker pauses itself when the machine hits a breakpoint or a watchpoint, and stops when it reaches a limit.
+    class CIEAssemblyWorker : public QThread
+    {
+        Q_OBJECT
+
+      public:
+        /// Interval between two progress signals, about one frame: the receiver should only keep the last values and show them
+        /// once per frame, it does not have to keep up with every signal.
+        static constexpr int PROGRESS_INTERVAL_MS = 16;
+        /// Interval over which the cycles per second of the progress signals are measured.
+        static constexpr int RATE_INTERVAL_MS = 500;
+        //
+        explicit CIEAssemblyWorker(QObject *parent = nullptr);
+        /// Starts running the machine, which must not be touched by other threads until finished() is emitted, or while paused.
+        void Start(CIEAssemblyMachine *machine);
+        void SetPaused(bool paused);
+        bool IsPaused() const
+        {
+            return pauseRequested.loadAcquire() != 0;
+        }
+        /// Generation of the last pause, passed by paused(). Resuming starts a new one, so a paused() signal arriving after a resume
+        /// can be told apart from the pause the worker is waiting in.
+        int PauseGeneration() const
+        {
+            return pauseGeneration.loadAcquire();
+        }
+        /// Runs a function for a handler of the machine, such as an IN that asks another thread for input. On the worker thread,
+        /// the trace and the profile are released while the function runs, so that other threads can read them meanwhile.
+        void RunUnlocked(const std::function<void()> &function);
+
+      signals:
+        void progress(qint64 cycles, double cyclesPerSecond, int cir);
+        /// Emitted once the worker has actually stopped executing after SetPaused(true), or at a breakpoint or a watchpoint. The
+        /// worker is still waiting only while generation is PauseGeneration() and IsPaused().
+        void paused(qint64 cycles, int cir, int generation);
+
+      protected:
+        void run() override;
+
+      private:
+        /// Number of instructions executed between two checks for pause, stop and progress.
+        static constexpr qint64 SLICE_CYCLES = 1 << 16;
+        //
+        CIEAssemblyMachine *machine = nullptr;
+        QAtomicInt pauseRequested;
+        /// Changed under pauseMutex, by the worker when it pauses and by SetPaused(false).
+        QAtomicInt pauseGeneration;
+        QMutex pauseMutex;
+        QWaitCondition pauseCondition;
+        /// Hold the trace and the profile while a slice runs.
+        QMutexLocker *traceLocker = nullptr;
+        QMutexLocker *profileLocker = nullptr;
+    };
+} // namespace CIEAssembly
@@ -1,15 +1,10 @@
 #pragma once
 #include <QMetaEnum>
 #include <QString>
+#include <QStringList>
 #include <iostream>
 #include <string>
 
-template<typename ENUM_TYPE>
-ENUM_TYPE StringToEnum(const QString &str)
-{
-    return (ENUM_TYPE) QMetaEnum::fromType<ENUM_TYPE>().keyToValue(str.toStdString().c_str());
-}
-
 template<typename ENUM_TYPE>
 QString EnumToString(const ENUM_TYPE &data)
 {
@@ -110,6 +105,14 @@ namespace CIEAssembly
         INVALID_OPERAND = -2
     };
 
+    enum CIEAssemblyLineType
+    {
+        LINE_EMPTY,
+        LINE_LABEL,
+        LINE_INSTRUCTION,
+        LINE_INVALID
+    };
+
     enum CIEAssemblyCompareResult
     {
         RESULT_ARG1 = -1,
@@ -119,12 +122,32 @@ namespace CIEAssembly
 
     struct CIEAssemblyInstruction
     {
-        QString label;
+        /// Index of the last label before this instruction, into the label names of the program.
+        int labelId;
+        /// Number of instructions between that label and this instruction.
+        int labelOffset;
         CIEAssemblyOpcode opcode;
         QString operand;
-        const QString toString() const
+        const QString labelName(const QStringList &labelNames) const
         {
-            return label + " - " + EnumToString(opcode) + (operand.isEmpty() ? "" : (":" + operand));
+            return labelNames.at(labelId) + (labelOffset == 0 ? "" : ("+" + QString::number(labelOffset)));
         }
+        const QString toString(const QStringList &labelNames) const
+        {
+            return labelName(labelNames) + " - " + EnumToString(opcode) + (operand.isEmpty() ? "" : (":" + operand));
+        }
+    };
+
+    /// The executable form of a CIEAssemblyInstruction, everything that can be known before running is resolved when loading.
+    struct CIEAssemblyDecodedInstruction
+    {
+        CIEAssemblyOpcode opcode;
+        CIEAssemblyOperandType operandType;
+        /// Value of a "#", "#&" or "#b" operand.
+        long immediate = 0;
+        /// Memory slot of the operand, or the register for INC and DEC.
+        int address = 0;
+        /// Index of the instruction JMP, JPE and JPN jump to, resolved by LinkAssemblyCode.
+        int target = -1;
     };
 } // namespace CIEAssembly
@@ -1,138 +1,77 @@
 #include "Highlighter.hpp"
 
+#include "CIEAssemLexer.hpp"
+
 namespace CIEAssembly
 {
     CIEAsmHighlighter::CIEAsmHighlighter(QTextDocument *parent) : QSyntaxHighlighter(parent)
     {
-#define BOLD(format)                                                                                                                            \
-    {                                                                                                                                           \
-        auto _font = document()->defaultFont();                                                                                                 \
-        _font.setBold(true);                                                                                                                    \
-        format.setFont(_font);                                                                                                                  \
-    }
-        QTextCharFormat keyword_IO_Format;
-        QTextCharFormat keyword_Other_Format;
-        QTextCharFormat keyword_Label_Format;
-        QTextCharFormat keyword_Address_Format;
-        QTextCharFormat keyword_Bitwise_Format;
-        QTextCharFormat keyword_Comments_Format;
-        QTextCharFormat keyword_Register_Format;
-        QTextCharFormat keyword_Arithmetic_Format;
-        QTextCharFormat keyword_DataMovement_Format;
-        QTextCharFormat keyword_Comparision_Jump_Format;
-        //
-        keyword_IO_Format.setForeground(QColor(Qt::red));
-        keyword_Address_Format.setForeground(QColor(qRgb(60, 220, 255)));
-        keyword_Label_Format.setForeground(QColor(Qt::green));
-        keyword_Other_Format.setForeground(QColor(Qt::yellow));
-        keyword_Bitwise_Format.setForeground(QColor(Qt::cyan));
-        keyword_DataMovement_Format.setForeground(QColor(Qt::gray));
-        keyword_Arithmetic_Format.setForeground(QColor(Qt::magenta));
-        keyword_Register_Format.setForeground(QColor(qRgb(190, 255, 55)));
-        keyword_Comparision_Jump_Format.setForeground(QColor(Qt::lightGray));
-        keyword_Comments_Format.setForeground(QColor(Qt::lightGray));
-        //
-        BOLD(keyword_Address_Format)
+        formats[FORMAT_IO].setForeground(QColor(Qt::red));
+        formats[FORMAT_ADDRESS].setForeground(QColor(qRgb(60, 220, 255)));
+        formats[FORMAT_LABEL].setForeground(QColor(Qt::green));
+        formats[FORMAT_OTHER].setForeground(QColor(Qt::yellow));
+        formats[FORMAT_BITWISE].setForeground(QColor(Qt::cyan));
+        formats[FORMAT_DATA_MOVEMENT].setForeground(QColor(Qt::gray));
+        formats[FORMAT_ARITHMETIC].setForeground(QColor(Qt::magenta));
+        formats[FORMAT_REGISTER].setForeground(QColor(qRgb(190, 255, 55)));
+        formats[FORMAT_COMPARISION_JUMP].setForeground(QColor(Qt::lightGray));
+        formats[FORMAT_COMMENTS].setForeground(QColor(Qt::lightGray));
         //
-        {
-            HighlightingRule rule;
-            rule.pattern = QRegularExpression(R"(LD[MDIXR]|ST[OXI])");
-            rule.pattern.setPatternOptions(QRegularExpression::PatternOption::ExtendedPatternSyntaxOption |
-                                           QRegularExpression::CaseInsensitiveOption);
-            rule.format = keyword_DataMovement_Format;
-            highlightingRules.append(rule);
-        }
-        {
-            HighlightingRule rule;
-            rule.pattern = QRegularExpression(R"((IN|OUT))");
-            rule.pattern.setPatternOptions(QRegularExpression::PatternOption::ExtendedPatternSyntaxOption |
-                                           QRegularExpression::CaseInsensitiveOption);
-            rule.format = keyword_IO_Format;
-            highlightingRules.append(rule);
-        }
-        {
-            HighlightingRule rule;
-            rule.pattern = QRegularExpression(R"((ADD|INC|DEC))");
-            rule.pattern.setPatternOptions(QRegularExpression::PatternOption::ExtendedPatternSyntaxOption |
-                                           QRegularExpression::CaseInsensitiveOption);
-            rule.format = keyword_Arithmetic_Format;
-            highlightingRules.append(rule);
-        }
-        {
-            HighlightingRule rule;
-            rule.pattern = QRegularExpression(R"((CMP|JMP|JPE|JPN))");
-            rule.pattern.setPatternOptions(QRegularExpression::PatternOption::ExtendedPatternSyntaxOption |
-                                           QRegularExpression::CaseInsensitiveOption);
-            rule.format = keyword_Comparision_Jump_Format;
-            highlightingRules.append(rule);
-        }
-        {
-            HighlightingRule rule;
-            rule.pattern = QRegularExpression(R"((AND|XOR|OR|LSL|LSR))");
-            rule.pattern.setPatternOptions(QRegularExpression::PatternOption::ExtendedPatternSyntaxOption |
-                                           QRegularExpression::CaseInsensitiveOption);
-            rule.format = keyword_Bitwise_Format;
-            highlightingRules.append(rule);
-        }
-        {
-            HighlightingRule rule;
-            rule.pattern = QRegularExpression(R"(\b(IX|ACC)\b)");
-            rule.pattern.setPatternOptions(QRegularExpression::PatternOption::ExtendedPatternSyntaxOption |
-                                           QRegularExpression::CaseInsensitiveOption);
-            rule.format = keyword_Register_Format;
-            highlightingRules.append(rule);
-        }
-        {
-            HighlightingRule rule;
-            rule.pattern = QRegularExpression(R"(\bEND\b)");
-            rule.pattern.setPatternOptions(QRegularExpression::PatternOption::ExtendedPatternSyntaxOption |
-                                           QRegularExpression::CaseInsensitiveOption);
-            rule.format = keyword_Other_Format;
-            highlightingRules.append(rule);
-        }
-        {
-            // auto number = R"(#(\d+))";
-            auto addressing = R"(\#(\d+|[Bb][0|1]{8}|\&[\dA-Fa-f]+))";
-            HighlightingRule rule;
-            rule.pattern = QRegularExpression(addressing);
-            rule.pattern.setPatternOptions(QRegularExpression::PatternOption::ExtendedPatternSyntaxOption |
-                                           QRegularExpression::CaseInsensitiveOption);
-            rule.format = keyword_Address_Format;
-            highlightingRules.append(rule);
-        }
-        {
-            auto addressing = R"(\w+:)";
-            HighlightingRule rule;
-            rule.pattern = QRegularExpression(addressing);
-            rule.pattern.setPatternOptions(QRegularExpression::PatternOption::ExtendedPatternSyntaxOption |
-                                           QRegularExpression::CaseInsensitiveOption);
-            rule.format = keyword_Label_Format;
-            highlightingRules.append(rule);
-        }
-        {
-            auto addressing = R"(\;.*$)";
-            HighlightingRule rule;
-            rule.pattern = QRegularExpression(addressing);
-            rule.pattern.setPatternOptions(QRegularExpression::PatternOption::ExtendedPatternSyntaxOption |
-                                           QRegularExpression::CaseInsensitiveOption);
-            rule.format = keyword_Comments_Format;
-            highlightingRules.append(rule);
-        }
+        auto font = document()->defaultFont();
+        font.setBold(true);
+        formats[FORMAT_ADDRESS].setFont(font);
     }
 
     void CIEAsmHighlighter::highlightBlock(const QString &text)
     {
-        for (const HighlightingRule &rule : highlightingRules)
+        // Format of every category of opcodes, in the order of CIEAssemblyCategory.
+        static const HighlightFormat categoryFormats[] = { FORMAT_DATA_MOVEMENT, FORMAT_ARITHMETIC, FORMAT_COMPARISION_JUMP,
+                                                           FORMAT_IO, FORMAT_BITWISE, FORMAT_OTHER };
+        static_assert(sizeof(categoryFormats) / sizeof(*categoryFormats) == CATEGORY_COUNT, "Every category needs a format.");
+        //
+        auto lineType = LINE_EMPTY;
+        CIEAssemblyLexer lexer(text);
+        CIEAssemblyToken token;
+        while (lexer.Next(&token))
         {
-            QRegularExpressionMatchIterator matchIterator = rule.pattern.globalMatch(text);
-
-            while (matchIterator.hasNext())
+            switch (token.type)
             {
-                QRegularExpressionMatch match = matchIterator.next();
-                setFormat(match.capturedStart(), match.capturedLength(), rule.format);
+                case TOKEN_LABEL:
+                {
+                    lineType = LINE_LABEL;
+                    setFormat(token.start, token.length, formats[FORMAT_LABEL]);
+                    break;
+                }
+                case TOKEN_OPCODE:
+                {
+                    lineType = LINE_INSTRUCTION;
+                    setFormat(token.start, token.length, formats[categoryFormats[InstructionInfo(token.opcode).category]]);
+                    break;
+                }
+                case TOKEN_REGISTER:
+                {
+                    setFormat(token.start, token.length, formats[FORMAT_REGISTER]);
+                    break;
+                }
+                case TOKEN_IMMEDIATE:
+                {
+                    setFormat(token.start, token.length, formats[FORMAT_ADDRESS]);
+                    break;
+                }
+                case TOKEN_COMMENT:
+                {
+                    setFormat(token.start, token.length, formats[FORMAT_COMMENTS]);
+                    break;
+                }
+                case TOKEN_INVALID:
+                {
+                    lineType = LINE_INVALID;
+                    break;
+                }
+                case TOKEN_SYMBOL:
+                case TOKEN_EXTRA: break;
             }
         }
-
-        setCurrentBlockState(0);
+        setCurrentBlockState(lineType);
     }
 } // namespace CIEAssembly
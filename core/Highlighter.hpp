@@ -1,10 +1,12 @@
 #pragma once
-#include <QRegularExpression>
 #include <QSyntaxHighlighter>
 #include <QTextCharFormat>
 #include <QTextDocument>
 namespace CIEAssembly
 {
+    /// Colors each block from the tokens of CIEAssemblyLexer, in a single scan.
+    ///
+    /// A block never depends on the previous one, its state is the type of the line, so editing a block never re-highlights the next ones.
     class CIEAsmHighlighter : public QSyntaxHighlighter
     {
         Q_OBJECT
@@ -16,11 +18,20 @@ namespace CIEAssembly
         void highlightBlock(const QString &text) override;
 
       private:
-        struct HighlightingRule
+        enum HighlightFormat
         {
-            QRegularExpression pattern;
-            QTextCharFormat format;
+            FORMAT_DATA_MOVEMENT,
+            FORMAT_IO,
+            FORMAT_ARITHMETIC,
+            FORMAT_COMPARISION_JUMP,
+            FORMAT_BITWISE,
+            FORMAT_OTHER,
+            FORMAT_REGISTER,
+            FORMAT_ADDRESS,
+            FORMAT_LABEL,
+            FORMAT_COMMENTS,
+            FORMAT_COUNT
         };
-        QVector<HighlightingRule> highlightingRules;
+        QTextCharFormat formats[FORMAT_COUNT];
     };
 } // namespace CIEAssembly
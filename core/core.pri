@@ -0,0 +1,46 @@
+# The interpreter core, shared by the GUI and the command-line runner. It only depends on QtCore.
+
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+    $$PWD/CIEAssemBatch.cpp \
+    $$PWD/CIEAssemBreakpoints.cpp \
+    $$PWD/CIEAssemCompiled.cpp \
+    $$PWD/CIEAssemConsole.cpp \
+    $$PWD/CIEAssemExplore.cpp \
+    $$PWD/CIEAssemHistory.cpp \
+    $$PWD/CIEAssemInterpreter.cpp \
+    $$PWD/CIEAssemJit.cpp \
+    $$PWD/CIEAssemLanes.cpp \
+    $$PWD/CIEAssemLexer.cpp \
+    $$PWD/CIEAssemLoader.cpp \
+    $$PWD/CIEAssemMachine.cpp \
+    $$PWD/CIEAssemMemory.cpp \
+    $$PWD/CIEAssemOptimizer.cpp \
+    $$PWD/CIEAssemProfile.cpp \
+    $$PWD/CIEAssemRunner.cpp \
+    $$PWD/CIEAssemStringTable.cpp \
+    $$PWD/CIEAssemTrace.cpp \
+    $$PWD/CIEAssemWorker.cpp
+
+HEADERS += \
+    $$PWD/Common.hpp \
+    $$PWD/CIEAssemBatch.hpp \
+    $$PWD/CIEAssemBreakpoints.hpp \
+    $$PWD/CIEAssemCompiled.hpp \
+    $$PWD/CIEAssemConsole.hpp \
+    $$PWD/CIEAssemExplore.hpp \
+    $$PWD/CIEAssemHistory.hpp \
+    $$PWD/CIEAssemInstructionSet.hpp \
+    $$PWD/CIEAssemJit.hpp \
+    $$PWD/CIEAssemLanes.hpp \
+    $$PWD/CIEAssemLexer.hpp \
+    $$PWD/CIEAssemLoader.hpp \
+    $$PWD/CIEAssemMachine.hpp \
+    $$PWD/CIEAssemMemory.hpp \
+    $$PWD/CIEAssemOptimizer.hpp \
+    $$PWD/CIEAssemProfile.hpp \
+    $$PWD/CIEAssemRunner.hpp \
+    $$PWD/CIEAssemStringTable.hpp \
+    $$PWD/CIEAssemTrace.hpp \
+    $$PWD/CIEAssemWorker.hpp
@@ -0,0 +1,178 @@
+#include "CodeEditor.hpp"
+
+#include <QHelpEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QTextBlock>
+#include <QToolTip>
+#include <cmath>
+
+namespace
+{
+    /// Marks a block with a breakpoint, the document deletes it with its block.
+    class BreakpointData : public QTextBlockUserData
+    {
+    };
+} // namespace
+
+class CodeEditor::Gutter : public QWidget
+{
+  public:
+    explicit Gutter(CodeEditor *editor) : QWidget(editor), editor(editor)
+    {
+    }
+
+  protected:
+    void paintEvent(QPaintEvent *event) override
+    {
+        editor->PaintGutter(event);
+    }
+    void mousePressEvent(QMouseEvent *event) override
+    {
+        const auto block = editor->BlockAt(event->pos().y());
+        if (event->button() == Qt::LeftButton && block >= 0)
+        {
+            editor->ToggleBreakpoint(block);
+        }
+    }
+    bool event(QEvent *event) override
+    {
+        if (event->type() != QEvent::ToolTip)
+        {
+            return QWidget::event(event);
+        }
+        const auto helpEvent = static_cast<QHelpEvent *>(event);
+        const auto block = editor->BlockAt(helpEvent->pos().y());
+        const auto count = editor->heat.value(block);
+        if (block < 0 || count == 0)
+        {
+            QToolTip::hideText();
+            event->ignore();
+            return true;
+        }
+        const auto share = 100.0 * count / editor->totalHeat;
+        QToolTip::showText(helpEvent->globalPos(), QString("%1 executions, %2 %").arg(count).arg(share, 0, 'f', 2), this);
+        return true;
+    }
+
+  private:
+    CodeEditor *editor;
+};
+
+CodeEditor::CodeEditor(QWidget *parent) : QPlainTextEdit(parent), gutter(new Gutter(this))
+{
+    connect(this, &QPlainTextEdit::updateRequest, this, [this](const QRect &rect, int dy) {
+        if (dy != 0)
+        {
+            gutter->scroll(0, dy);
+        }
+        else
+        {
+            gutter->update(0, rect.y(), gutter->width(), rect.height());
+        }
+    });
+    connect(this, &QPlainTextEdit::blockCountChanged, this, [this] {
+        if (!heat.isEmpty())
+        {
+            SetHeat({});
+        }
+    });
+}
+
+void CodeEditor::SetHeat(const QVector<qint64> &blockCounts)
+{
+    heat = blockCounts;
+    maximumHeat = 0;
+    totalHeat = 0;
+    for (const auto count : heat)
+    {
+        maximumHeat = qMax(maximumHeat, count);
+        totalHeat += count;
+    }
+    gutter->update();
+}
+
+void CodeEditor::ToggleBreakpoint(int block)
+{
+    auto textBlock = document()->findBlockByNumber(block);
+    if (!textBlock.isValid())
+    {
+        return;
+    }
+    textBlock.setUserData(textBlock.userData() ? nullptr : new BreakpointData);
+    gutter->update();
+    emit breakpointsChanged();
+}
+
+QVector<int> CodeEditor::BreakpointBlocks() const
+{
+    QVector<int> blocks;
+    for (auto block = document()->begin(); block.isValid(); block = block.next())
+    {
+        if (block.userData())
+        {
+            blocks << block.blockNumber();
+        }
+    }
+    return blocks;
+}
+
+void CodeEditor::resizeEvent(QResizeEvent *event)
+{
+    QPlainTextEdit::resizeEvent(event);
+    UpdateGutterGeometry();
+}
+
+void CodeEditor::UpdateGutterGeometry()
+{
+    setViewportMargins(GUTTER_WIDTH, 0, 0, 0);
+    const auto contents = contentsRect();
+    gutter->setGeometry(QRect(contents.left(), contents.top(), GUTTER_WIDTH, contents.height()));
+}
+
+void CodeEditor::PaintGutter(QPaintEvent *event)
+{
+    QPainter painter(gutter);
+    painter.fillRect(event->rect(), palette().window());
+    // A logarithmic scale keeps the lines run once visible next to a loop run millions of times.
+    const auto scale = std::log1p(double(maximumHeat));
+    auto block = firstVisibleBlock();
+    auto top = qRound(blockBoundingGeometry(block).translated(contentOffset()).top());
+    while (block.isValid() && top <= event->rect().bottom())
+    {
+        const auto height = qRound(blockBoundingRect(block).height());
+        const auto count = heat.value(block.blockNumber());
+        if (block.isVisible() && count > 0 && top + height >= event->rect().top())
+        {
+            const auto intensity = std::log1p(double(count)) / scale;
+            // From yellow for the coldest lines to red for the hottest.
+            painter.fillRect(0, top, GUTTER_WIDTH, height, QColor::fromHsvF((1 - intensity) / 6, 1, 1, 0.35 + 0.65 * intensity));
+        }
+        if (block.isVisible() && block.userData())
+        {
+            const auto diameter = qMin(GUTTER_WIDTH, height) - 4;
+            painter.setRenderHint(QPainter::Antialiasing);
+            painter.setPen(Qt::darkRed);
+            painter.setBrush(Qt::red);
+            painter.drawEllipse((GUTTER_WIDTH - diameter) / 2, top + (height - diameter) / 2, diameter, diameter);
+        }
+        top += height;
+        block = block.next();
+    }
+}
+
+int CodeEditor::BlockAt(int y) const
+{
+    auto block = firstVisibleBlock();
+    auto top = qRound(blockBoundingGeometry(block).translated(contentOffset()).top());
+    for (; block.isValid(); block = block.next())
+    {
+        const auto height = qRound(blockBoundingRect(block).height());
+        if (y < top + height)
+        {
+            return y >= top ? block.blockNumber() : -1;
+        }
+        top += height;
+    }
+    return -1;
+}
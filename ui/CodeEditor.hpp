@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QPlainTextEdit>
+#include <QVector>
+
+/// The source editor, with a gutter colored by how often the instruction on each line has been executed.
+///
+/// Clicking the gutter toggles a breakpoint on a line, breakpoints are kept on their blocks so they move with the text.
+class CodeEditor : public QPlainTextEdit
+{
+    Q_OBJECT
+
+  public:
+    explicit CodeEditor(QWidget *parent = nullptr);
+    /// Execution count of every block.
+    /// The counts are dropped when lines are added or removed, as they would not match the lines anymore.
+    void SetHeat(const QVector<qint64> &blockCounts);
+    void ToggleBreakpoint(int block);
+    /// Numbers of the blocks with a breakpoint, in increasing order.
+    QVector<int> BreakpointBlocks() const;
+
+  signals:
+    void breakpointsChanged();
+
+  protected:
+    void resizeEvent(QResizeEvent *event) override;
+
+  private:
+    class Gutter;
+    //
+    static constexpr int GUTTER_WIDTH = 14;
+    //
+    void UpdateGutterGeometry();
+    void PaintGutter(QPaintEvent *event);
+    /// Block number under a point of the gutter, -1 below the last block.
+    int BlockAt(int y) const;
+    //
+    QWidget *gutter;
+    QVector<qint64> heat;
+    qint64 maximumHeat = 0;
+    qint64 totalHeat = 0;
+};
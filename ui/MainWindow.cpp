@@ -1,147 +1,555 @@
 #include "MainWindow.hpp"
 
-#include "core/CIEAssemRunner.hpp"
+#include "core/CIEAssemCompiled.hpp"
 #include "core/Highlighter.hpp"
+#include "ParseCache.hpp"
+#include "ProfileModel.hpp"
+#include "TraceModel.hpp"
 #include "ui_MainWindow.h"
 
+#include <QCoreApplication>
+#include <QFileDialog>
+#include <QInputDialog>
 #include <QMessageBox>
+#include <QSortFilterProxyModel>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QThread>
+#include <QTimer>
 #include <QtGlobal>
+#include <algorithm>
+
+namespace
+{
+    /// Data of the items of the breakpoint list.
+    enum BreakpointRole
+    {
+        ROLE_WATCH = Qt::UserRole,
+        ROLE_LOCATION,
+        ROLE_CONDITION
+    };
+} // namespace
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
     new CIEAsmHighlighter(ui->assmTxt->document());
+    parseCache = new ParseCache(ui->assmTxt->document(), this);
+    ui->labelList->insertItems(0, parseCache->Labels());
+    connect(parseCache, &ParseCache::labelsChanged, this, &MainWindow::OnLabelsChanged);
+    // The editor drops its heat when lines are added or removed, the profile of the loaded program is not shown again.
+    connect(ui->assmTxt, &QPlainTextEdit::blockCountChanged, this, [this] { instructionBlocks.clear(); });
+    connect(ui->assmTxt, &CodeEditor::breakpointsChanged, this, &MainWindow::OnBreakpointsChanged);
+    machine.SetTrace(&trace);
+    machine.SetHistory(&history);
+    traceModel = new TraceModel(&machine, &trace, this);
+    ui->memoryTable->setModel(traceModel);
+    profileModel = new ProfileModel(&machine, &profile, this);
+    auto *profileProxy = new QSortFilterProxyModel(this);
+    profileProxy->setSourceModel(profileModel);
+    profileProxy->setSortRole(ProfileModel::SORT_ROLE);
+    ui->profileTable->setModel(profileProxy);
+    ui->profileTable->sortByColumn(ProfileModel::COLUMN_EXECUTIONS, Qt::DescendingOrder);
+    // IN and OUT may be called from the worker thread. IN reads the tape, and only asks once all of it has been read: what is
+    // typed is added to the tape, cancelling stops the program. OUT never waits, the output is shown by the timer.
+    machine.SetInputHandler([this]() -> int {
+        const auto c = console.Read();
+        if (c >= 0)
+        {
+            return c;
+        }
+        QString text;
+        RunOnGuiThread([&] {
+            // Nothing is asked once the window is closing, the program stops at the IN.
+            if (!closing)
+            {
+                text = QInputDialog::getText(this, tr("Input"), tr("The input tape has been read, more input"));
+            }
+        });
+        console.AppendInput(text.toLatin1());
+        return console.Read();
+    });
+    machine.SetOutputHandler([this](char c) { console.Write(c); });
+    ui->outputTxt->setMaximumBlockCount(MAXIMUM_OUTPUT_LINES);
+    outputTimer = new QTimer(this);
+    outputTimer->setInterval(OUTPUT_INTERVAL_MS);
+    connect(outputTimer, &QTimer::timeout, this, &MainWindow::FlushOutput);
+    frameTimer = new QTimer(this);
+    frameTimer->setSingleShot(true);
+    frameTimer->setInterval(FRAME_INTERVAL_MS);
+    connect(frameTimer, &QTimer::timeout, this, &MainWindow::ShowFrame);
+    //
+    worker = new CIEAssemblyWorker(this);
+    connect(worker, &CIEAssemblyWorker::progress, this, &MainWindow::OnWorkerProgress);
+    connect(worker, &CIEAssemblyWorker::paused, this, &MainWindow::OnWorkerPaused);
+    connect(worker, &CIEAssemblyWorker::finished, this, &MainWindow::OnWorkerFinished);
 }
 
 MainWindow::~MainWindow()
 {
+    closing = true;
+    worker->disconnect(this);
+    worker->requestInterruption();
+    // The worker may be waiting at an IN for the GUI thread, which has to answer it while waiting.
+    while (!worker->wait(FRAME_INTERVAL_MS))
+    {
+        QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    }
     delete ui;
 }
 
+void MainWindow::RunOnGuiThread(const std::function<void()> &function)
+{
+    if (QThread::currentThread() == thread())
+    {
+        function();
+        return;
+    }
+    // The worker holds the trace and the profile while running, the GUI thread must be able to read them while the dialog is open.
+    worker->RunUnlocked([&] { QMetaObject::invokeMethod(this, function, Qt::BlockingQueuedConnection); });
+}
+
+void MainWindow::SetRunning(bool running)
+{
+    if (running)
+    {
+        outputTimer->start();
+    }
+    else
+    {
+        outputTimer->stop();
+        FlushOutput();
+    }
+    workerPaused = false;
+    ui->pauseBtn->setChecked(false);
+    ui->pauseBtn->setEnabled(running);
+    ui->runBtn->setEnabled(!running);
+    ui->stepBtn->setEnabled(!running);
+    ui->stepBackBtn->setEnabled(!running);
+    ui->backToWriteBtn->setEnabled(!running);
+    ui->goToCycleBtn->setEnabled(!running);
+    ui->setMemBtn->setEnabled(!running);
+    ui->profileChk->setEnabled(!running);
+    ui->liveViewChk->setEnabled(!running);
+}
+
 void MainWindow::ClearData()
 {
-    ui->memoryTable->model()->removeRows(0, ui->memoryTable->rowCount());
-    ui->memoryTable->model()->removeColumns(0, ui->memoryTable->columnCount());
-    ui->memoryTable->clear();
-    CIR = 0;
-    execCycles = 0;
+    trace.Clear();
+    traceModel->Reset();
+    profile.Clear();
+    machine.Reset();
+    // The next run or step starts from the start of the tape again.
+    console.SetInput(ui->inputTapeTxt->toPlainText().toLatin1());
+    FlushOutput();
+    RefreshViews();
 }
 
-void MainWindow::on_runBtn_clicked()
+bool MainWindow::LoadProgram()
 {
-    on_stopBtn_clicked();
     QString errorMessage;
-    ParseAssemblyCode(ui->assmTxt->toPlainText(), &errorMessage);
+    CIEAssemblyProgram program;
+    parseCache->Assemble(&program, &errorMessage);
     if (!errorMessage.isEmpty())
     {
         QMessageBox::warning(this, tr("Invalid CIE Assembly Code"), errorMessage);
+        return false;
+    }
+    machine.Load(program);
+    CIEAssemblyLimits limits;
+    limits.maxCycles = ui->cycleLimitSpin->value() > 0 ? ui->cycleLimitSpin->value() * qint64(1000000) : -1;
+    limits.timeoutMs = ui->timeLimitSpin->value() > 0 ? ui->timeLimitSpin->value() * qint64(1000) : -1;
+    limits.detectLoops = ui->detectLoopsChk->isChecked();
+    machine.SetLimits(limits);
+    console.SetInput(ui->inputTapeTxt->toPlainText().toLatin1());
+    instructionBlocks.clear();
+    const auto &lines = parseCache->Lines();
+    for (auto i = 0; i < lines.count(); i++)
+    {
+        if (lines.at(i).type == LINE_INSTRUCTION)
+        {
+            instructionBlocks << i;
+        }
+    }
+    if (!ApplyBreakpoints(&errorMessage))
+    {
+        QMessageBox::warning(this, tr("Invalid Breakpoint"), errorMessage);
+        return false;
+    }
+    return true;
+}
+
+int MainWindow::InstructionAtBlock(int block) const
+{
+    const auto instruction = std::lower_bound(instructionBlocks.begin(), instructionBlocks.end(), block);
+    return instruction == instructionBlocks.end() ? -1 : int(instruction - instructionBlocks.begin());
+}
+
+bool MainWindow::ApplyBreakpoints(QString *errorMessage)
+{
+    const auto &program = machine.Program();
+    CIEAssemblyBreakpoints breakpoints;
+    if (!instructionBlocks.isEmpty())
+    {
+        for (const auto block : ui->assmTxt->BreakpointBlocks())
+        {
+            const auto instruction = InstructionAtBlock(block);
+            if (instruction >= 0)
+            {
+                breakpoints.SetBreakpoint(instruction);
+            }
+        }
+    }
+    for (auto row = 0; row < ui->breakpointList->count(); row++)
+    {
+        const auto *item = ui->breakpointList->item(row);
+        const auto location = item->data(ROLE_LOCATION).toString();
+        CIEAssemblyCondition condition;
+        if (!ParseCondition(item->data(ROLE_CONDITION).toString(), program.memory, &condition, errorMessage))
+        {
+            return false;
+        }
+        if (item->data(ROLE_WATCH).toBool())
+        {
+            const auto address = program.memory.Find(location);
+            if (address < 0)
+            {
+                *errorMessage = "\"" + location + "\" is not used by the program.";
+                return false;
+            }
+            breakpoints.SetWatchpoint(address, condition);
+            continue;
+        }
+        // Lines are numbered from 1 in the list, like in the editor.
+        auto isLine = false;
+        const auto line = location.toInt(&isLine);
+        if (isLine && instructionBlocks.isEmpty())
+        {
+            continue;
+        }
+        const auto instruction = isLine ? InstructionAtBlock(line - 1) : FindInstruction(program, location);
+        if (instruction < 0)
+        {
+            *errorMessage = "No instruction at \"" + location + "\".";
+            return false;
+        }
+        breakpoints.SetBreakpoint(instruction, condition);
+    }
+    machine.SetBreakpoints(breakpoints);
+    return true;
+}
+
+void MainWindow::on_runBtn_clicked()
+{
+    if (worker->isRunning())
+    {
+        return;
+    }
+    on_stopBtn_clicked();
+    if (!LoadProgram())
+    {
+        return;
+    }
+    SetRunning(true);
+    DetachViews();
+    worker->Start(&machine);
+}
+
+void MainWindow::on_pauseBtn_toggled(bool checked)
+{
+    if (!checked && workerPaused)
+    {
+        // Resuming hands the machine back to the worker.
+        workerPaused = false;
+        ui->setMemBtn->setEnabled(false);
+        DetachViews();
+    }
+    worker->SetPaused(checked);
+}
+
+void MainWindow::OnWorkerProgress(qint64 cycles, double cyclesPerSecond, int cir)
+{
+    // Only the last progress is shown, at the next frame.
+    pendingProgress = { cycles, cyclesPerSecond, cir };
+    progressPending = true;
+    viewsPending = viewsPending || !viewsDetached;
+    ScheduleFrame();
+}
+
+void MainWindow::ShowProgress(const Progress &progress)
+{
+    ui->execCyclesLabel->setText(QString::number(progress.cycles));
+    const auto &program = machine.Program();
+    if (progress.cir >= 0 && progress.cir < program.code.count())
+    {
+        ui->nextInstructionLabel->setText(program.code.at(progress.cir).toString(program.labelNames));
+    }
+    // The rate is only known after the worker has run for a while.
+    ui->statusbar->showMessage(progress.cyclesPerSecond > 0 ? QString::number(progress.cyclesPerSecond, 'f', 0) + " cycles/s" : "Running");
+}
+
+void MainWindow::ScheduleFrame()
+{
+    if (!frameTimer->isActive())
+    {
+        frameTimer->start();
+    }
+}
+
+void MainWindow::ShowFrame()
+{
+    if (progressPending)
+    {
+        progressPending = false;
+        ShowProgress(pendingProgress);
+    }
+    if (viewsPending)
+    {
+        viewsPending = false;
+        RefreshViews();
+    }
+}
+
+void MainWindow::DetachViews()
+{
+    if (ui->liveViewChk->isChecked())
+    {
+        return;
+    }
+    machine.SetTrace(nullptr);
+    machine.SetHistory(nullptr);
+    viewsDetached = true;
+}
+
+void MainWindow::AttachViews()
+{
+    if (!viewsDetached)
+    {
+        return;
+    }
+    viewsDetached = false;
+    machine.SetTrace(&trace);
+    machine.SetHistory(&history);
+    // The history cannot go back through the instructions it did not record.
+    history.Clear();
+    trace.AppendMarker("RUN", machine.Cycles(), machine.Memory().Symbols(), machine.Memory());
+}
+
+void MainWindow::OnWorkerPaused(qint64 cycles, int cir, int generation)
+{
+    // The signal is queued: the worker may have been resumed since, and be running the machine again.
+    if (generation != worker->PauseGeneration() || !worker->IsPaused())
+    {
+        return;
+    }
+    // The worker is waiting, the machine can be inspected and modified until it's resumed.
+    progressPending = false;
+    AttachViews();
+    ShowProgress({ cycles, 0, cir });
+    RefreshViews();
+    FlushOutput();
+    workerPaused = true;
+    ui->setMemBtn->setEnabled(true);
+    OnBreakpointsChanged();
+    const auto &lastBreak = machine.LastBreak();
+    if (lastBreak.kind == CIEAssemblyBreak::BREAK_NONE)
+    {
+        ui->statusbar->showMessage("Paused");
         return;
     }
-    while (CIR < CODE_MODEL.count() && CIR >= 0)
+    // The worker paused itself, resuming is done with the pause button like after a pause.
+    ui->pauseBtn->setChecked(true);
+    const auto &program = machine.Program();
+    const auto instruction = program.code.at(lastBreak.instruction).toString(program.labelNames);
+    ui->statusbar->showMessage(lastBreak.kind == CIEAssemblyBreak::BREAK_BREAKPOINT
+                                   ? tr("Breakpoint before %1").arg(instruction)
+                                   : tr("Watchpoint on %1, written by %2").arg(machine.Memory().NameOf(lastBreak.address), instruction));
+    if (lastBreak.instruction < instructionBlocks.count())
+    {
+        ui->assmTxt->setTextCursor(QTextCursor(ui->assmTxt->document()->findBlockByNumber(instructionBlocks.at(lastBreak.instruction))));
+    }
+}
+
+void MainWindow::OnWorkerFinished()
+{
+    progressPending = false;
+    AttachViews();
+    SetRunning(false);
+    ui->statusbar->clearMessage();
+    if (clearWhenFinished)
     {
-        on_stepBtn_clicked();
+        clearWhenFinished = false;
+        ClearData();
+        return;
     }
-    if (CIR < 0)
+    ui->execCyclesLabel->setText(QString::number(machine.Cycles()));
+    RefreshViews();
+    if (machine.IsStopped())
     {
         QMessageBox::warning(this, tr("Error"), "Stopped executing.");
     }
+    const auto &lastBreak = machine.LastBreak();
+    if (lastBreak.IsLimit())
+    {
+        const auto &program = machine.Program();
+        const auto instruction = program.code.at(lastBreak.instruction).toString(program.labelNames);
+        if (lastBreak.instruction < instructionBlocks.count())
+        {
+            ui->assmTxt->setTextCursor(QTextCursor(ui->assmTxt->document()->findBlockByNumber(instructionBlocks.at(lastBreak.instruction))));
+        }
+        QMessageBox::warning(this, tr("Stopped"),
+                             lastBreak.kind == CIEAssemblyBreak::BREAK_LOOP
+                                 ? tr("Infinite loop: after the jump %1, the machine is in the same state as %2 cycles before.")
+                                       .arg(instruction)
+                                       .arg(lastBreak.period)
+                             : lastBreak.kind == CIEAssemblyBreak::BREAK_CYCLE_LIMIT
+                                 ? tr("Stopped before %1: the cycle limit of %2 was reached.").arg(instruction).arg(machine.Limits().maxCycles)
+                                 : tr("Stopped before %1: the time limit of %2 ms was reached.").arg(instruction).arg(machine.Limits().timeoutMs));
+    }
 }
 
 void MainWindow::on_stepBtn_clicked()
 {
-    QString errorMessage;
-
-    if (CODE_MODEL.isEmpty())
+    const auto &program = machine.Program();
+    if (program.code.isEmpty())
     {
-        ParseAssemblyCode(ui->assmTxt->toPlainText(), &errorMessage);
-        if (!errorMessage.isEmpty())
+        if (!LoadProgram())
         {
-            QMessageBox::warning(this, tr("Invalid CIE Assembly Code"), errorMessage);
             return;
         }
     }
-    if (CIR >= CODE_MODEL.count())
+    if (!machine.IsRunning())
     {
         QMessageBox::warning(this, "Execution Finished", "Completed stepping.");
         return;
     }
     //
-    execCycles++;
-    ui->execCyclesLabel->setText(QString::number(execCycles));
-    //
-    const auto &code = CODE_MODEL.at(CIR);
-    QStringList changedMem;
-    auto jumpInstruction = ExecuteSingleInstruction(code, &errorMessage, &changedMem);
-    if (!errorMessage.isEmpty())
+    machine.Step();
+    ShowMachineState();
+}
+
+void MainWindow::ShowMachineState()
+{
+    FlushOutput();
+    ui->execCyclesLabel->setText(QString::number(machine.Cycles()));
+    // Stepping repeatedly redraws the views once per frame.
+    viewsPending = true;
+    ScheduleFrame();
+    if (machine.IsRunning())
     {
-        QMessageBox::warning(this, "Code execution error", errorMessage);
-        CIR = CODE_MODEL.count() + 1;
+        const auto &program = machine.Program();
+        ui->nextInstructionLabel->setText(program.code.at(machine.CIR()).toString(program.labelNames));
+    }
+}
+
+void MainWindow::on_stepBackBtn_clicked()
+{
+    const auto inputs = history.InputCount();
+    if (!machine.StepBack())
+    {
+        QMessageBox::information(this, tr("Step Back"), tr("There is no earlier instruction to go back to."));
         return;
     }
-    if (!jumpInstruction.isEmpty())
+    // The characters read by the undone instructions will be read again.
+    console.Unread(inputs - history.InputCount());
+    ShowMachineState();
+}
+
+void MainWindow::on_backToWriteBtn_clicked()
+{
+    const auto name = QInputDialog::getText(this, tr("Back to Write"), tr("Memory address"), QLineEdit::Normal, ui->memAddrTxt->text());
+    if (name.isEmpty())
     {
-        CIR = FindOffsetByLabel(jumpInstruction);
-        if (CIR < 0)
-        {
-            QMessageBox::warning(this, "Code execution error", "Cannot find label: " + jumpInstruction);
-            return;
-        }
+        return;
     }
-    else
+    const auto inputs = history.InputCount();
+    if (!machine.RunBackToWrite(machine.Memory().Find(name)))
     {
-        CIR++;
+        QMessageBox::information(this, tr("Back to Write"), tr("\"%1\" has not been written since the history starts.").arg(name));
+        return;
     }
-    if (!changedMem.isEmpty())
+    console.Unread(inputs - history.InputCount());
+    ShowMachineState();
+}
+
+void MainWindow::on_goToCycleBtn_clicked()
+{
+    const auto text = QInputDialog::getText(this, tr("Go to Cycle"), tr("Cycle"), QLineEdit::Normal, QString::number(machine.Cycles()));
+    auto ok = false;
+    const auto cycle = text.toLongLong(&ok);
+    if (!ok)
     {
-        PrintMemory(code.label, changedMem);
+        return;
     }
-    // Set next instruction label.
-    if (CIR < CODE_MODEL.count())
+    if (machine.Program().code.isEmpty() && !LoadProgram())
     {
-        ui->nextInstructionLabel->setText(CODE_MODEL.at(CIR).toString());
+        return;
     }
+    // Going forward runs on the GUI thread, like Step.
+    const auto inputs = history.InputCount();
+    const auto backwards = cycle < machine.Cycles();
+    const auto reached = machine.JumpToCycle(cycle);
+    if (backwards)
+    {
+        console.Unread(inputs - history.InputCount());
+    }
+    if (!reached)
+    {
+        QMessageBox::information(this, tr("Go to Cycle"), tr("Stopped at cycle %1.").arg(machine.Cycles()));
+    }
+    ShowMachineState();
 }
 
 void MainWindow::on_stopBtn_clicked()
 {
-    MEMORY.clear();
+    if (worker->isRunning())
+    {
+        // Never wait for the worker here, it may be waiting for an IN dialog on this thread.
+        clearWhenFinished = true;
+        worker->requestInterruption();
+        return;
+    }
     ClearData();
 }
 
-void MainWindow::PrintMemory(const QString &label, const QStringList &changedMem)
+void MainWindow::RefreshViews()
 {
-    static const auto getHeaderIndexByName = [&](const QString &header) -> int {
-        for (auto i = 0; i < ui->memoryTable->horizontalHeader()->count(); i++)
-            if (ui->memoryTable->horizontalHeaderItem(i) && ui->memoryTable->horizontalHeaderItem(i)->text() == header)
-                return i;
-        return -1;
-    };
-    auto row = ui->memoryTable->rowCount();
-    ui->memoryTable->insertRow(row);
-    ui->memoryTable->setVerticalHeaderItem(row, new QTableWidgetItem(label));
-    for (const auto &key : changedMem.isEmpty() ? MEMORY.keys() : QList<QString>(changedMem))
+    traceModel->Sync();
+    ui->memoryTable->scrollToBottom();
+    //
+    profileModel->Sync();
+    QVector<qint64> heat(ui->assmTxt->document()->blockCount());
     {
-        auto col = getHeaderIndexByName(key);
-        if (col < 0)
+        QMutexLocker locker(&profile.Mutex());
+        for (auto i = 0; i < instructionBlocks.count(); i++)
         {
-            col = ui->memoryTable->columnCount();
-            ui->memoryTable->insertColumn(col);
-            ui->memoryTable->setHorizontalHeaderItem(col, new QTableWidgetItem(key));
+            // Lines may have been added or removed since the program was loaded.
+            if (instructionBlocks.at(i) < heat.count())
+            {
+                heat[instructionBlocks.at(i)] = profile.Executions(i);
+            }
         }
-        ui->memoryTable->setItem(row, col, new QTableWidgetItem(NumberToString(MEMORY[key])));
     }
-    //
-    ui->memoryTable->scrollToBottom();
+    ui->assmTxt->SetHeat(heat);
 }
 
-void MainWindow::on_assmTxt_textChanged()
+void MainWindow::OnLabelsChanged(int position, int removed, const QStringList &added)
 {
-    auto labels = GetLabels(ui->assmTxt->toPlainText());
-    ui->labelList->clear();
-    for (const auto &label : labels)
+    // Only touch the items that differ, the rest of the list stays as it is.
+    const auto common = qMin(removed, added.count());
+    for (auto i = 0; i < common; i++)
     {
-        ui->labelList->addItem(label);
+        auto *item = ui->labelList->item(position + i);
+        if (item->text() != added.at(i))
+        {
+            item->setText(added.at(i));
+        }
     }
+    for (auto i = common; i < removed; i++)
+    {
+        delete ui->labelList->takeItem(position + common);
+    }
+    ui->labelList->insertItems(position + common, added.mid(common));
 }
 
 void MainWindow::on_setMemBtn_clicked()
@@ -149,27 +557,188 @@ void MainWindow::on_setMemBtn_clicked()
     auto addr = ui->memAddrTxt->text();
     if (!addr.isEmpty())
     {
-        MEMORY[addr] = ui->memDataTxt->value();
+        auto &memory = machine.Memory();
+        memory[memory.Intern(addr)] = ui->memDataTxt->value();
+        machine.ResetLoopDetector();
+    }
+    trace.AppendMarker("MEMSET", machine.Cycles(), machine.Memory().Symbols(), machine.Memory());
+    // The history cannot go back through a change it did not record.
+    history.Clear();
+    RefreshViews();
+}
+
+void MainWindow::on_profileChk_toggled(bool checked)
+{
+    machine.SetProfile(checked ? &profile : nullptr);
+    ui->exportProfileBtn->setEnabled(checked);
+}
+
+void MainWindow::on_exportProfileBtn_clicked()
+{
+    const auto fileName = QFileDialog::getSaveFileName(this, tr("Export Profile"), QString(), tr("JSON files (*.json)"));
+    if (fileName.isEmpty())
+    {
+        return;
+    }
+    QByteArray json;
+    {
+        QMutexLocker locker(&profile.Mutex());
+        json = profile.ToJson(machine.Program(), machine.Memory());
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size())
+    {
+        QMessageBox::warning(this, tr("Export Profile"), file.errorString());
+    }
+}
+
+void MainWindow::on_compileBtn_clicked()
+{
+    QString errorMessage;
+    CIEAssemblyProgram program;
+    parseCache->Assemble(&program, &errorMessage);
+    if (!errorMessage.isEmpty())
+    {
+        QMessageBox::warning(this, tr("Invalid CIE Assembly Code"), errorMessage);
+        return;
+    }
+    const auto fileName = QFileDialog::getSaveFileName(this, tr("Save Compiled Program"), QString(), tr("Compiled programs (*.asmc)"));
+    if (fileName.isEmpty())
+    {
+        return;
+    }
+    // The editor is not backed by a file, only the hash of its text is recorded.
+    if (!WriteCompiledProgram(fileName, program, { QString(), HashSource(ui->assmTxt->toPlainText()) }, &errorMessage))
+    {
+        QMessageBox::warning(this, tr("Save Compiled Program"), errorMessage);
+    }
+}
+
+void MainWindow::on_loadInputBtn_clicked()
+{
+    const auto fileName = QFileDialog::getOpenFileName(this, tr("Load Input"));
+    if (fileName.isEmpty())
+    {
+        return;
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        QMessageBox::warning(this, tr("Load Input"), file.errorString());
+        return;
+    }
+    // Every byte of the file is a character of the tape.
+    ui->inputTapeTxt->setPlainText(QString::fromLatin1(file.readAll()));
+}
+
+void MainWindow::on_clearOutputBtn_clicked()
+{
+    ui->outputTxt->clear();
+}
+
+void MainWindow::FlushOutput()
+{
+    qint64 dropped = 0;
+    const auto output = console.TakeOutput(&dropped);
+    if (output.isEmpty() && dropped == 0)
+    {
+        return;
+    }
+    QString text;
+    if (dropped > 0)
+    {
+        text = tr("\n[%1 characters not shown]\n").arg(dropped);
+    }
+    if (base == ASCII)
+    {
+        text += QString::fromLatin1(output);
+    }
+    else
+    {
+        for (const auto c : output)
+        {
+            text += NumberToString(c, base) + ' ';
+        }
+    }
+    // Only follow the output when it's already shown up to its end.
+    auto *scrollBar = ui->outputTxt->verticalScrollBar();
+    const auto atEnd = scrollBar->value() == scrollBar->maximum();
+    QTextCursor cursor(ui->outputTxt->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text);
+    if (atEnd)
+    {
+        scrollBar->setValue(scrollBar->maximum());
+    }
+}
+
+void MainWindow::on_addBreakpointBtn_clicked()
+{
+    AddBreakpoint(false);
+}
+
+void MainWindow::on_addWatchpointBtn_clicked()
+{
+    AddBreakpoint(true);
+}
+
+void MainWindow::AddBreakpoint(bool watch)
+{
+    const auto location = ui->breakLocationTxt->text().trimmed();
+    if (location.isEmpty())
+    {
+        return;
+    }
+    const auto condition = ui->breakConditionTxt->text().trimmed();
+    auto *item = new QListWidgetItem((watch ? tr("Watch %1") : tr("Break at %1")).arg(location) +
+                                     (condition.isEmpty() ? QString() : tr(" if %1").arg(condition)));
+    item->setData(ROLE_WATCH, watch);
+    item->setData(ROLE_LOCATION, location);
+    item->setData(ROLE_CONDITION, condition);
+    ui->breakpointList->addItem(item);
+    OnBreakpointsChanged();
+}
+
+void MainWindow::on_removeBreakpointBtn_clicked()
+{
+    delete ui->breakpointList->currentItem();
+    OnBreakpointsChanged();
+}
+
+void MainWindow::OnBreakpointsChanged()
+{
+    // While the worker runs, the breakpoints are given to the machine when it pauses, or by the next load.
+    if (machine.Program().code.isEmpty() || (worker->isRunning() && !workerPaused))
+    {
+        return;
+    }
+    QString errorMessage;
+    if (!ApplyBreakpoints(&errorMessage))
+    {
+        QMessageBox::warning(this, tr("Invalid Breakpoint"), errorMessage);
     }
-    PrintMemory("MEMSET", {});
 }
 
 void MainWindow::on_binOutputRad_clicked()
 {
-    Base = BASE2;
+    base = BASE2;
+    traceModel->SetBase(base);
 }
 
 void MainWindow::on_decOutputRad_clicked()
 {
-    Base = BASE10;
+    base = BASE10;
+    traceModel->SetBase(base);
 }
 
 void MainWindow::on_hexOutputRad_clicked()
 {
-    Base = BASE16;
+    base = BASE16;
+    traceModel->SetBase(base);
 }
 
 void MainWindow::on_asciiOutputRad_clicked()
 {
-    Base = ASCII;
+    base = ASCII;
+    traceModel->SetBase(base);
 }
@@ -1,6 +1,16 @@
 #pragma once
 
+#include "core/CIEAssemConsole.hpp"
+#include "core/CIEAssemMachine.hpp"
+#include "core/CIEAssemWorker.hpp"
+
 #include <QMainWindow>
+#include <QVector>
+
+class ParseCache;
+class ProfileModel;
+class QTimer;
+class TraceModel;
 
 QT_BEGIN_NAMESPACE
 namespace Ui
@@ -22,12 +32,50 @@ class MainWindow : public QMainWindow
 
     void on_stepBtn_clicked();
 
+    void on_stepBackBtn_clicked();
+
+    void on_backToWriteBtn_clicked();
+
+    void on_goToCycleBtn_clicked();
+
     void on_stopBtn_clicked();
 
-    void on_assmTxt_textChanged();
+    void on_pauseBtn_toggled(bool checked);
+
+    void OnWorkerProgress(qint64 cycles, double cyclesPerSecond, int cir);
+
+    /// Shows the changes collected since the last frame.
+    void ShowFrame();
+
+    void OnWorkerPaused(qint64 cycles, int cir, int generation);
+
+    void OnWorkerFinished();
+
+    void OnLabelsChanged(int position, int removed, const QStringList &added);
 
     void on_setMemBtn_clicked();
 
+    void on_profileChk_toggled(bool checked);
+
+    void on_exportProfileBtn_clicked();
+
+    void on_compileBtn_clicked();
+
+    void on_loadInputBtn_clicked();
+
+    void on_clearOutputBtn_clicked();
+
+    /// Shows what OUT wrote since the last time.
+    void FlushOutput();
+
+    void on_addBreakpointBtn_clicked();
+
+    void on_addWatchpointBtn_clicked();
+
+    void on_removeBreakpointBtn_clicked();
+
+    void OnBreakpointsChanged();
+
     void on_binOutputRad_clicked();
 
     void on_decOutputRad_clicked();
@@ -37,10 +85,67 @@ class MainWindow : public QMainWindow
     void on_asciiOutputRad_clicked();
 
   private:
+    /// Interval between two updates of the output while the worker runs, however fast the program writes.
+    static constexpr int OUTPUT_INTERVAL_MS = 50;
+    /// Lines of output kept, the oldest ones are removed.
+    static constexpr int MAXIMUM_OUTPUT_LINES = 10000;
+    /// The views are redrawn at most once per frame, about 60 times per second, however often the machine moves.
+    static constexpr int FRAME_INTERVAL_MS = 16;
+    //
+    struct Progress
+    {
+        qint64 cycles;
+        double cyclesPerSecond;
+        int cir;
+    };
+    //
     void ClearData();
-    void PrintMemory(const QString &label, const QStringList &changedMem);
+    bool LoadProgram();
+    void SetRunning(bool running);
+    /// Shows the cycle count, the next instruction, the trace and the profile after the machine moved.
+    void ShowMachineState();
+    void RunOnGuiThread(const std::function<void()> &function);
+    void ShowProgress(const Progress &progress);
+    /// Starts the frame timer, unless a frame is already due.
+    void ScheduleFrame();
+    /// With the live view off, runs the worker without the trace and the history, so the machine runs at full speed.
+    void DetachViews();
+    /// Gives the trace and the history back to the machine once the worker stopped, with a row of the state it reached.
+    void AttachViews();
+    /// Adds a breakpoint or a watchpoint from the location and condition fields to the list.
+    void AddBreakpoint(bool watch);
+    /// Resolves the breakpoints of the gutter and of the list against the loaded program, and gives them to the machine.
+    /// Lines cannot be resolved once lines have been added or removed since loading, they wait for the next load.
+    bool ApplyBreakpoints(QString *errorMessage);
+    /// Index of the instruction on a block of the document, or of the first instruction after it, -1 if there is none.
+    int InstructionAtBlock(int block) const;
+    /// Shows the new rows of the trace and the current profile.
+    void RefreshViews();
     Ui::MainWindow *ui;
+    ParseCache *parseCache;
     //
-    int CIR = 0;
-    int execCycles = 0;
+    CIEAssembly::CIEAssemblyMachine machine;
+    CIEAssembly::CIEAssemblyTrace trace;
+    CIEAssembly::CIEAssemblyHistory history;
+    TraceModel *traceModel;
+    CIEAssembly::CIEAssemblyProfile profile;
+    ProfileModel *profileModel;
+    /// Block of the document of every instruction of the loaded program.
+    QVector<int> instructionBlocks;
+    CIEAssembly::CIEAssemblyWorker *worker;
+    CIEAssembly::CIEAssemblyConsole console;
+    QTimer *outputTimer;
+    QTimer *frameTimer;
+    Progress pendingProgress = {};
+    bool progressPending = false;
+    /// The trace, the profile and the heat of the editor have to be redrawn at the next frame.
+    bool viewsPending = false;
+    /// The worker runs without the trace and the history, see DetachViews().
+    bool viewsDetached = false;
+    bool clearWhenFinished = false;
+    /// The worker is waiting after a pause or a breakpoint, the machine belongs to the GUI thread until it's resumed.
+    bool workerPaused = false;
+    /// The window is being destroyed, an IN of the worker stops the program instead of asking for input.
+    bool closing = false;
+    CIEAssembly::NumberBase base = CIEAssembly::BASE10;
 };
@@ -0,0 +1,107 @@
+#include "ParseCache.hpp"
+
+#include <QTextBlock>
+#include <algorithm>
+
+ParseCache::ParseCache(QTextDocument *document, QObject *parent) : QObject(parent), document(document)
+{
+    connect(document, &QTextDocument::contentsChange, this, &ParseCache::OnContentsChange);
+    Update(0, 0, document->blockCount());
+}
+
+void ParseCache::Assemble(CIEAssemblyProgram *program, QString *errorMessage) const
+{
+    AssembleParsedLines(lines, program, errorMessage);
+}
+
+QStringList ParseCache::Labels() const
+{
+    QStringList labels;
+    for (const auto &line : lines)
+    {
+        if (line.type == LINE_LABEL)
+        {
+            labels << line.label;
+        }
+    }
+    return labels;
+}
+
+void ParseCache::OnContentsChange(int position, int, int charsAdded)
+{
+    // The blocks from the one containing position to the one containing the end of the insertion are new or modified.
+    const auto firstBlock = document->findBlock(position);
+    const auto lastBlock = document->findBlock(position + charsAdded);
+    const auto first = firstBlock.isValid() ? firstBlock.blockNumber() : 0;
+    const auto last = lastBlock.isValid() ? lastBlock.blockNumber() : document->blockCount() - 1;
+    const auto addedLines = last - first + 1;
+    const auto removedLines = addedLines - (document->blockCount() - lines.count());
+    if (removedLines < 0 || first + removedLines > lines.count())
+    {
+        // Should not happen, but parsing everything again is always right.
+        Update(0, lines.count(), document->blockCount());
+        return;
+    }
+    Update(first, removedLines, addedLines);
+}
+
+void ParseCache::Update(int first, int removedLines, int addedLines)
+{
+    QStringList removedLabels;
+    for (auto i = first; i < first + removedLines; i++)
+    {
+        if (lines.at(i).type == LINE_LABEL)
+        {
+            removedLabels << lines.at(i).label;
+        }
+    }
+    //
+    QVector<CIEAssemblyParsedLine> parsed;
+    parsed.reserve(addedLines);
+    QStringList addedLabels;
+    auto block = document->findBlockByNumber(first);
+    for (auto i = 0; i < addedLines && block.isValid(); i++, block = block.next())
+    {
+        parsed << ParseAssemblyLine(block.text());
+        if (parsed.last().type == LINE_LABEL)
+        {
+            addedLabels << parsed.last().label;
+        }
+    }
+    //
+    // The lines both removed and added are overwritten in place, typing inside a line keeps the number of blocks. Only the
+    // difference is then inserted or erased, the lines after it are moved once and never copied.
+    const auto kept = qMin(removedLines, parsed.count());
+    std::move(parsed.begin(), parsed.begin() + kept, lines.begin() + first);
+    if (removedLines > kept)
+    {
+        lines.erase(lines.begin() + first + kept, lines.begin() + first + removedLines);
+    }
+    else if (parsed.count() > kept)
+    {
+        lines.insert(first + kept, parsed.count() - kept, CIEAssemblyParsedLine());
+        std::move(parsed.begin() + kept, parsed.end(), lines.begin() + first + kept);
+    }
+    //
+    if (removedLabels == addedLabels)
+    {
+        return;
+    }
+    for (const auto &label : removedLabels)
+    {
+        if (--labelDeclarations[label] == 0)
+        {
+            labelDeclarations.remove(label);
+        }
+    }
+    for (const auto &label : addedLabels)
+    {
+        labelDeclarations[label]++;
+    }
+    auto labelsBefore = 0;
+    for (auto i = 0; i < first; i++)
+    {
+        labelsBefore += lines.at(i).type == LINE_LABEL;
+    }
+    emit labelsChanged(labelsBefore, removedLabels.count(), addedLabels);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "core/CIEAssemRunner.hpp"
+
+#include <QHash>
+#include <QObject>
+#include <QTextDocument>
+
+/// The parsed form of every line of a document, kept up to date by re-parsing only the blocks touched by each edit.
+class ParseCache : public QObject
+{
+    Q_OBJECT
+
+  public:
+    explicit ParseCache(QTextDocument *document, QObject *parent = nullptr);
+    /// Assembles the cached lines into a program, without parsing the text again.
+    void Assemble(CIEAssembly::CIEAssemblyProgram *program, QString *errorMessage) const;
+    /// One entry per block of the document.
+    const QVector<CIEAssembly::CIEAssemblyParsedLine> &Lines() const
+    {
+        return lines;
+    }
+    /// Every declared label, in the order of the document.
+    QStringList Labels() const;
+    /// How many times a label is declared, 0 for an unknown label.
+    int LabelDeclarations(const QString &label) const
+    {
+        return labelDeclarations.value(label);
+    }
+
+  signals:
+    /// The labels from index position to position + removed of Labels() have been replaced by added.
+    void labelsChanged(int position, int removed, const QStringList &added);
+
+  private slots:
+    void OnContentsChange(int position, int charsRemoved, int charsAdded);
+
+  private:
+    /// Replaces removedLines cached lines from first by the parse of addedLines blocks.
+    void Update(int first, int removedLines, int addedLines);
+    //
+    QTextDocument *document;
+    QVector<CIEAssembly::CIEAssemblyParsedLine> lines;
+    QHash<QString, int> labelDeclarations;
+};
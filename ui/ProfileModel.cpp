@@ -0,0 +1,93 @@
+#include "ProfileModel.hpp"
+
+ProfileModel::ProfileModel(const CIEAssemblyMachine *machine, const CIEAssemblyProfile *profile, QObject *parent)
+    : QAbstractTableModel(parent), machine(machine), profile(profile)
+{
+}
+
+void ProfileModel::Sync()
+{
+    const auto &program = machine->Program();
+    QVector<LabelCounts> counts(program.labelNames.count());
+    for (auto i = 0; i < counts.count(); i++)
+    {
+        counts[i].label = program.labelNames.at(i);
+    }
+    {
+        QMutexLocker locker(&profile->Mutex());
+        for (auto i = 0; i < program.code.count(); i++)
+        {
+            auto &label = counts[program.code.at(i).labelId];
+            label.executions += profile->Executions(i);
+            label.taken += profile->BranchesTaken(i);
+            label.notTaken += profile->BranchesNotTaken(i);
+        }
+        totalExecutions = profile->TotalExecutions();
+    }
+    if (counts.count() != labels.count())
+    {
+        beginResetModel();
+        labels = counts;
+        endResetModel();
+        return;
+    }
+    labels = counts;
+    if (!labels.isEmpty())
+    {
+        emit dataChanged(index(0, 0), index(labels.count() - 1, COLUMN_COUNT - 1));
+    }
+}
+
+int ProfileModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : labels.count();
+}
+
+int ProfileModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QVariant ProfileModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+    {
+        return {};
+    }
+    const auto &label = labels.at(index.row());
+    const auto share = totalExecutions > 0 ? 100.0 * label.executions / totalExecutions : 0.0;
+    if (role == Qt::TextAlignmentRole)
+    {
+        return index.column() == COLUMN_LABEL ? int(Qt::AlignLeft | Qt::AlignVCenter) : int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if (role != Qt::DisplayRole && role != SORT_ROLE)
+    {
+        return {};
+    }
+    switch (index.column())
+    {
+        case COLUMN_LABEL: return label.label;
+        case COLUMN_EXECUTIONS: return label.executions;
+        case COLUMN_SHARE: return role == SORT_ROLE ? QVariant(share) : QVariant(QString::number(share, 'f', 2) + " %");
+        case COLUMN_TAKEN: return label.taken;
+        case COLUMN_NOT_TAKEN: return label.notTaken;
+        default: return {};
+    }
+}
+
+QVariant ProfileModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+    {
+        return {};
+    }
+    switch (section)
+    {
+        case COLUMN_LABEL: return tr("Label");
+        case COLUMN_EXECUTIONS: return tr("Executions");
+        case COLUMN_SHARE: return tr("Share");
+        case COLUMN_TAKEN: return tr("Taken");
+        case COLUMN_NOT_TAKEN: return tr("Not Taken");
+        default: return {};
+    }
+}
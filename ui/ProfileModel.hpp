@@ -0,0 +1,49 @@
+#pragma once
+
+#include "core/CIEAssemMachine.hpp"
+
+#include <QAbstractTableModel>
+
+/// The CIEAssemblyProfile of a machine summed per label, the hottest code of a program at a glance.
+///
+/// Instructions count for the last label before them, the ones before the first label count for "_init_".
+class ProfileModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+  public:
+    enum Column
+    {
+        COLUMN_LABEL,
+        COLUMN_EXECUTIONS,
+        COLUMN_SHARE,
+        COLUMN_TAKEN,
+        COLUMN_NOT_TAKEN,
+        COLUMN_COUNT
+    };
+    /// Unformatted values, numbers for the counts, so sorting is numeric.
+    static constexpr int SORT_ROLE = Qt::UserRole;
+    //
+    ProfileModel(const CIEAssembly::CIEAssemblyMachine *machine, const CIEAssembly::CIEAssemblyProfile *profile, QObject *parent = nullptr);
+    /// Sums the profile again, for the program currently loaded in the machine.
+    void Sync();
+    //
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+  private:
+    struct LabelCounts
+    {
+        QString label;
+        qint64 executions = 0;
+        qint64 taken = 0;
+        qint64 notTaken = 0;
+    };
+    //
+    const CIEAssembly::CIEAssemblyMachine *machine;
+    const CIEAssembly::CIEAssemblyProfile *profile;
+    QVector<LabelCounts> labels;
+    qint64 totalExecutions = 0;
+};
@@ -0,0 +1,141 @@
+#include "TraceModel.hpp"
+
+TraceModel::TraceModel(const CIEAssemblyMachine *machine, const CIEAssemblyTrace *trace, QObject *parent)
+    : QAbstractTableModel(parent), machine(machine), trace(trace)
+{
+    SetBase(BASE10);
+}
+
+void TraceModel::Sync()
+{
+    QMutexLocker locker(&trace->Mutex());
+    const auto columns = trace->ColumnCount();
+    if (columns > columnNames.count())
+    {
+        beginInsertColumns({}, columnNames.count(), columns - 1);
+        for (auto i = columnNames.count(); i < columns; i++)
+        {
+            columnNames << machine->Memory().NameOf(trace->ColumnAddress(i));
+        }
+        endInsertColumns();
+    }
+    // Rows dropped from the start of the trace are removed from the start of the model, which then shows its rows from the
+    // first one of the trace again.
+    const auto droppedRows = int(qMin<qint64>(rows, trace->DroppedRows() - firstRow));
+    const auto rowsBeforeDrop = rows;
+    if (droppedRows > 0)
+    {
+        beginRemoveRows({}, 0, droppedRows - 1);
+        rows -= droppedRows;
+        endRemoveRows();
+    }
+    firstRow = trace->DroppedRows();
+    const auto newRows = trace->RowCount();
+    // The rows removed from the end since the last call may have been appended again, after going back in time and forward.
+    // The rows before the first that could have been removed are the same, the others are changed.
+    const auto oldRows = rows;
+    const auto keptRows = int(qBound<qint64>(0, rowsBeforeDrop - droppedRows - (trace->RemovedRows() - removedRows), rows));
+    removedRows = trace->RemovedRows();
+    if (newRows < rows)
+    {
+        beginRemoveRows({}, newRows, rows - 1);
+        rows = newRows;
+        endRemoveRows();
+    }
+    if (newRows > rows)
+    {
+        beginInsertRows({}, rows, newRows - 1);
+        rows = newRows;
+        endInsertRows();
+    }
+    const auto changedRows = qMin(oldRows, newRows);
+    if (keptRows < changedRows && !columnNames.isEmpty())
+    {
+        emit dataChanged(index(keptRows, 0), index(changedRows - 1, columnNames.count() - 1));
+        emit headerDataChanged(Qt::Vertical, keptRows, changedRows - 1);
+    }
+}
+
+void TraceModel::Reset()
+{
+    beginResetModel();
+    rows = 0;
+    {
+        QMutexLocker locker(&trace->Mutex());
+        removedRows = trace->RemovedRows();
+        firstRow = trace->DroppedRows();
+    }
+    columnNames.clear();
+    endResetModel();
+}
+
+void TraceModel::SetBase(NumberBase base)
+{
+    valueStrings.clear();
+    for (auto i = 0; i < 256; i++)
+    {
+        valueStrings << NumberToString(char(i), base);
+    }
+    if (rows > 0)
+    {
+        emit dataChanged(index(0, 0), index(rows - 1, columnNames.count() - 1));
+    }
+}
+
+int TraceModel::TraceRow(int row) const
+{
+    // The trace may have dropped rows that are not removed from the model yet, the rows of the model then start later in it.
+    const auto traceRow = row + firstRow - trace->DroppedRows();
+    return traceRow < 0 || traceRow >= trace->RowCount() ? -1 : int(traceRow);
+}
+
+int TraceModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rows;
+}
+
+int TraceModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : columnNames.count();
+}
+
+QVariant TraceModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole || !index.isValid())
+    {
+        return {};
+    }
+    QMutexLocker locker(&trace->Mutex());
+    const auto row = TraceRow(index.row());
+    char value;
+    if (row < 0 || !trace->Value(row, index.column(), &value))
+    {
+        return {};
+    }
+    return valueStrings.at(quint8(value));
+}
+
+QVariant TraceModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+    {
+        return {};
+    }
+    if (orientation == Qt::Horizontal)
+    {
+        return columnNames.value(section);
+    }
+    QMutexLocker locker(&trace->Mutex());
+    const auto row = TraceRow(section);
+    if (row < 0)
+    {
+        return {};
+    }
+    const auto instruction = trace->RowInstruction(row);
+    if (instruction < 0)
+    {
+        return trace->RowMarker(row);
+    }
+    const auto &program = machine->Program();
+    return program.code.at(instruction).labelName(program.labelNames);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "core/CIEAssemMachine.hpp"
+
+#include <QAbstractTableModel>
+
+/// Shows the CIEAssemblyTrace of a machine, only the rows in view are formatted.
+class TraceModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+  public:
+    TraceModel(const CIEAssembly::CIEAssemblyMachine *machine, const CIEAssembly::CIEAssemblyTrace *trace, QObject *parent = nullptr);
+    /// Publishes the rows and columns appended to the trace since the last call, and the rows removed from its end, with one
+    /// notification per kind of change however many instructions were executed in between.
+    void Sync();
+    /// Forgets every row, call it after the trace has been cleared.
+    void Reset();
+    void SetBase(CIEAssembly::NumberBase base);
+    //
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+  private:
+    /// Row of the trace shown in a row of the model, -1 if it has been dropped. The mutex of the trace must be held.
+    int TraceRow(int row) const;
+    //
+    const CIEAssembly::CIEAssemblyMachine *machine;
+    const CIEAssembly::CIEAssemblyTrace *trace;
+    int rows = 0;
+    /// CIEAssemblyTrace::RemovedRows() when the rows were last published.
+    qint64 removedRows = 0;
+    /// CIEAssemblyTrace::DroppedRows() when the rows were last published, the first row of the trace in the model.
+    qint64 firstRow = 0;
+    QStringList columnNames;
+    /// NumberToString of every byte value, in the current base.
+    QStringList valueStrings;
+};